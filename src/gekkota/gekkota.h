@@ -10,6 +10,7 @@
 #ifndef __GEKKOTA_H__
 #define __GEKKOTA_H__
 
+#include <time.h>
 #include "gekkota/gekkota_types.h"
 
 GEKKOTA_API int32_t
@@ -70,6 +71,7 @@ gekkota_get_last_error();
 #include "gekkota/gekkota_networkinterface.h"
 #include "gekkota/gekkota_packet.h"
 #include "gekkota/gekkota_platform.h"
+#include "gekkota/gekkota_reactor.h"
 #include "gekkota/gekkota_socket.h"
 #include "gekkota/gekkota_string.h"
 #include "gekkota/gekkota_time.h"
@@ -80,7 +80,7 @@ gekkota_buffer_copy(GekkotaBuffer *restrict buffer, const GekkotaBuffer *value)
         return -1;
     }
 
-    if (buffer->length == 0 || value->length)
+    if (buffer->length == 0 || value->length == 0)
     {
         errno = GEKKOTA_ERROR_ZERO_LENGTH_BUFFER;
         return -1;
@@ -16,10 +16,21 @@ GekkotaEvent *
 gekkota_event_new_0(GekkotaEvent *restrict event)
 {
     if (event == NULL)
+    {
         errno = GEKKOTA_ERROR_NULL_ARGUMENT;
-    else
-        ++event->refCount;
+        return NULL;
+    }
 
+    if (event->refCount == 0)
+    {
+        /*
+         * Value events belong to the caller's storage.
+         */
+        errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
+        return NULL;
+    }
+
+    ++event->refCount;
     return event;
 }
         
@@ -32,15 +43,16 @@ gekkota_event_destroy(GekkotaEvent *event)
         return -1;
     }
 
-    if (--event->refCount == 0)
+    if (event->refCount == 0)
     {
-        if (event->packet != NULL)
-            gekkota_packet_destroy(event->packet);
-
-        if (event->remoteEndPoint != NULL)
-            gekkota_ipendpoint_destroy(event->remoteEndPoint);
+        errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
+        return -1;
+    }
 
-        gekkota_memory_free(event);
+    if (--event->refCount == 0)
+    {
+        gekkota_event_clear(event);
+        gekkota_memory_arena_free(event->arena, event);
     }
     else
         return event->refCount;
@@ -48,6 +60,28 @@ gekkota_event_destroy(GekkotaEvent *event)
     return 0;
 }
 
+int32_t
+gekkota_event_clear(GekkotaEvent *event)
+{
+    if (event == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    if (event->packet != NULL)
+        gekkota_packet_destroy(event->packet);
+
+    if (event->remoteEndPoint != NULL)
+        gekkota_ipendpoint_destroy(event->remoteEndPoint);
+
+    event->type = GEKKOTA_EVENT_TYPE_UNDEFINED;
+    event->packet = NULL;
+    event->remoteEndPoint = NULL;
+
+    return 0;
+}
+
 GekkotaEventType
 gekkota_event_get_type(const GekkotaEvent *event)
 {
@@ -105,6 +139,14 @@ gekkota_event_get_remote_endpoint(const GekkotaEvent *event)
         return NULL;
     }
 
+    /*
+     * The remote endpoint is allocated only the first time it is asked
+     * for; most applications never need it.
+     */
+    if (event->remoteEndPoint == NULL && event->remoteSocketAddress.family != 0)
+        ((GekkotaEvent *) event)->remoteEndPoint =
+            gekkota_ipendpoint_new_2(&event->remoteSocketAddress);
+
     return event->remoteEndPoint;
 }
 
@@ -114,7 +156,7 @@ _gekkota_event_new(
         GekkotaXudpClient *client,
         uint8_t channelId,
         GekkotaPacket *packet,
-        GekkotaIPEndPoint *remoteEndPoint,
+        const GekkotaSocketAddress *remoteSocketAddress,
         bool_t copy)
 {
     GekkotaEvent *event;
@@ -122,6 +164,23 @@ _gekkota_event_new(
     if ((event = gekkota_memory_alloc(sizeof(GekkotaEvent), FALSE)) == NULL)
         return NULL;
 
+    _gekkota_event_init(event, type, client, channelId, packet, remoteSocketAddress, copy);
+    event->refCount = 1;
+    event->arena = gekkota_memory_get_arena();
+
+    return event;
+}
+
+void_t
+_gekkota_event_init(
+        GekkotaEvent *restrict event,
+        GekkotaEventType type,
+        GekkotaXudpClient *client,
+        uint8_t channelId,
+        GekkotaPacket *packet,
+        const GekkotaSocketAddress *remoteSocketAddress,
+        bool_t copy)
+{
     event->type = type;
     event->client = client;
     event->channelId = (uint8_t) (channelId & 0x000000FF);
@@ -129,9 +188,12 @@ _gekkota_event_new(
     if ((event->packet = packet) != NULL && copy)
         event->packet = gekkota_packet_new_0(event->packet, FALSE);
     
-    if ((event->remoteEndPoint = remoteEndPoint) != NULL && copy)
-        event->remoteEndPoint = gekkota_ipendpoint_new_0(event->remoteEndPoint, FALSE);
+    if (remoteSocketAddress != NULL)
+        event->remoteSocketAddress = *remoteSocketAddress;
+    else
+        event->remoteSocketAddress.family = 0;
 
-    event->refCount = 1;
-    return event;
+    event->remoteEndPoint = NULL;
+    event->refCount = 0;
+    event->arena = NULL;
 }
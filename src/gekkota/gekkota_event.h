@@ -11,6 +11,7 @@
 #define __GEKKOTA_EVENT_H__
 
 #include "gekkota/gekkota_ipendpoint.h"
+#include "gekkota/gekkota_memory.h"
 #include "gekkota/gekkota_packet.h"
 #include "gekkota/gekkota_types.h"
 #include "gekkota/gekkota_xudpclient.h"
@@ -25,7 +26,28 @@ typedef enum
     GEKKOTA_EVENT_TYPE_RECEIVE                  = 0x00000005
 } GekkotaEventType;
 
-typedef struct _GekkotaEvent GekkotaEvent;
+/*
+ * Events returned by gekkota_xudp_poll() are allocated by the library and
+ * reference counted through gekkota_event_new_0() and
+ * gekkota_event_destroy(). Those filled in by gekkota_xudp_poll_batch() are
+ * values living in caller-owned storage: they are released with
+ * gekkota_event_clear() only, and gekkota_event_new_0() and
+ * gekkota_event_destroy() refuse them. The layout is public just so that
+ * such storage can be declared; fields are private: use the accessors.
+ */
+typedef struct _GekkotaEvent
+{
+    GekkotaEventType    type;
+    GekkotaXudpClient   *client;
+    uint8_t             channelId;
+    GekkotaPacket       *packet;
+    GekkotaSocketAddress remoteSocketAddress;
+    GekkotaIPEndPoint   *remoteEndPoint;        /* created on demand from */
+                                                /* [remoteSocketAddress] */
+    uint32_t            refCount;               /* 0 for value events */
+    GekkotaMemoryArena  *arena;                 /* arena the event was */
+                                                /* allocated from, if any */
+} GekkotaEvent;
 
 GEKKOTA_API GekkotaEvent *
 gekkota_event_new_0(GekkotaEvent *restrict event);
@@ -33,6 +55,9 @@ gekkota_event_new_0(GekkotaEvent *restrict event);
 GEKKOTA_API int32_t
 gekkota_event_destroy(GekkotaEvent *event);
 
+GEKKOTA_API int32_t
+gekkota_event_clear(GekkotaEvent *event);
+
 GEKKOTA_API GekkotaEventType
 gekkota_event_get_type(const GekkotaEvent *event);
 
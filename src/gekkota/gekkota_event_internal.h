@@ -16,15 +16,15 @@
 #include "gekkota/gekkota_types.h"
 #include "gekkota/gekkota_xudpclient.h"
 
-struct _GekkotaEvent
-{
-    GekkotaEventType    type;
-    GekkotaXudpClient   *client;
-    uint8_t             channelId;
-    GekkotaPacket       *packet;
-    GekkotaIPEndPoint   *remoteEndPoint;
-    uint32_t            refCount;
-};
+extern void_t
+_gekkota_event_init(
+        GekkotaEvent *restrict event,
+        GekkotaEventType type,
+        GekkotaXudpClient *client,
+        uint8_t channelId,
+        GekkotaPacket *packet,
+        const GekkotaSocketAddress *remoteSocketAddress,
+        bool_t copy);
 
 extern GekkotaEvent *
 _gekkota_event_new(
@@ -32,7 +32,7 @@ _gekkota_event_new(
         GekkotaXudpClient *client,
         uint8_t channelId,
         GekkotaPacket *packet,
-        GekkotaIPEndPoint *remoteEndPoint,
+        const GekkotaSocketAddress *remoteSocketAddress,
         bool_t copy);
 
 #endif /* !__GEKKOTA_EVENT_INTERNAL_H__ */
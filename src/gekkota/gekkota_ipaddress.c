@@ -238,8 +238,8 @@ gekkota_ipaddress_equals(
     return address->family == value->family &&
         address->scopeID == value->scopeID &&
         IN6_ARE_ADDR_EQUAL(
-            (const IN6_ADDR *) &address->ipAddress,
-            (const IN6_ADDR *) &value->ipAddress);
+            (const struct in6_addr *) &address->ipAddress,
+            (const struct in6_addr *) &value->ipAddress);
 }
 
 bool_t
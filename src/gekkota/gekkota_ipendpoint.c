@@ -309,6 +309,44 @@ gekkota_ipendpoint_to_socketaddress(
     return 0;
 }
 
+bool_t
+_gekkota_ipendpoint_socketaddress_equals(
+        const GekkotaSocketAddress *socketAddress,
+        const GekkotaSocketAddress *value,
+        bool_t comparePort)
+{
+    /*
+     * Unlike [gekkota_ipendpoint_equals], this function does not require
+     * any endpoint to be allocated; it is used on the receive path to match
+     * the source of incoming datagrams against connected clients.
+     */
+
+    if (socketAddress->family != value->family)
+        return FALSE;
+
+    if (comparePort && socketAddress->port != value->port)
+        return FALSE;
+
+    switch (socketAddress->family)
+    {
+        case AF_INET:
+            return memcmp(
+                    &((struct sockaddr_in *) socketAddress)->sin_addr,
+                    &((struct sockaddr_in *) value)->sin_addr,
+                    sizeof(struct in_addr)) == 0;
+
+        case AF_INET6:
+            return memcmp(
+                    &((struct sockaddr_in6 *) socketAddress)->sin6_addr,
+                    &((struct sockaddr_in6 *) value)->sin6_addr,
+                    sizeof(struct in6_addr)) == 0 &&
+                ((struct sockaddr_in6 *) socketAddress)->sin6_scope_id ==
+                ((struct sockaddr_in6 *) value)->sin6_scope_id;
+    }
+
+    return FALSE;
+}
+
 static inline GekkotaIPEndPoint *
 _gekkota_ipendpoint_new(GekkotaIPAddress *address, uint16_t port)
 {
@@ -20,4 +20,10 @@ struct _GekkotaIPEndPoint
     uint32_t            refCount;
 };
 
+extern bool_t
+_gekkota_ipendpoint_socketaddress_equals(
+        const GekkotaSocketAddress *socketAddress,
+        const GekkotaSocketAddress *value,
+        bool_t comparePort);
+
 #endif /* !__GEKKOTA_IPENDPOINT_INTERNAL_H__ */
@@ -12,8 +12,8 @@
 #include "gekkota.h"
 #include "gekkota_bit.h"
 #include "gekkota_errors.h"
-#include "gekkota_hooks.h"
 #include "gekkota_iphostentry.h"
+#include "gekkota_memory.h"
 
 #ifndef HAVE_NATIVE_IDN
 #include "gekkota_idn.h"
@@ -11,67 +11,213 @@
 #include <errno.h>
 #include <string.h>
 #include "gekkota_errors.h"
-#include "gekkota_list.h"
 #include "gekkota_memory.h"
+#include "gekkota_utils.h"
+
+#ifdef WIN32
+#include <windows.h>
+#endif /* WIN32 */
 
 /* http://www.codeproject.com/KB/cpp/MemoryPoolIntroduction.aspx */
 
-typedef struct _GekkotaFastHeap
+#define GEKKOTA_MEMORY_SIZE_CLASS_COUNT 7
+#define GEKKOTA_MEMORY_SIZE_CLASS_NONE GEKKOTA_MEMORY_SIZE_CLASS_COUNT
+#define GEKKOTA_MEMORY_REGION_MAP_SIZE 64
+
+#ifdef WIN32
+#define GEKKOTA_THREAD_LOCAL __declspec(thread)
+#define _gekkota_memory_compare_and_swap(pointer, oldValue, newValue) \
+    (InterlockedCompareExchangePointer((PVOID volatile *) (pointer), (newValue), (oldValue)) == (oldValue))
+#define _gekkota_memory_exchange(pointer, value) \
+    InterlockedExchangePointer((PVOID volatile *) (pointer), (value))
+#define _gekkota_memory_release(pointer) \
+    InterlockedExchangePointer((PVOID volatile *) (pointer), NULL)
+#define _gekkota_memory_barrier() \
+    MemoryBarrier()
+#else
+#define GEKKOTA_THREAD_LOCAL __thread
+#define _gekkota_memory_compare_and_swap(pointer, oldValue, newValue) \
+    __sync_bool_compare_and_swap((pointer), (oldValue), (newValue))
+#define _gekkota_memory_exchange(pointer, value) \
+    __sync_lock_test_and_set((pointer), (value))
+#define _gekkota_memory_release(pointer) \
+    __sync_lock_release(pointer)
+#define _gekkota_memory_barrier() \
+    __sync_synchronize()
+#endif /* WIN32 */
+
+/*
+ * Pooled blocks carry no header: a free block holds the next free block of
+ * its size class, and an allocated block belongs entirely to the caller.
+ */
+typedef struct _GekkotaMemoryBlock
+{
+    struct _GekkotaMemoryBlock  *next;
+} GekkotaMemoryBlock;
+
+typedef struct _GekkotaMemoryChunk
+{
+    struct _GekkotaMemoryChunk  *next;
+    struct _GekkotaMemoryArena  *arena;     /* owner */
+    size_t                      sizeClass;
+    byte_t                      *end;
+    double                      alignment;
+} GekkotaMemoryChunk;
+
+/*
+ * All chunks have the same size regardless of their size class, and the
+ * address space is split into regions no larger than the blocks of any
+ * chunk, so a region overlaps at most two chunks. The region map is an
+ * open-addressing table from region to the chunks it overlaps; it tells
+ * the owning chunk of any address in O(1) and leaves malloc'd memory
+ * unmapped.
+ */
+typedef struct _GekkotaMemoryRegion
+{
+    uintptr_t                   region;
+    GekkotaMemoryChunk          *chunks[2];
+} GekkotaMemoryRegion;
+
+/*
+ * Registered chunks are copied by value, so that the registry can be read
+ * while the chunks of other arenas go away.
+ */
+typedef struct _GekkotaMemoryRegisteredChunk
+{
+    const byte_t                *start;
+    const byte_t                *end;
+    struct _GekkotaMemoryArena  *arena;
+    size_t                      sizeClass;
+} GekkotaMemoryRegisteredChunk;
+
+typedef struct _GekkotaMemoryRegistry
 {
-    void_t          *memory;
-    GekkotaList     allocatedBlocks;
-    GekkotaList     freeBlocks;
-    size_t          blockSize;
-    uint32_t        blockCount;
-}GekkotaFastHeap;
+    struct _GekkotaMemoryRegistry *retired;     /* outgrown registries */
+    size_t                      chunkCount;
+    size_t                      chunkCapacity;
+    GekkotaMemoryRegisteredChunk chunks[];
+} GekkotaMemoryRegistry;
 
-static GekkotaFastHeap fastHeap =
+typedef struct _GekkotaMemorySizeClass
+{
+    GekkotaMemoryBlock          *freeBlocks;
+    size_t                      blockSize;
+} GekkotaMemorySizeClass;
+
+/*
+ * An arena is only ever touched by the thread it is attached to, except
+ * for remoteBlocks, a lock-free stack other threads push freed blocks onto
+ * and the owner drains when a size class runs dry.
+ */
+struct _GekkotaMemoryArena
 {
-    NULL,
-    { NULL, NULL },
-    { NULL, NULL },
-    0,
-    0
+    GekkotaMemoryChunk          *chunks;
+    GekkotaMemorySizeClass      sizeClasses[GEKKOTA_MEMORY_SIZE_CLASS_COUNT];
+    size_t                      sizeClassCount;
+    GekkotaMemoryRegion         *regions;
+    size_t                      regionCount;
+    size_t                      regionMapSize;
+    size_t                      regionShift;
+    size_t                      chunkSize;
+    size_t                      blockSize;
+    uint32_t                    blockCount;
+    GekkotaMemoryBlock * volatile remoteBlocks;
 };
 
-int32_t
-gekkota_memory_initialize(size_t blockSize, uint32_t blockCount)
+/*
+ * The 1536-byte class leaves room for an MTU-sized payload plus the
+ * bookkeeping that usually travels with it.
+ */
+static const size_t sizeClasses[GEKKOTA_MEMORY_SIZE_CLASS_COUNT] =
 {
-    uint32_t i;
+    32, 64, 128, 256, 512, 1536, 4096
+};
 
-    if (gekkota_memory_is_initialized())
-    {
-        errno = GEKKOTA_ERROR_MEMORY_ALREADY_INITIALIZED;
-        return -1;
-    }
+static GekkotaMemoryArena fastHeap;
+static GEKKOTA_THREAD_LOCAL GekkotaMemoryArena *currentArena = NULL;
 
-    fastHeap.blockSize = blockSize > 0
-        ? blockSize
-        : GEKKOTA_MEMORY_DEFAULT_BLOCK_SIZE;
+/*
+ * The chunks of all arenas, sorted by address. Arenas find their own
+ * memory through their region map; the registry is only looked up for
+ * memory the arena at hand does not own, so that memory of other arenas
+ * goes back to its owner and only memory that really came from malloc is
+ * given back to it. Writers serialize on a spin lock and bump the sequence
+ * number before and after each change, while readers take no lock and
+ * just retry when the sequence number moved under them; outgrown
+ * registries are kept until the last chunk goes away, since readers might
+ * still be looking at them.
+ */
+static GekkotaMemoryRegistry * volatile registry = NULL;
+static volatile uint32_t registrySequence = 0;
+static void_t * volatile registryLock = NULL;
 
-    fastHeap.blockCount = blockCount > 0
-        ? blockCount
-        : GEKKOTA_MEMORY_DEFAULT_BLOCK_COUNT;
+static void_t *
+_gekkota_memory_alloc(GekkotaMemoryArena *arena, size_t size, bool_t initialize);
 
-    if ((fastHeap.memory = malloc(
-        fastHeap.blockCount * (fastHeap.blockSize + sizeof(GekkotaListNode)))) == NULL)
-    {
-        errno = GEKKOTA_ERROR_OUT_OF_MEMORY;
-        return -1;
-    }
+static void_t
+_gekkota_memory_drain(GekkotaMemoryArena *arena);
 
-    gekkota_list_clear(&fastHeap.allocatedBlocks);
-    gekkota_list_clear(&fastHeap.freeBlocks);
+static GekkotaMemoryChunk *
+_gekkota_memory_find_chunk(const GekkotaMemoryArena *arena, const void_t *memory);
 
-    for (i = 0; i < fastHeap.blockCount; i++)
-    {
-        GekkotaListIterator iterator = (GekkotaListIterator)
-            ((byte_t *) fastHeap.memory + i * (fastHeap.blockSize + sizeof(GekkotaListNode)));
+static GekkotaMemoryArena *
+_gekkota_memory_find_owner(const void_t *memory, size_t *sizeClass);
+
+static size_t
+_gekkota_memory_find_registered_chunk(const GekkotaMemoryRegistry *snapshot, const void_t *memory);
+
+static GekkotaMemoryRegion *
+_gekkota_memory_find_region(GekkotaMemoryRegion *regions, size_t regionMapSize, uintptr_t region);
+
+static void_t
+_gekkota_memory_free(GekkotaMemoryArena *arena, void_t *memory);
+
+static void_t
+_gekkota_memory_free_foreign(void_t *memory);
+
+static size_t
+_gekkota_memory_get_size_class(const GekkotaMemoryArena *arena, size_t size);
+
+static int32_t
+_gekkota_memory_grow(GekkotaMemoryArena *arena, size_t sizeClass);
+
+static int32_t
+_gekkota_memory_initialize(GekkotaMemoryArena *arena, size_t blockSize, uint32_t blockCount);
+
+static int32_t
+_gekkota_memory_map_chunk(GekkotaMemoryArena *arena, GekkotaMemoryChunk *chunk);
+
+static int32_t
+_gekkota_memory_register_chunk(GekkotaMemoryChunk *chunk);
+
+static void_t
+_gekkota_memory_unregister_chunk(GekkotaMemoryChunk *chunk);
+
+static void_t
+_gekkota_memory_uninitialize(GekkotaMemoryArena *arena);
+
+#define _gekkota_memory_get_arena() \
+    (currentArena != NULL ? currentArena : &fastHeap)
+
+#define _gekkota_memory_is_initialized(arena) \
+    ((arena)->sizeClassCount > 0)
+
+#define _gekkota_memory_lock_registry() \
+    while (!_gekkota_memory_compare_and_swap(&registryLock, NULL, (void_t *) &registryLock))
 
-        gekkota_list_add(&fastHeap.freeBlocks, iterator);
+#define _gekkota_memory_unlock_registry() \
+    _gekkota_memory_release(&registryLock)
+
+int32_t
+gekkota_memory_initialize(size_t blockSize, uint32_t blockCount)
+{
+    if (gekkota_memory_is_initialized())
+    {
+        errno = GEKKOTA_ERROR_MEMORY_ALREADY_INITIALIZED;
+        return -1;
     }
 
-    return 0;
+    return _gekkota_memory_initialize(&fastHeap, blockSize, blockCount);
 }
 
 int32_t
@@ -83,82 +229,137 @@ gekkota_memory_uninitialize(void_t)
         return -1;
     }
 
-    free(fastHeap.memory);
-    memset(&fastHeap, 0x00, sizeof(GekkotaFastHeap));
+    _gekkota_memory_uninitialize(&fastHeap);
     return 0;
 }
 
 bool_t
 gekkota_memory_is_initialized()
 {
-    return fastHeap.memory != NULL;
+    return _gekkota_memory_is_initialized(&fastHeap);
 }
 
 size_t
 gekkota_memory_get_block_size(void_t)
 {
-    if (!gekkota_memory_is_initialized())
+    GekkotaMemoryArena *arena = _gekkota_memory_get_arena();
+
+    if (!_gekkota_memory_is_initialized(arena))
     {
         errno = GEKKOTA_ERROR_MEMORY_NOT_INITIALIZED;
         return 0;
     }
 
-    return fastHeap.blockSize;
+    return arena->blockSize;
 }
 
 uint32_t
 gekkota_memory_get_block_count(void_t)
 {
-    if (!gekkota_memory_is_initialized())
+    GekkotaMemoryArena *arena = _gekkota_memory_get_arena();
+
+    if (!_gekkota_memory_is_initialized(arena))
     {
         errno = GEKKOTA_ERROR_MEMORY_NOT_INITIALIZED;
         return 0;
     }
 
-    return fastHeap.blockCount;
+    return arena->blockCount;
 }
 
-void_t *
-gekkota_memory_alloc(size_t size, bool_t initialize)
+GekkotaMemoryArena *
+gekkota_memory_get_arena(void_t)
 {
-    void_t *memory;
+    return currentArena;
+}
 
-    if (!gekkota_memory_is_initialized())
+GekkotaMemoryArena *
+gekkota_memory_set_arena(GekkotaMemoryArena *arena)
+{
+    GekkotaMemoryArena *previousArena = currentArena;
+
+    currentArena = arena;
+    return previousArena;
+}
+
+GekkotaMemoryArena *
+gekkota_memory_arena_new(size_t blockSize, uint32_t blockCount)
+{
+    GekkotaMemoryArena *arena;
+
+    if ((arena = calloc(1, sizeof(GekkotaMemoryArena))) == NULL)
     {
-        errno = GEKKOTA_ERROR_MEMORY_NOT_INITIALIZED;
+        errno = GEKKOTA_ERROR_OUT_OF_MEMORY;
         return NULL;
     }
 
-    if (size < 1)
+    if (_gekkota_memory_initialize(arena, blockSize, blockCount) != 0)
     {
-        errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
+        free(arena);
         return NULL;
     }
 
-    if (size > fastHeap.blockSize || gekkota_list_is_empty(&fastHeap.freeBlocks))
-    {
-        memory = malloc(size);
-    }
+    return arena;
+}
+
+void_t
+gekkota_memory_arena_destroy(GekkotaMemoryArena *arena)
+{
+    if (arena == NULL)
+        return;
+
+    if (currentArena == arena)
+        currentArena = NULL;
+
+    _gekkota_memory_uninitialize(arena);
+    free(arena);
+}
+
+void_t
+gekkota_memory_arena_free(GekkotaMemoryArena *arena, void_t *memory)
+{
+    if (memory == NULL)
+        return;
+
+    /*
+     * [arena] is where [memory] is expected to come from; the actual owner
+     * is looked up anyway, so that a wrong guess never corrupts a heap.
+     */
+    if (arena == currentArena)
+        gekkota_memory_free(memory);
     else
+        _gekkota_memory_free_foreign(memory);
+}
+
+void_t *
+gekkota_memory_alloc(size_t size, bool_t initialize)
+{
+    GekkotaMemoryArena *arena = _gekkota_memory_get_arena();
+
+    if (!_gekkota_memory_is_initialized(arena))
     {
-        memory = gekkota_list_remove(gekkota_list_first(&fastHeap.freeBlocks));
-        gekkota_list_add(&fastHeap.allocatedBlocks, memory);
+        errno = GEKKOTA_ERROR_MEMORY_NOT_INITIALIZED;
+        return NULL;
     }
 
-    memory = (void_t *) ((byte_t *) memory + sizeof(GekkotaListNode));
-
-    if (initialize)
-        memset(memory, 0x00, size);
+    if (size < 1)
+    {
+        errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
+        return NULL;
+    }
 
-    return memory;
+    return _gekkota_memory_alloc(arena, size, initialize);
 }
 
 void_t *
 gekkota_memory_realloc(void_t *memory, size_t newSize, bool_t initialize)
 {
-    size_t memorySize;
+    GekkotaMemoryArena *arena = _gekkota_memory_get_arena();
+    GekkotaMemoryChunk *chunk;
+    void_t *newMemory;
+    size_t blockSize, sizeClass;
 
-    if (!gekkota_memory_is_initialized())
+    if (!_gekkota_memory_is_initialized(arena))
     {
         errno = GEKKOTA_ERROR_MEMORY_NOT_INITIALIZED;
         return NULL;
@@ -176,48 +377,525 @@ gekkota_memory_realloc(void_t *memory, size_t newSize, bool_t initialize)
         return NULL;
     }
 
-    memorySize = fastHeap.blockCount * (fastHeap.blockSize + sizeof(GekkotaListNode));
-
-    if (fastHeap.memory < memory && memory < (void_t *) ((byte_t *) fastHeap.memory + memorySize))
+    if ((chunk = _gekkota_memory_find_chunk(arena, memory)) == NULL)
     {
-        if (newSize > fastHeap.blockSize)
+        if (_gekkota_memory_find_owner(memory, &sizeClass) == NULL)
         {
-            GekkotaListIterator iterator = (GekkotaListIterator) ((byte_t *) memory - sizeof(GekkotaListNode));
-            gekkota_list_add(&fastHeap.freeBlocks, gekkota_list_remove(iterator));
-
-            if ((memory = malloc(newSize)) == NULL)
+            /*
+             * Memory served by malloc stays with malloc; how large it is
+             * depends on the arena it was requested from, so it cannot be
+             * copied into a block safely.
+             */
+            if ((newMemory = realloc(memory, newSize)) == NULL)
+            {
                 errno = GEKKOTA_ERROR_OUT_OF_MEMORY;
+                return NULL;
+            }
         }
+        else
+        {
+            /*
+             * The memory belongs to another arena, which gets it back.
+             */
+            if ((newMemory = _gekkota_memory_alloc(arena, newSize, FALSE)) == NULL)
+                return NULL;
+
+            memcpy(newMemory, memory, gekkota_utils_min(sizeClasses[sizeClass], newSize));
+            _gekkota_memory_free_foreign(memory);
+        }
+    }
+    else if (newSize > (blockSize = arena->sizeClasses[chunk->sizeClass].blockSize))
+    {
+        if ((newMemory = _gekkota_memory_alloc(arena, newSize, FALSE)) == NULL)
+            return NULL;
+
+        memcpy(newMemory, memory, blockSize);
+        _gekkota_memory_free(arena, memory);
     }
     else
     {
-        if ((memory = realloc(memory, newSize)) == NULL)
-            errno = GEKKOTA_ERROR_OUT_OF_MEMORY;
+        newMemory = memory;
     }
 
     if (initialize)
-        memset(memory, 0x00, newSize);
+        memset(newMemory, 0x00, newSize);
 
-    return memory;
+    return newMemory;
 }
 
 void_t
 gekkota_memory_free(void_t *memory)
 {
-    size_t memorySize;
+    GekkotaMemoryArena *arena = _gekkota_memory_get_arena();
 
-    if (!gekkota_memory_is_initialized() || memory == NULL)
+    if (memory == NULL)
         return;
 
-    memorySize = fastHeap.blockCount * (fastHeap.blockSize + sizeof(GekkotaListNode));
+    if (_gekkota_memory_is_initialized(arena))
+        _gekkota_memory_free(arena, memory);
+    else
+        _gekkota_memory_free_foreign(memory);
+}
 
-    if (fastHeap.memory < memory && memory < (void_t *) ((byte_t *) fastHeap.memory + memorySize))
+static void_t *
+_gekkota_memory_alloc(GekkotaMemoryArena *arena, size_t size, bool_t initialize)
+{
+    GekkotaMemoryBlock *block;
+    size_t sizeClass;
+
+    if ((sizeClass = _gekkota_memory_get_size_class(arena, size)) == GEKKOTA_MEMORY_SIZE_CLASS_NONE)
     {
-        GekkotaListIterator iterator = (GekkotaListIterator) ((byte_t *) memory - sizeof(GekkotaListNode));
-        gekkota_list_add(&fastHeap.freeBlocks, gekkota_list_remove(iterator));
+        if ((block = malloc(size)) == NULL)
+        {
+            errno = GEKKOTA_ERROR_OUT_OF_MEMORY;
+            return NULL;
+        }
     }
     else
+    {
+        if (arena->sizeClasses[sizeClass].freeBlocks == NULL)
+        {
+            if (arena->remoteBlocks != NULL)
+                _gekkota_memory_drain(arena);
+
+            if (arena->sizeClasses[sizeClass].freeBlocks == NULL
+                    && _gekkota_memory_grow(arena, sizeClass) != 0)
+                return NULL;
+        }
+
+        block = arena->sizeClasses[sizeClass].freeBlocks;
+        arena->sizeClasses[sizeClass].freeBlocks = block->next;
+    }
+
+    if (initialize)
+        memset(block, 0x00, size);
+
+    return block;
+}
+
+static void_t
+_gekkota_memory_drain(GekkotaMemoryArena *arena)
+{
+    GekkotaMemoryBlock *block, *nextBlock;
+
+    for (block = _gekkota_memory_exchange(&arena->remoteBlocks, NULL);
+            block != NULL; block = nextBlock)
+    {
+        nextBlock = block->next;
+        _gekkota_memory_free(arena, block);
+    }
+}
+
+static GekkotaMemoryChunk *
+_gekkota_memory_find_chunk(const GekkotaMemoryArena *arena, const void_t *memory)
+{
+    GekkotaMemoryRegion *region;
+    GekkotaMemoryChunk *chunk;
+    size_t i;
+
+    region = _gekkota_memory_find_region(arena->regions, arena->regionMapSize,
+        ((uintptr_t) memory >> arena->regionShift) + 1);
+
+    if (region->region == 0)
+        return NULL;
+
+    for (i = 0; i < 2; i++)
+    {
+        chunk = region->chunks[i];
+
+        if (chunk != NULL && (const byte_t *) memory >= (const byte_t *) (chunk + 1)
+                && (const byte_t *) memory < chunk->end)
+            return chunk;
+    }
+
+    return NULL;
+}
+
+static GekkotaMemoryArena *
+_gekkota_memory_find_owner(const void_t *memory, size_t *sizeClass)
+{
+    const GekkotaMemoryRegistry *snapshot;
+    GekkotaMemoryArena *owner;
+    uint32_t sequence;
+    size_t i;
+
+    do
+    {
+        /*
+         * Wait for a writer at work, if any, to be done.
+         */
+        while ((sequence = registrySequence) & 1);
+
+        _gekkota_memory_barrier();
+        owner = NULL;
+
+        if ((snapshot = registry) != NULL &&
+                (i = _gekkota_memory_find_registered_chunk(snapshot, memory)) < snapshot->chunkCount)
+        {
+            owner = snapshot->chunks[i].arena;
+            *sizeClass = snapshot->chunks[i].sizeClass;
+        }
+
+        _gekkota_memory_barrier();
+    }
+    while (registrySequence != sequence);
+
+    return owner;
+}
+
+static size_t
+_gekkota_memory_find_registered_chunk(const GekkotaMemoryRegistry *snapshot, const void_t *memory)
+{
+    size_t low = 0, high = snapshot->chunkCount, middle;
+
+    /*
+     * Find the last chunk starting at or before [memory].
+     */
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+
+        if (snapshot->chunks[middle].start <= (const byte_t *) memory)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if (low > 0 && (const byte_t *) memory < snapshot->chunks[low - 1].end)
+        return low - 1;
+
+    return snapshot->chunkCount;
+}
+
+static GekkotaMemoryRegion *
+_gekkota_memory_find_region(GekkotaMemoryRegion *regions, size_t regionMapSize, uintptr_t region)
+{
+    size_t i;
+
+    /*
+     * Region 0 is never used, so it marks an empty slot; the map is never
+     * more than half full, so probing always ends.
+     */
+    for (i = region & (regionMapSize - 1);
+            regions[i].region != 0 && regions[i].region != region;
+            i = (i + 1) & (regionMapSize - 1));
+
+    return &regions[i];
+}
+
+static void_t
+_gekkota_memory_free(GekkotaMemoryArena *arena, void_t *memory)
+{
+    GekkotaMemoryChunk *chunk;
+    GekkotaMemoryBlock *block;
+
+    if ((chunk = _gekkota_memory_find_chunk(arena, memory)) == NULL)
+    {
+        _gekkota_memory_free_foreign(memory);
+        return;
+    }
+
+    block = (GekkotaMemoryBlock *) memory;
+    block->next = arena->sizeClasses[chunk->sizeClass].freeBlocks;
+    arena->sizeClasses[chunk->sizeClass].freeBlocks = block;
+}
+
+static void_t
+_gekkota_memory_free_foreign(void_t *memory)
+{
+    GekkotaMemoryArena *owner;
+    GekkotaMemoryBlock *block;
+    size_t sizeClass;
+
+    if ((owner = _gekkota_memory_find_owner(memory, &sizeClass)) == NULL)
     {
         free(memory);
+        return;
+    }
+
+    /*
+     * Memory that belongs to another arena is handed back to its owner,
+     * which sorts it out the next time it runs out of blocks.
+     */
+    block = (GekkotaMemoryBlock *) memory;
+
+    do
+        block->next = owner->remoteBlocks;
+    while (!_gekkota_memory_compare_and_swap(&owner->remoteBlocks, block->next, block));
+}
+
+static size_t
+_gekkota_memory_get_size_class(const GekkotaMemoryArena *arena, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < arena->sizeClassCount; i++)
+        if (size <= arena->sizeClasses[i].blockSize)
+            return i;
+
+    return GEKKOTA_MEMORY_SIZE_CLASS_NONE;
+}
+
+static int32_t
+_gekkota_memory_grow(GekkotaMemoryArena *arena, size_t sizeClass)
+{
+    GekkotaMemoryChunk *chunk;
+    GekkotaMemoryBlock *block;
+    size_t blockSize, blockCount, i;
+
+    blockSize = arena->sizeClasses[sizeClass].blockSize;
+    blockCount = arena->chunkSize / blockSize;
+
+    if ((chunk = malloc(sizeof(GekkotaMemoryChunk) + blockCount * blockSize)) == NULL)
+    {
+        errno = GEKKOTA_ERROR_OUT_OF_MEMORY;
+        return -1;
     }
-}
\ No newline at end of file
+
+    chunk->arena = arena;
+    chunk->sizeClass = sizeClass;
+    chunk->end = (byte_t *) (chunk + 1) + blockCount * blockSize;
+
+    if (_gekkota_memory_register_chunk(chunk) != 0)
+    {
+        free(chunk);
+        return -1;
+    }
+
+    if (_gekkota_memory_map_chunk(arena, chunk) != 0)
+    {
+        _gekkota_memory_unregister_chunk(chunk);
+        free(chunk);
+        return -1;
+    }
+
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+
+    /*
+     * Thread the new blocks onto the free list so that they are handed out
+     * in address order.
+     */
+    for (i = blockCount; i > 0; i--)
+    {
+        block = (GekkotaMemoryBlock *) ((byte_t *) (chunk + 1) + (i - 1) * blockSize);
+        block->next = arena->sizeClasses[sizeClass].freeBlocks;
+        arena->sizeClasses[sizeClass].freeBlocks = block;
+    }
+
+    return 0;
+}
+
+static int32_t
+_gekkota_memory_initialize(GekkotaMemoryArena *arena, size_t blockSize, uint32_t blockCount)
+{
+    size_t i;
+
+    if (blockSize < 1)
+        blockSize = GEKKOTA_MEMORY_DEFAULT_BLOCK_SIZE;
+
+    arena->blockCount = blockCount > 0
+        ? blockCount
+        : GEKKOTA_MEMORY_DEFAULT_BLOCK_COUNT;
+
+    if ((arena->regions = calloc(GEKKOTA_MEMORY_REGION_MAP_SIZE, sizeof(GekkotaMemoryRegion))) == NULL)
+    {
+        errno = GEKKOTA_ERROR_OUT_OF_MEMORY;
+        return -1;
+    }
+
+    arena->regionCount = 0;
+    arena->regionMapSize = GEKKOTA_MEMORY_REGION_MAP_SIZE;
+    arena->chunks = NULL;
+    arena->remoteBlocks = NULL;
+    arena->sizeClassCount = 0;
+
+    /*
+     * Pool every size class up to the requested block size; anything
+     * larger is served by malloc.
+     */
+    for (i = 0; i < GEKKOTA_MEMORY_SIZE_CLASS_COUNT; i++)
+    {
+        arena->sizeClasses[i].freeBlocks = NULL;
+        arena->sizeClasses[i].blockSize = sizeClasses[i];
+
+        if (arena->sizeClassCount == 0 || sizeClasses[i] <= blockSize)
+            arena->sizeClassCount = i + 1;
+    }
+
+    arena->blockSize = arena->sizeClasses[arena->sizeClassCount - 1].blockSize;
+    arena->chunkSize = arena->blockCount * arena->blockSize;
+
+    /*
+     * The blocks of a chunk never cover less than half of it, so regions
+     * of at most half a chunk never overlap more than two chunks.
+     */
+    for (arena->regionShift = 1;
+            ((size_t) 1 << (arena->regionShift + 1)) <= arena->chunkSize / 2;
+            arena->regionShift++);
+
+    return 0;
+}
+
+static int32_t
+_gekkota_memory_map_chunk(GekkotaMemoryArena *arena, GekkotaMemoryChunk *chunk)
+{
+    GekkotaMemoryRegion *regions, *region;
+    uintptr_t first, last;
+    size_t i;
+
+    first = ((uintptr_t) (chunk + 1) >> arena->regionShift) + 1;
+    last = ((uintptr_t) (chunk->end - 1) >> arena->regionShift) + 1;
+
+    /*
+     * Grow the map beforehand so that it stays at most half full.
+     */
+    while ((arena->regionCount + (last - first + 1)) * 2 > arena->regionMapSize)
+    {
+        if ((regions = calloc(arena->regionMapSize * 2, sizeof(GekkotaMemoryRegion))) == NULL)
+        {
+            errno = GEKKOTA_ERROR_OUT_OF_MEMORY;
+            return -1;
+        }
+
+        for (i = 0; i < arena->regionMapSize; i++)
+            if (arena->regions[i].region != 0)
+                *_gekkota_memory_find_region(regions, arena->regionMapSize * 2,
+                    arena->regions[i].region) = arena->regions[i];
+
+        free(arena->regions);
+        arena->regions = regions;
+        arena->regionMapSize *= 2;
+    }
+
+    for (; first <= last; first++)
+    {
+        region = _gekkota_memory_find_region(arena->regions, arena->regionMapSize, first);
+
+        if (region->region == 0)
+        {
+            region->region = first;
+            arena->regionCount++;
+        }
+
+        region->chunks[region->chunks[0] == NULL ? 0 : 1] = chunk;
+    }
+
+    return 0;
+}
+
+static void_t
+_gekkota_memory_uninitialize(GekkotaMemoryArena *arena)
+{
+    GekkotaMemoryChunk *chunk;
+
+    /*
+     * Blocks freed by other threads all belong to the chunks going away.
+     */
+    while ((chunk = arena->chunks) != NULL)
+    {
+        arena->chunks = chunk->next;
+        _gekkota_memory_unregister_chunk(chunk);
+        free(chunk);
+    }
+
+    free(arena->regions);
+    memset(arena, 0x00, sizeof(GekkotaMemoryArena));
+}
+
+static int32_t
+_gekkota_memory_register_chunk(GekkotaMemoryChunk *chunk)
+{
+    GekkotaMemoryRegistry *newRegistry;
+    size_t capacity, i;
+
+    _gekkota_memory_lock_registry();
+
+    /*
+     * A full registry is replaced rather than reallocated, since readers
+     * might be looking at it.
+     */
+    if (registry == NULL || registry->chunkCount == registry->chunkCapacity)
+    {
+        capacity = registry != NULL ? registry->chunkCapacity * 2 : 64;
+
+        if ((newRegistry = malloc(sizeof(GekkotaMemoryRegistry) +
+                capacity * sizeof(GekkotaMemoryRegisteredChunk))) == NULL)
+        {
+            _gekkota_memory_unlock_registry();
+            errno = GEKKOTA_ERROR_OUT_OF_MEMORY;
+            return -1;
+        }
+
+        newRegistry->retired = registry;
+        newRegistry->chunkCount = 0;
+        newRegistry->chunkCapacity = capacity;
+
+        if (registry != NULL)
+        {
+            memcpy(newRegistry->chunks, registry->chunks,
+                    registry->chunkCount * sizeof(GekkotaMemoryRegisteredChunk));
+            newRegistry->chunkCount = registry->chunkCount;
+        }
+    }
+    else
+        newRegistry = registry;
+
+    ++registrySequence;
+    _gekkota_memory_barrier();
+
+    registry = newRegistry;
+
+    for (i = registry->chunkCount;
+            i > 0 && registry->chunks[i - 1].start > (const byte_t *) (chunk + 1); i--)
+        registry->chunks[i] = registry->chunks[i - 1];
+
+    registry->chunks[i].start = (const byte_t *) (chunk + 1);
+    registry->chunks[i].end = chunk->end;
+    registry->chunks[i].arena = chunk->arena;
+    registry->chunks[i].sizeClass = chunk->sizeClass;
+    registry->chunkCount++;
+
+    _gekkota_memory_barrier();
+    ++registrySequence;
+
+    _gekkota_memory_unlock_registry();
+    return 0;
+}
+
+static void_t
+_gekkota_memory_unregister_chunk(GekkotaMemoryChunk *chunk)
+{
+    GekkotaMemoryRegistry *retired;
+    size_t i;
+
+    _gekkota_memory_lock_registry();
+
+    ++registrySequence;
+    _gekkota_memory_barrier();
+
+    if ((i = _gekkota_memory_find_registered_chunk(registry, chunk + 1)) < registry->chunkCount)
+    {
+        memmove(&registry->chunks[i], &registry->chunks[i + 1],
+                (registry->chunkCount - i - 1) * sizeof(GekkotaMemoryRegisteredChunk));
+        registry->chunkCount--;
+    }
+
+    /*
+     * With the last chunk gone no memory can be looked up anymore.
+     */
+    if (registry->chunkCount == 0)
+    {
+        while (registry != NULL)
+        {
+            retired = registry->retired;
+            free(registry);
+            registry = retired;
+        }
+    }
+
+    _gekkota_memory_barrier();
+    ++registrySequence;
+
+    _gekkota_memory_unlock_registry();
+}
@@ -12,11 +12,24 @@
 
 #include "gekkota/gekkota_types.h"
 
-#define GEKKOTA_MEMORY_DEFAULT_BLOCK_SIZE 256
-#define GEKKOTA_MEMORY_DEFAULT_BLOCK_COUNT 100
+/*
+ * Memory is pooled in size classes up to the block size; each size class
+ * grows as needed by chunks as large as block count blocks of block size.
+ */
+#define GEKKOTA_MEMORY_DEFAULT_BLOCK_SIZE 4096
+#define GEKKOTA_MEMORY_DEFAULT_BLOCK_COUNT 64
+
+/*
+ * An arena is a heap of its own that can be attached to a thread; while
+ * attached, it serves every allocation the thread makes through this API
+ * without locking. Threads with no arena attached share the heap set up
+ * by gekkota_memory_initialize. Memory may be freed or reallocated on any
+ * thread: blocks of another arena are handed back to it.
+ */
+typedef struct _GekkotaMemoryArena GekkotaMemoryArena;
 
 GEKKOTA_API int32_t
-gekkota_memory_initialize(size_t blockSize, uint32_t initialBlockCount);
+gekkota_memory_initialize(size_t blockSize, uint32_t blockCount);
 
 GEKKOTA_API int32_t
 gekkota_memory_uninitialize(void_t);
@@ -30,6 +43,21 @@ gekkota_memory_get_block_size(void_t);
 GEKKOTA_API uint32_t
 gekkota_memory_get_block_count(void_t);
 
+GEKKOTA_API GekkotaMemoryArena *
+gekkota_memory_get_arena(void_t);
+
+GEKKOTA_API GekkotaMemoryArena *
+gekkota_memory_set_arena(GekkotaMemoryArena *arena);
+
+GEKKOTA_API GekkotaMemoryArena *
+gekkota_memory_arena_new(size_t blockSize, uint32_t blockCount);
+
+GEKKOTA_API void_t
+gekkota_memory_arena_destroy(GekkotaMemoryArena *arena);
+
+GEKKOTA_API void_t
+gekkota_memory_arena_free(GekkotaMemoryArena *arena, void_t *memory);
+
 GEKKOTA_API void_t *
 gekkota_memory_alloc(size_t size, bool_t initialize);
 
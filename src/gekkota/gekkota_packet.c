@@ -8,10 +8,82 @@
  ******************************************************************************/
 
 #include <errno.h>
+#include <string.h>
 #include "gekkota_errors.h"
 #include "gekkota_memory.h"
 #include "gekkota_packet.h"
 
+#ifdef WIN32
+#include <windows.h>
+#endif /* WIN32 */
+
+#ifdef WIN32
+#define _gekkota_packet_increment(pointer) \
+    ((uint32_t) InterlockedIncrement((LONG volatile *) (pointer)))
+#define _gekkota_packet_decrement(pointer) \
+    ((uint32_t) InterlockedDecrement((LONG volatile *) (pointer)))
+#define _gekkota_packet_compare_and_swap(pointer, oldValue, newValue) \
+    (InterlockedCompareExchangePointer((PVOID volatile *) (pointer), (newValue), (oldValue)) == (oldValue))
+#define _gekkota_packet_exchange(pointer, value) \
+    InterlockedExchangePointer((PVOID volatile *) (pointer), (value))
+#define _gekkota_packet_barrier() \
+    MemoryBarrier()
+#else
+#define _gekkota_packet_increment(pointer) \
+    __sync_add_and_fetch((pointer), 1)
+#define _gekkota_packet_decrement(pointer) \
+    __sync_sub_and_fetch((pointer), 1)
+#define _gekkota_packet_compare_and_swap(pointer, oldValue, newValue) \
+    __sync_bool_compare_and_swap((pointer), (oldValue), (newValue))
+#define _gekkota_packet_exchange(pointer, value) \
+    __sync_lock_test_and_set((pointer), (value))
+#define _gekkota_packet_barrier() \
+    __sync_synchronize()
+#endif /* WIN32 */
+
+/*
+ * Packets of a pool all have the same size; destroyed packets are kept
+ * for reuse until the pool itself is destroyed, after which they are
+ * freed as they come back.
+ *
+ * Only the thread owning the pool takes packets from it, but they may be
+ * destroyed on any thread: they are pushed onto [remotePackets] without
+ * locking and moved to [freePackets] by the owner when it runs out.
+ */
+struct _GekkotaPacketPool
+{
+    GekkotaPacket       *freePackets;
+    GekkotaPacket       * volatile remotePackets;
+    size_t              packetSize;
+    volatile uint32_t   packetCount;        /* packets not freed yet, plus */
+                                            /* one for the pool itself */
+    volatile bool_t     isDestroyed;
+    GekkotaMemoryArena  *arena;
+};
+
+static void_t
+_gekkota_packet_free(GekkotaPacket *packet);
+
+static void_t
+_gekkota_packet_release_data(GekkotaPacket *packet);
+
+static void_t
+_gekkota_packet_gather(const GekkotaPacket *packet, byte_t *data);
+
+static bool_t
+_gekkota_packet_equals_data(
+        const GekkotaPacket *packet,
+        const GekkotaPacket *value);
+
+static int32_t
+_gekkota_packet_resize(GekkotaPacket *restrict packet, size_t newSize);
+
+static void_t
+_gekkota_packet_pool_put(GekkotaPacketPool *pool, GekkotaPacket *packet);
+
+static void_t
+_gekkota_packet_pool_free_remote(GekkotaPacketPool *pool);
+
 GekkotaPacket *
 gekkota_packet_new(size_t size)
 {
@@ -35,6 +107,13 @@ gekkota_packet_new(size_t size)
 
     packet->flags = GEKKOTA_PACKET_FLAG_NONE;
     packet->refCount = 1;
+    packet->arena = gekkota_memory_get_arena();
+    packet->source = NULL;
+    packet->pool = NULL;
+    packet->headroom = 0;
+    packet->segments = NULL;
+    packet->segmentCount = 0;
+    packet->isForeign = FALSE;
 
     return packet;
 }
@@ -52,14 +131,25 @@ gekkota_packet_new_0(GekkotaPacket *packet, bool_t deep)
     {
         GekkotaPacket *newPacket;
 
-        if ((newPacket = gekkota_packet_new(packet->data.length)) == NULL)
+        /*
+         * The segments of a segmented packet are gathered into the buffer
+         * of the copy, so that the packet itself is left as it is.
+         */
+        if ((newPacket = packet->headroom > 0
+                ? gekkota_packet_new_with_headroom(packet->data.length, packet->flags)
+                : gekkota_packet_new(packet->data.length)) == NULL)
+            return NULL;
+
+        if (gekkota_packet_copy(newPacket, packet) != 0)
+        {
+            gekkota_packet_destroy(newPacket);
             return NULL;
-        
-        gekkota_packet_copy(newPacket, packet);
+        }
+
         return newPacket;
     }
 
-    ++packet->refCount;
+    _gekkota_packet_increment(&packet->refCount);
     return packet;
 }
 
@@ -106,22 +196,193 @@ gekkota_packet_new_2(const GekkotaBuffer *data, GekkotaPacketFlag flags)
     return packet;
 }
 
+GekkotaPacket *
+gekkota_packet_new_3(
+        const GekkotaBuffer *segments,
+        uint16_t segmentCount,
+        GekkotaPacketFlag flags,
+        GekkotaPacketReleaseCallback release,
+        void_t *userData)
+{
+    GekkotaPacket *packet;
+    size_t length = 0;
+    uint16_t i;
+
+    if (segments == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return NULL;
+    }
+
+    if (segmentCount == 0 || segmentCount > GEKKOTA_PACKET_MAX_SEGMENTS)
+    {
+        errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
+        return NULL;
+    }
+
+    for (i = 0; i < segmentCount; i++)
+    {
+        if (segments[i].data == NULL)
+        {
+            errno = GEKKOTA_ERROR_NULL_BUFFER;
+            return NULL;
+        }
+
+        length += segments[i].length;
+    }
+
+    if (length == 0)
+    {
+        errno = GEKKOTA_ERROR_ZERO_LENGTH_BUFFER;
+        return NULL;
+    }
+
+    if ((packet = gekkota_memory_alloc(sizeof(GekkotaPacket), FALSE)) == NULL)
+        return NULL;
+
+    if ((packet->segments = gekkota_memory_alloc(
+            sizeof(GekkotaBuffer) * segmentCount, FALSE)) == NULL)
+    {
+        gekkota_memory_free(packet);
+        return NULL;
+    }
+
+    /*
+     * The application buffers are referenced, not copied: [data] only
+     * holds the total length until the packet is flattened.
+     */
+    memcpy(packet->segments, segments, sizeof(GekkotaBuffer) * segmentCount);
+    packet->segmentCount = segmentCount;
+    packet->release = release;
+    packet->userData = userData;
+
+    packet->data.data = NULL;
+    packet->data.length = length;
+    packet->flags = flags;
+    packet->refCount = 1;
+    packet->arena = gekkota_memory_get_arena();
+    packet->source = NULL;
+    packet->pool = NULL;
+    packet->headroom = 0;
+    packet->isForeign = FALSE;
+
+    return packet;
+}
+
+GekkotaPacket *
+gekkota_packet_new_4(
+        const GekkotaBuffer *data,
+        GekkotaPacketFlag flags,
+        GekkotaPacketReleaseCallback release,
+        void_t *userData)
+{
+    GekkotaPacket *packet;
+
+    if (data == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return NULL;
+    }
+
+    if (data->data == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_BUFFER;
+        return NULL;
+    }
+
+    if (data->length == 0)
+    {
+        errno = GEKKOTA_ERROR_ZERO_LENGTH_BUFFER;
+        return NULL;
+    }
+
+    if ((packet = gekkota_memory_alloc(sizeof(GekkotaPacket), FALSE)) == NULL)
+        return NULL;
+
+    /*
+     * The data is used in place and handed back to the application once
+     * the last reference to the packet goes away, that is when both the
+     * application and every outgoing message have released it.
+     */
+    packet->data = *data;
+    packet->flags = flags;
+    packet->refCount = 1;
+    packet->arena = gekkota_memory_get_arena();
+    packet->source = NULL;
+    packet->pool = NULL;
+    packet->headroom = 0;
+    packet->segments = NULL;
+    packet->segmentCount = 0;
+    packet->release = release;
+    packet->userData = userData;
+    packet->isForeign = TRUE;
+
+    return packet;
+}
+
+GekkotaPacket *
+gekkota_packet_new_with_headroom(size_t size, GekkotaPacketFlag flags)
+{
+    GekkotaPacket *packet;
+    byte_t *memory;
+
+    if (size == 0)
+    {
+        errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
+        return NULL;
+    }
+
+    if ((packet = gekkota_memory_alloc(sizeof(GekkotaPacket), FALSE)) == NULL)
+        return NULL;
+
+    if ((memory = gekkota_memory_alloc(GEKKOTA_PACKET_HEADROOM + size, FALSE)) == NULL)
+    {
+        gekkota_memory_free(packet);
+        return NULL;
+    }
+
+    packet->data.data = memory + GEKKOTA_PACKET_HEADROOM;
+    packet->data.length = size;
+    packet->flags = flags;
+    packet->refCount = 1;
+    packet->arena = gekkota_memory_get_arena();
+    packet->source = NULL;
+    packet->pool = NULL;
+    packet->headroom = GEKKOTA_PACKET_HEADROOM;
+    packet->segments = NULL;
+    packet->segmentCount = 0;
+    packet->isForeign = FALSE;
+
+    return packet;
+}
+
 int32_t
 gekkota_packet_destroy(GekkotaPacket *packet)
 {
+    uint32_t refCount;
+
     if (packet == NULL)
     {
         errno = GEKKOTA_ERROR_NULL_ARGUMENT;
         return -1;
     }
 
-    if (--packet->refCount == 0)
+    if ((refCount = _gekkota_packet_decrement(&packet->refCount)) > 0)
+        return (int32_t) refCount;
+
+    if (packet->source != NULL)
     {
-        gekkota_memory_free(packet->data.data);
-        gekkota_memory_free(packet);
+        /*
+         * The data belongs to the source packet, which is released once
+         * every slice of it has been destroyed.
+         */
+        gekkota_packet_destroy(packet->source);
+        gekkota_memory_arena_free(packet->arena, packet);
     }
+    else if (packet->pool != NULL && !packet->pool->isDestroyed)
+        _gekkota_packet_pool_put(packet->pool, packet);
     else
-        return packet->refCount;
+        _gekkota_packet_free(packet);
 
     return 0;
 }
@@ -137,10 +398,26 @@ gekkota_packet_copy(GekkotaPacket *restrict packet, const GekkotaPacket *value)
 
     if (packet != value)
     {
-        if (gekkota_buffer_copy(&packet->data, &value->data) == 0)
-            packet->flags = value->flags;
-        else
+        if (_gekkota_packet_flatten(packet) != 0)
             return -1;
+
+        if (value->segments == NULL)
+        {
+            if (gekkota_buffer_copy(&packet->data, &value->data) != 0)
+                return -1;
+        }
+        else
+        {
+            if (packet->data.length < value->data.length)
+            {
+                errno = GEKKOTA_ERROR_BUFFER_OVERFLOW;
+                return -1;
+            }
+
+            _gekkota_packet_gather(value, packet->data.data);
+        }
+
+        packet->flags = value->flags;
     }
 
     return 0;
@@ -149,13 +426,27 @@ gekkota_packet_copy(GekkotaPacket *restrict packet, const GekkotaPacket *value)
 int32_t
 gekkota_packet_resize(GekkotaPacket *restrict packet, size_t newSize)
 {
+    GekkotaMemoryArena *arena;
+    int32_t rc;
+
     if (packet == NULL)
     {
         errno = GEKKOTA_ERROR_NULL_ARGUMENT;
         return -1;
     }
 
-    return gekkota_buffer_resize(&packet->data, newSize, FALSE);
+    if (_gekkota_packet_flatten(packet) != 0)
+        return -1;
+
+    /*
+     * The data stays in the arena the packet was allocated from, which is
+     * the one it is released to.
+     */
+    arena = gekkota_memory_set_arena(packet->arena);
+    rc = _gekkota_packet_resize(packet, newSize);
+    gekkota_memory_set_arena(arena);
+
+    return rc;
 }
 
 bool_t
@@ -167,8 +458,13 @@ gekkota_packet_equals(const GekkotaPacket *packet, const GekkotaPacket *value)
     if (packet == NULL || value == NULL)
         return FALSE;
 
+    if (packet->segments == NULL && value->segments == NULL)
+        return packet->flags == value->flags &&
+            gekkota_buffer_equals(&packet->data, &value->data);
+
     return packet->flags == value->flags &&
-        gekkota_buffer_equals(&packet->data, &value->data);
+        packet->data.length == value->data.length &&
+        _gekkota_packet_equals_data(packet, value);
 }
 
 GekkotaBuffer *
@@ -180,9 +476,31 @@ gekkota_packet_get_data(const GekkotaPacket *packet)
         return NULL;
     }
 
+    /*
+     * The data of a segmented packet is only available as a whole once it
+     * has been flattened with gekkota_packet_flatten().
+     */
+    if (packet->segments != NULL)
+    {
+        errno = GEKKOTA_ERROR_OPERATION_NOT_VALID;
+        return NULL;
+    }
+
     return (GekkotaBuffer *) &packet->data;
 }
 
+int32_t
+gekkota_packet_flatten(GekkotaPacket *packet)
+{
+    if (packet == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    return _gekkota_packet_flatten(packet);
+}
+
 int32_t
 gekkota_packet_set_data(GekkotaPacket *restrict packet, const GekkotaBuffer *data)
 {
@@ -192,6 +510,9 @@ gekkota_packet_set_data(GekkotaPacket *restrict packet, const GekkotaBuffer *dat
         return -1;
     }
 
+    if (_gekkota_packet_flatten(packet) != 0)
+        return -1;
+
     return gekkota_buffer_copy(&packet->data, data);
 }
 
@@ -231,3 +552,395 @@ gekkota_packet_get_size(const GekkotaPacket *packet)
 
     return packet->data.length;
 }
+
+GekkotaPacket *
+_gekkota_packet_new_slice(
+        GekkotaPacket *source,
+        size_t offset,
+        size_t length,
+        GekkotaPacketFlag flags)
+{
+    GekkotaPacket *packet;
+
+    if ((packet = gekkota_memory_alloc(sizeof(GekkotaPacket), FALSE)) == NULL)
+        return NULL;
+
+    packet->data.data = (byte_t *) source->data.data + offset;
+    packet->data.length = length;
+    packet->flags = flags;
+    packet->refCount = 1;
+    packet->arena = gekkota_memory_get_arena();
+    packet->source = gekkota_packet_new_0(source, FALSE);
+    packet->pool = NULL;
+    packet->headroom = 0;
+    packet->segments = NULL;
+    packet->segmentCount = 0;
+    packet->isForeign = FALSE;
+
+    return packet;
+}
+
+int32_t
+_gekkota_packet_flatten(GekkotaPacket *packet)
+{
+    GekkotaMemoryArena *arena;
+    byte_t *data;
+
+    if (packet->segments == NULL)
+        return 0;
+
+    /*
+     * The packet may be flattened while another arena is current, like
+     * the one of the XUDP host sending it, but its data is released to the
+     * arena the packet was allocated from.
+     */
+    arena = gekkota_memory_set_arena(packet->arena);
+    data = gekkota_memory_alloc(packet->data.length, FALSE);
+    gekkota_memory_set_arena(arena);
+
+    if (data == NULL)
+        return -1;
+
+    _gekkota_packet_gather(packet, data);
+
+    _gekkota_packet_release_data(packet);
+    packet->data.data = data;
+    return 0;
+}
+
+uint16_t
+_gekkota_packet_count_segments(
+        const GekkotaPacket *packet,
+        size_t offset,
+        size_t length)
+{
+    uint16_t i, count = 0;
+
+    if (packet->segments == NULL)
+        return 1;
+
+    for (i = 0; i < packet->segmentCount && length > 0; i++)
+    {
+        if (offset >= packet->segments[i].length)
+        {
+            offset -= packet->segments[i].length;
+            continue;
+        }
+
+        length -= packet->segments[i].length - offset < length
+            ? packet->segments[i].length - offset
+            : length;
+        offset = 0;
+        ++count;
+    }
+
+    return count;
+}
+
+uint16_t
+_gekkota_packet_get_segments(
+        const GekkotaPacket *packet,
+        size_t offset,
+        size_t length,
+        GekkotaBuffer *buffers)
+{
+    GekkotaBuffer *buffer = buffers;
+    uint16_t i;
+
+    if (packet->segments == NULL)
+    {
+        buffer->data = (byte_t *) packet->data.data + offset;
+        buffer->length = length;
+        return 1;
+    }
+
+    /*
+     * Map [offset, offset + length) onto the application buffers.
+     */
+    for (i = 0; i < packet->segmentCount && length > 0; i++)
+    {
+        if (offset >= packet->segments[i].length)
+        {
+            offset -= packet->segments[i].length;
+            continue;
+        }
+
+        buffer->data = (byte_t *) packet->segments[i].data + offset;
+        buffer->length = packet->segments[i].length - offset < length
+            ? packet->segments[i].length - offset
+            : length;
+
+        length -= buffer->length;
+        offset = 0;
+        ++buffer;
+    }
+
+    return (uint16_t) (buffer - buffers);
+}
+
+size_t
+_gekkota_packet_get_pinned_size(const GekkotaPacket *packet)
+{
+    /*
+     * A slice keeps the whole data of its source alive.
+     */
+    while (packet->source != NULL)
+        packet = packet->source;
+
+    return packet->headroom + packet->data.length;
+}
+
+GekkotaPacketPool *
+_gekkota_packet_pool_new(size_t packetSize)
+{
+    GekkotaPacketPool *pool;
+
+    if ((pool = gekkota_memory_alloc(sizeof(GekkotaPacketPool), TRUE)) == NULL)
+        return NULL;
+
+    pool->packetSize = packetSize;
+    pool->packetCount = 1;
+    pool->arena = gekkota_memory_get_arena();
+
+    return pool;
+}
+
+void_t
+_gekkota_packet_pool_destroy(GekkotaPacketPool *pool)
+{
+    GekkotaPacket *packet;
+
+    /*
+     * Packets still referenced somewhere are freed as they come back, and
+     * the last of them frees the pool; the flag is raised before draining
+     * [remotePackets] so that none is left behind.
+     */
+    pool->isDestroyed = TRUE;
+    _gekkota_packet_barrier();
+
+    while ((packet = pool->freePackets) != NULL)
+    {
+        pool->freePackets = packet->source;
+        _gekkota_packet_free(packet);
+    }
+
+    _gekkota_packet_pool_free_remote(pool);
+
+    if (_gekkota_packet_decrement(&pool->packetCount) == 0)
+        gekkota_memory_arena_free(pool->arena, pool);
+}
+
+GekkotaPacket *
+_gekkota_packet_pool_get(GekkotaPacketPool *pool)
+{
+    GekkotaPacket *packet;
+
+    if (pool->freePackets == NULL && pool->remotePackets != NULL)
+        pool->freePackets = _gekkota_packet_exchange(&pool->remotePackets, NULL);
+
+    if ((packet = pool->freePackets) != NULL)
+    {
+        pool->freePackets = packet->source;
+
+        packet->data.length = pool->packetSize;
+        packet->flags = GEKKOTA_PACKET_FLAG_NONE;
+        packet->refCount = 1;
+        packet->source = NULL;
+
+        return packet;
+    }
+
+    if ((packet = gekkota_packet_new(pool->packetSize)) == NULL)
+        return NULL;
+
+    packet->pool = pool;
+    _gekkota_packet_increment(&pool->packetCount);
+
+    return packet;
+}
+
+static void_t
+_gekkota_packet_free(GekkotaPacket *packet)
+{
+    GekkotaPacketPool *pool = packet->pool;
+
+    if (packet->segments != NULL || packet->isForeign)
+    {
+        _gekkota_packet_release_data(packet);
+        gekkota_memory_arena_free(packet->arena, packet);
+        return;
+    }
+
+    /*
+     * The packet might be released on a thread other than the one that
+     * allocated it, so give its memory back to the arena it came from.
+     */
+    gekkota_memory_arena_free(packet->arena,
+            (byte_t *) packet->data.data - packet->headroom);
+    gekkota_memory_arena_free(packet->arena, packet);
+
+    if (pool != NULL && _gekkota_packet_decrement(&pool->packetCount) == 0)
+        gekkota_memory_arena_free(pool->arena, pool);
+}
+
+static void_t
+_gekkota_packet_pool_put(GekkotaPacketPool *pool, GekkotaPacket *packet)
+{
+    GekkotaPacket *remotePackets;
+
+    /*
+     * Keep the pool alive until done with it, since the owner might free
+     * the packet as soon as it has been pushed.
+     */
+    _gekkota_packet_increment(&pool->packetCount);
+
+    do
+    {
+        remotePackets = pool->remotePackets;
+        packet->source = remotePackets;
+    }
+    while (!_gekkota_packet_compare_and_swap(&pool->remotePackets,
+            remotePackets, packet));
+
+    /*
+     * The pool might have been destroyed after it was checked, in which
+     * case the owner might already be done with [remotePackets].
+     */
+    if (pool->isDestroyed)
+        _gekkota_packet_pool_free_remote(pool);
+
+    if (_gekkota_packet_decrement(&pool->packetCount) == 0)
+        gekkota_memory_arena_free(pool->arena, pool);
+}
+
+static void_t
+_gekkota_packet_pool_free_remote(GekkotaPacketPool *pool)
+{
+    GekkotaPacket *packet, *nextPacket;
+
+    packet = _gekkota_packet_exchange(&pool->remotePackets, NULL);
+
+    while (packet != NULL)
+    {
+        nextPacket = packet->source;
+        _gekkota_packet_free(packet);
+        packet = nextPacket;
+    }
+}
+
+static void_t
+_gekkota_packet_release_data(GekkotaPacket *packet)
+{
+    if (packet->isForeign)
+    {
+        if (packet->release != NULL)
+            packet->release(&packet->data, 1, packet->userData);
+
+        packet->isForeign = FALSE;
+        return;
+    }
+
+    if (packet->release != NULL)
+        packet->release(packet->segments, packet->segmentCount, packet->userData);
+
+    gekkota_memory_arena_free(packet->arena, packet->segments);
+    packet->segments = NULL;
+    packet->segmentCount = 0;
+}
+
+static void_t
+_gekkota_packet_gather(const GekkotaPacket *packet, byte_t *data)
+{
+    uint16_t i;
+
+    for (i = 0; i < packet->segmentCount; i++)
+    {
+        memcpy(data, packet->segments[i].data, packet->segments[i].length);
+        data += packet->segments[i].length;
+    }
+}
+
+static bool_t
+_gekkota_packet_equals_data(
+        const GekkotaPacket *packet,
+        const GekkotaPacket *value)
+{
+    GekkotaBuffer buffers[GEKKOTA_PACKET_MAX_SEGMENTS];
+    GekkotaBuffer ranges[GEKKOTA_PACKET_MAX_SEGMENTS];
+    const byte_t *data;
+    size_t offset = 0;
+    uint16_t i, j, count, rangeCount;
+
+    /*
+     * Compare each segment of the packet against the ranges of the other
+     * one it overlaps, without gathering either.
+     */
+    count = _gekkota_packet_get_segments(packet, 0, packet->data.length, buffers);
+
+    for (i = 0; i < count; i++)
+    {
+        rangeCount = _gekkota_packet_get_segments(
+                value, offset, buffers[i].length, ranges);
+        data = (const byte_t *) buffers[i].data;
+
+        for (j = 0; j < rangeCount; j++)
+        {
+            if (memcmp(data, ranges[j].data, ranges[j].length) != 0)
+                return FALSE;
+
+            data += ranges[j].length;
+        }
+
+        offset += buffers[i].length;
+    }
+
+    return TRUE;
+}
+
+static int32_t
+_gekkota_packet_resize(GekkotaPacket *restrict packet, size_t newSize)
+{
+    GekkotaBuffer data;
+    byte_t *memory;
+
+    if (packet->source == NULL && !packet->isForeign && packet->headroom == 0)
+        return gekkota_buffer_resize(&packet->data, newSize, FALSE);
+
+    if (packet->source == NULL && !packet->isForeign)
+    {
+        /*
+         * Keep the headroom in front of the data.
+         */
+        if ((memory = gekkota_memory_realloc(
+                (byte_t *) packet->data.data - packet->headroom,
+                packet->headroom + newSize, FALSE)) == NULL)
+            return -1;
+
+        packet->data.data = memory + packet->headroom;
+        packet->data.length = newSize;
+
+        return 0;
+    }
+
+    /*
+     * Neither a slice nor application data can be grown in place: give
+     * the packet data of its own.
+     */
+    if (gekkota_buffer_malloc(&data, newSize, FALSE) != 0)
+        return -1;
+
+    memcpy(data.data, packet->data.data,
+            packet->data.length < newSize ? packet->data.length : newSize);
+
+    if (packet->source != NULL)
+    {
+        gekkota_packet_destroy(packet->source);
+        packet->source = NULL;
+    }
+    else
+        _gekkota_packet_release_data(packet);
+
+    packet->data = data;
+
+    return 0;
+}
@@ -13,6 +13,22 @@
 #include "gekkota/gekkota_buffer.h"
 #include "gekkota/gekkota_types.h"
 
+/*
+ * Bytes reserved in front of the data of packets allocated with
+ * gekkota_packet_new_with_headroom(), enough for the protocol headers
+ * to be written in place.
+ */
+#ifndef GEKKOTA_PACKET_HEADROOM
+#define GEKKOTA_PACKET_HEADROOM 48
+#endif /* !GEKKOTA_PACKET_HEADROOM */
+
+/*
+ * Maximum number of application buffers a segmented packet can be made of.
+ */
+#ifndef GEKKOTA_PACKET_MAX_SEGMENTS
+#define GEKKOTA_PACKET_MAX_SEGMENTS 16
+#endif /* !GEKKOTA_PACKET_MAX_SEGMENTS */
+
 typedef enum
 {
     GEKKOTA_PACKET_FLAG_NONE        = 0,
@@ -24,6 +40,15 @@ typedef enum
 
 typedef struct _GekkotaPacket GekkotaPacket;
 
+/*
+ * Invoked when the library no longer references the application buffers
+ * a segmented or application-owned packet is made of.
+ */
+typedef void_t (*GekkotaPacketReleaseCallback)(
+        const GekkotaBuffer *segments,
+        uint16_t segmentCount,
+        void_t *userData);
+
 GEKKOTA_API GekkotaPacket *
 gekkota_packet_new(size_t size);
 
@@ -36,6 +61,24 @@ gekkota_packet_new_1(size_t size, GekkotaPacketFlag flags);
 GEKKOTA_API GekkotaPacket *
 gekkota_packet_new_2(const GekkotaBuffer *data, GekkotaPacketFlag flags);
 
+GEKKOTA_API GekkotaPacket *
+gekkota_packet_new_3(
+        const GekkotaBuffer *segments,
+        uint16_t segmentCount,
+        GekkotaPacketFlag flags,
+        GekkotaPacketReleaseCallback release,
+        void_t *userData);
+
+GEKKOTA_API GekkotaPacket *
+gekkota_packet_new_4(
+        const GekkotaBuffer *data,
+        GekkotaPacketFlag flags,
+        GekkotaPacketReleaseCallback release,
+        void_t *userData);
+
+GEKKOTA_API GekkotaPacket *
+gekkota_packet_new_with_headroom(size_t size, GekkotaPacketFlag flags);
+
 GEKKOTA_API int32_t
 gekkota_packet_destroy(GekkotaPacket *packet);
 
@@ -48,9 +91,17 @@ gekkota_packet_resize(GekkotaPacket *restrict packet, size_t newSize);
 GEKKOTA_API bool_t
 gekkota_packet_equals(const GekkotaPacket *packet, const GekkotaPacket *value);
 
+/*
+ * The data of a segmented packet is not contiguous: gekkota_packet_get_data()
+ * refuses it until gekkota_packet_flatten() has gathered the segments into a
+ * single buffer and handed them back through the release callback.
+ */
 GEKKOTA_API GekkotaBuffer *
 gekkota_packet_get_data(const GekkotaPacket *packet);
 
+GEKKOTA_API int32_t
+gekkota_packet_flatten(GekkotaPacket *packet);
+
 GEKKOTA_API int32_t
 gekkota_packet_set_data(GekkotaPacket *restrict packet, const GekkotaBuffer *data);
 
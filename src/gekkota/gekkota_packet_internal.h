@@ -11,13 +11,67 @@
 #define __GEKKOTA_PACKET_INTERNAL_H__
 
 #include "gekkota/gekkota_buffer.h"
+#include "gekkota/gekkota_memory.h"
 #include "gekkota/gekkota_types.h"
 
+typedef struct _GekkotaPacketPool GekkotaPacketPool;
+
 struct _GekkotaPacket
 {
     GekkotaBuffer       data;
     GekkotaPacketFlag   flags;
-    uint32_t            refCount;
+    volatile uint32_t   refCount;           /* updated atomically */
+    GekkotaMemoryArena  *arena;             /* arena the packet was */
+                                            /* allocated from */
+    struct _GekkotaPacket *source;          /* packet whose data this one */
+                                            /* is a slice of, if any; next */
+                                            /* free packet while in [pool] */
+    GekkotaPacketPool   *pool;              /* pool the packet goes back */
+                                            /* to when destroyed, if any */
+    size_t              headroom;           /* bytes reserved in front of */
+                                            /* [data] */
+    GekkotaBuffer       *segments;          /* application buffers the */
+                                            /* data is made of, if any */
+    uint16_t            segmentCount;
+    GekkotaPacketReleaseCallback release;
+    void_t              *userData;
+    bool_t              isForeign;          /* whether [data] belongs to */
+                                            /* the application */
 };
 
+extern GekkotaPacket *
+_gekkota_packet_new_slice(
+        GekkotaPacket *source,
+        size_t offset,
+        size_t length,
+        GekkotaPacketFlag flags);
+
+extern int32_t
+_gekkota_packet_flatten(GekkotaPacket *packet);
+
+extern uint16_t
+_gekkota_packet_count_segments(
+        const GekkotaPacket *packet,
+        size_t offset,
+        size_t length);
+
+extern uint16_t
+_gekkota_packet_get_segments(
+        const GekkotaPacket *packet,
+        size_t offset,
+        size_t length,
+        GekkotaBuffer *buffers);
+
+extern size_t
+_gekkota_packet_get_pinned_size(const GekkotaPacket *packet);
+
+extern GekkotaPacketPool *
+_gekkota_packet_pool_new(size_t packetSize);
+
+extern void_t
+_gekkota_packet_pool_destroy(GekkotaPacketPool *pool);
+
+extern GekkotaPacket *
+_gekkota_packet_pool_get(GekkotaPacketPool *pool);
+
 #endif /* !__GEKKOTA_PACKET_INTERNAL_H__ */
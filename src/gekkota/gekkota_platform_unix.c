@@ -26,13 +26,13 @@
 #define GEKKOTA_PLATFORM_MINOR_VERSION  2
 #define GEKKOTA_PLATFORM_BUILD_NUMBER   3
 
+#ifndef HAVE_NATIVE_IDN
 static GekkotaLoading loadings[] =
 {
-#ifndef HAVE_NATIVE_IDN
     { GEKKOTA_PLATFORM_FEATURE_IDN,
         TRUE, "libidn.so", NULL, gekkota_idn_initialize }
-#endif /* !HAVE_NATIVE_IDN */
 };
+#endif /* !HAVE_NATIVE_IDN */
 
 int32_t
 _gekkota_platform_initialize(void_t)
@@ -144,8 +144,12 @@ _gekkota_platform_initialize(void_t)
         /* Generic UNIX */
         platform.type = GEKKOTA_PLATFORM_TYPE_UNIX;
 
+#ifndef HAVE_NATIVE_IDN
     return _gekkota_platform_load_modules(
             loadings, sizeof(loadings) / sizeof(GekkotaLoading));
+#else
+    return _gekkota_platform_load_modules(NULL, 0);
+#endif /* !HAVE_NATIVE_IDN */
 
 }
 
@@ -0,0 +1,281 @@
+/******************************************************************************
+ * @file    gekkota_reactor.c
+ * @date    17-Oct-2026
+ * @author  <a href="mailto:giuseppe.greco@agamura.com">Giuseppe Greco</a>
+ *
+ * Copyright (C) 2026 Agamura, Inc. - http://www.agamura.com
+ * All right reserved.
+ ******************************************************************************/
+
+#include <errno.h>
+#include "gekkota_errors.h"
+#include "gekkota_memory.h"
+#include "gekkota_reactor.h"
+
+static GekkotaReactorSource *
+_gekkota_reactor_find_source(
+        GekkotaReactor *reactor,
+        const GekkotaSocket *socket);
+
+static int32_t
+_gekkota_reactor_add_source(
+        GekkotaReactor *reactor,
+        GekkotaSocket *socket,
+        GekkotaXudp *xudp,
+        void_t *userData);
+
+static int32_t
+_gekkota_reactor_remove_source(
+        GekkotaReactor *reactor,
+        GekkotaReactorSource *source);
+
+GekkotaReactor *
+gekkota_reactor_new(void_t)
+{
+    GekkotaReactor *reactor;
+
+    if ((reactor = gekkota_memory_alloc(sizeof(GekkotaReactor), TRUE)) == NULL)
+        return NULL;
+
+    gekkota_list_clear(&reactor->sources);
+
+    if (_gekkota_reactor_open(reactor) != 0)
+    {
+        gekkota_memory_free(reactor);
+        return NULL;
+    }
+
+    return reactor;
+}
+
+int32_t
+gekkota_reactor_destroy(GekkotaReactor *reactor)
+{
+    if (reactor == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    /*
+     * Closing the reactor drops whatever is still registered with it.
+     */
+    while (!gekkota_list_is_empty(&reactor->sources))
+        gekkota_memory_free(gekkota_list_remove(
+                gekkota_list_first(&reactor->sources)));
+
+    _gekkota_reactor_close(reactor);
+    gekkota_memory_free(reactor);
+
+    return 0;
+}
+
+int32_t
+gekkota_reactor_add_socket(
+        GekkotaReactor *restrict reactor,
+        GekkotaSocket *socket,
+        void_t *userData)
+{
+    if (reactor == NULL || socket == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    return _gekkota_reactor_add_source(reactor, socket, NULL, userData);
+}
+
+int32_t
+gekkota_reactor_add_xudp(
+        GekkotaReactor *restrict reactor,
+        GekkotaXudp *xudp,
+        void_t *userData)
+{
+    if (reactor == NULL || xudp == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    return _gekkota_reactor_add_source(
+            reactor, gekkota_xudp_get_socket(xudp), xudp, userData);
+}
+
+int32_t
+gekkota_reactor_remove_socket(
+        GekkotaReactor *restrict reactor,
+        GekkotaSocket *socket)
+{
+    GekkotaReactorSource *source;
+
+    if (reactor == NULL || socket == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    if ((source = _gekkota_reactor_find_source(reactor, socket)) == NULL ||
+            source->xudp != NULL)
+    {
+        errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
+        return -1;
+    }
+
+    return _gekkota_reactor_remove_source(reactor, source);
+}
+
+int32_t
+gekkota_reactor_remove_xudp(
+        GekkotaReactor *restrict reactor,
+        GekkotaXudp *xudp)
+{
+    GekkotaReactorSource *source;
+
+    if (reactor == NULL || xudp == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    if ((source = _gekkota_reactor_find_source(
+            reactor, gekkota_xudp_get_socket(xudp))) == NULL ||
+            source->xudp != xudp)
+    {
+        errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
+        return -1;
+    }
+
+    return _gekkota_reactor_remove_source(reactor, source);
+}
+
+int32_t
+gekkota_reactor_wait(
+        GekkotaReactor *restrict reactor,
+        GekkotaReactorEvent *events,
+        size_t capacity,
+        int32_t timeout)
+{
+    GekkotaReactorSource *source;
+    GekkotaListIterator iterator;
+    int32_t count, nextTimeout;
+
+    if (reactor == NULL || events == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    if (capacity == 0 || capacity > INT32_MAX)
+    {
+        errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
+        return -1;
+    }
+
+    /*
+     * Do not wait past the earliest timer of the registered XUDP hosts.
+     */
+    for (iterator = gekkota_list_head(&reactor->sources);
+            iterator != gekkota_list_tail(&reactor->sources);
+            iterator = gekkota_list_next(iterator))
+    {
+        source = _gekkota_reactor_source_from_node(iterator);
+        source->isReady = FALSE;
+
+        if (source->xudp == NULL)
+            continue;
+
+        nextTimeout = gekkota_xudp_get_next_timeout(source->xudp);
+
+        if (timeout < 0 || nextTimeout < timeout)
+            timeout = nextTimeout;
+    }
+
+    if ((count = _gekkota_reactor_wait(reactor, events, capacity, timeout)) == -1)
+        return -1;
+
+    /*
+     * Hosts with timers due need servicing even if nothing was received.
+     */
+    for (iterator = gekkota_list_head(&reactor->sources);
+            iterator != gekkota_list_tail(&reactor->sources) &&
+            (size_t) count < capacity;
+            iterator = gekkota_list_next(iterator))
+    {
+        source = _gekkota_reactor_source_from_node(iterator);
+
+        if (source->xudp == NULL || source->isReady ||
+                gekkota_xudp_get_next_timeout(source->xudp) > 0)
+            continue;
+
+        events[count].socket = source->socket;
+        events[count].xudp = source->xudp;
+        events[count].userData = source->userData;
+        ++count;
+    }
+
+    return count;
+}
+
+static GekkotaReactorSource *
+_gekkota_reactor_find_source(
+        GekkotaReactor *reactor,
+        const GekkotaSocket *socket)
+{
+    GekkotaListIterator iterator;
+
+    for (iterator = gekkota_list_head(&reactor->sources);
+            iterator != gekkota_list_tail(&reactor->sources);
+            iterator = gekkota_list_next(iterator))
+        if (_gekkota_reactor_source_from_node(iterator)->socket == socket)
+            return _gekkota_reactor_source_from_node(iterator);
+
+    return NULL;
+}
+
+static int32_t
+_gekkota_reactor_add_source(
+        GekkotaReactor *reactor,
+        GekkotaSocket *socket,
+        GekkotaXudp *xudp,
+        void_t *userData)
+{
+    GekkotaReactorSource *source;
+
+    if (_gekkota_reactor_find_source(reactor, socket) != NULL)
+    {
+        errno = GEKKOTA_ERROR_OPERATION_NOT_VALID;
+        return -1;
+    }
+
+    if ((source = gekkota_memory_alloc(sizeof(GekkotaReactorSource), TRUE)) == NULL)
+        return -1;
+
+    source->socket = socket;
+    source->xudp = xudp;
+    source->userData = userData;
+
+    if (_gekkota_reactor_add(reactor, source) != 0)
+    {
+        gekkota_memory_free(source);
+        return -1;
+    }
+
+    gekkota_list_add(&reactor->sources, source);
+    ++reactor->sourceCount;
+
+    return 0;
+}
+
+static int32_t
+_gekkota_reactor_remove_source(
+        GekkotaReactor *reactor,
+        GekkotaReactorSource *source)
+{
+    _gekkota_reactor_remove(reactor, source);
+
+    gekkota_list_remove(&source->sourceNode);
+    gekkota_memory_free(source);
+    --reactor->sourceCount;
+
+    return 0;
+}
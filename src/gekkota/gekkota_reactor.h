@@ -0,0 +1,73 @@
+/******************************************************************************
+ * @file    gekkota_reactor.h
+ * @date    17-Oct-2026
+ * @author  <a href="mailto:giuseppe.greco@agamura.com">Giuseppe Greco</a>
+ *
+ * Copyright (C) 2026 Agamura, Inc. - http://www.agamura.com
+ * All right reserved.
+ ******************************************************************************/
+
+#ifndef __GEKKOTA_REACTOR_H__
+#define __GEKKOTA_REACTOR_H__
+
+#include "gekkota/gekkota_socket.h"
+#include "gekkota/gekkota_types.h"
+#include "gekkota/gekkota_xudp.h"
+
+typedef struct _GekkotaReactor GekkotaReactor;
+
+/*
+ * Reported by gekkota_reactor_wait() for every registered source that is
+ * ready: [socket] has data to read, or [xudp] has data to read or timers
+ * due. Readiness is edge-triggered where the platform supports it, so a
+ * source is reported again only after new data arrives: read a socket
+ * until it would block and poll an XUDP host with a zero timeout until it
+ * returns no more events.
+ */
+typedef struct _GekkotaReactorEvent
+{
+    GekkotaSocket       *socket;
+    GekkotaXudp         *xudp;                  /* NULL for plain sockets */
+    void_t              *userData;
+} GekkotaReactorEvent;
+
+GEKKOTA_API GekkotaReactor *
+gekkota_reactor_new(void_t);
+
+GEKKOTA_API int32_t
+gekkota_reactor_destroy(GekkotaReactor *reactor);
+
+GEKKOTA_API int32_t
+gekkota_reactor_add_socket(
+        GekkotaReactor *restrict reactor,
+        GekkotaSocket *socket,
+        void_t *userData);
+
+GEKKOTA_API int32_t
+gekkota_reactor_add_xudp(
+        GekkotaReactor *restrict reactor,
+        GekkotaXudp *xudp,
+        void_t *userData);
+
+GEKKOTA_API int32_t
+gekkota_reactor_remove_socket(
+        GekkotaReactor *restrict reactor,
+        GekkotaSocket *socket);
+
+GEKKOTA_API int32_t
+gekkota_reactor_remove_xudp(
+        GekkotaReactor *restrict reactor,
+        GekkotaXudp *xudp);
+
+GEKKOTA_API int32_t
+gekkota_reactor_wait(
+        GekkotaReactor *restrict reactor,
+        GekkotaReactorEvent *events,
+        size_t capacity,
+        int32_t timeout);
+
+#if defined (GEKKOTA_BUILDING_LIB) || defined (GEKKOTA_BUILDING_STATIC_LIB)
+#include "gekkota_reactor_internal.h"
+#endif /* GEKKOTA_BUILDING_LIB || GEKKOTA_BUILDING_STATIC_LIB */
+
+#endif /* !__GEKKOTA_REACTOR_H__ */
@@ -0,0 +1,57 @@
+/******************************************************************************
+ * @file    gekkota_reactor_internal.h
+ * @date    17-Oct-2026
+ * @author  <a href="mailto:giuseppe.greco@agamura.com">Giuseppe Greco</a>
+ *
+ * Copyright (C) 2026 Agamura, Inc. - http://www.agamura.com
+ * All right reserved.
+ ******************************************************************************/
+
+#ifndef __GEKKOTA_REACTOR_INTERNAL_H__
+#define __GEKKOTA_REACTOR_INTERNAL_H__
+
+#include "gekkota/gekkota_list.h"
+#include "gekkota/gekkota_reactor.h"
+#include "gekkota/gekkota_socket.h"
+#include "gekkota/gekkota_types.h"
+#include "gekkota/gekkota_xudp.h"
+
+typedef struct _GekkotaReactorSource
+{
+    GekkotaListNode     sourceNode;
+    GekkotaSocket       *socket;
+    GekkotaXudp         *xudp;
+    void_t              *userData;
+    bool_t              isReady;            /* reported by the current wait */
+} GekkotaReactorSource;
+
+struct _GekkotaReactor
+{
+    int32_t             handle;             /* epoll instance, if any */
+    GekkotaList         sources;
+    uint32_t            sourceCount;
+};
+
+#define _gekkota_reactor_source_from_node(node) \
+    ((GekkotaReactorSource *) (node))
+
+extern int32_t
+_gekkota_reactor_open(GekkotaReactor *reactor);
+
+extern void_t
+_gekkota_reactor_close(GekkotaReactor *reactor);
+
+extern int32_t
+_gekkota_reactor_add(GekkotaReactor *reactor, GekkotaReactorSource *source);
+
+extern void_t
+_gekkota_reactor_remove(GekkotaReactor *reactor, GekkotaReactorSource *source);
+
+extern int32_t
+_gekkota_reactor_wait(
+        GekkotaReactor *reactor,
+        GekkotaReactorEvent *events,
+        size_t capacity,
+        int32_t timeout);
+
+#endif /* !__GEKKOTA_REACTOR_INTERNAL_H__ */
@@ -0,0 +1,197 @@
+/******************************************************************************
+ * @file    gekkota_reactor_unix.c
+ * @date    17-Oct-2026
+ * @author  <a href="mailto:giuseppe.greco@agamura.com">Giuseppe Greco</a>
+ *
+ * Copyright (C) 2026 Agamura, Inc. - http://www.agamura.com
+ * All right reserved.
+ ******************************************************************************/
+
+#include <errno.h>
+#include "gekkota_errors.h"
+#include "gekkota_reactor.h"
+
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#include <unistd.h>
+#else
+#include <sys/select.h>
+#include <sys/time.h>
+#endif /* HAVE_EPOLL */
+
+#ifdef HAVE_EPOLL
+/*
+ * Maximum number of ready sources collected with a single system call;
+ * the others stay queued for the next wait.
+ */
+#define GEKKOTA_REACTOR_MAX_EVENTS  64
+#endif /* HAVE_EPOLL */
+
+int32_t
+_gekkota_reactor_open(GekkotaReactor *reactor)
+{
+#ifdef HAVE_EPOLL
+    if ((reactor->handle = epoll_create1(EPOLL_CLOEXEC)) == -1)
+    {
+        errno = errno == EMFILE || errno == ENFILE
+            ? GEKKOTA_ERROR_TOO_MANY_OPEN_SOCKETS
+            : GEKKOTA_ERROR_NO_RESOURCE_AVAILABLE;
+        return -1;
+    }
+#else
+    reactor->handle = -1;
+#endif /* HAVE_EPOLL */
+
+    return 0;
+}
+
+void_t
+_gekkota_reactor_close(GekkotaReactor *reactor)
+{
+#ifdef HAVE_EPOLL
+    close(reactor->handle);
+#endif /* HAVE_EPOLL */
+    reactor->handle = -1;
+}
+
+int32_t
+_gekkota_reactor_add(GekkotaReactor *reactor, GekkotaReactorSource *source)
+{
+#ifdef HAVE_EPOLL
+    struct epoll_event event;
+
+    /*
+     * Edge-triggered: the source is reported once per batch of incoming
+     * data, not for as long as data is pending.
+     */
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = source;
+
+    if (epoll_ctl(reactor->handle, EPOLL_CTL_ADD,
+            _gekkota_socket_get_read_handle(source->socket), &event) == -1)
+    {
+        errno = errno == ENOMEM || errno == ENOSPC
+            ? GEKKOTA_ERROR_NO_RESOURCE_AVAILABLE
+            : GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
+        return -1;
+    }
+#else
+    if (_gekkota_socket_get_read_handle(source->socket) >= FD_SETSIZE)
+    {
+        errno = GEKKOTA_ERROR_SOCKET_LIMIT_REACHED;
+        return -1;
+    }
+#endif /* HAVE_EPOLL */
+
+    return 0;
+}
+
+void_t
+_gekkota_reactor_remove(GekkotaReactor *reactor, GekkotaReactorSource *source)
+{
+#ifdef HAVE_EPOLL
+    struct epoll_event event;
+
+    /*
+     * Fails harmlessly if the socket has already been closed, which also
+     * removes it from the epoll instance.
+     */
+    epoll_ctl(reactor->handle, EPOLL_CTL_DEL,
+            _gekkota_socket_get_read_handle(source->socket), &event);
+#endif /* HAVE_EPOLL */
+}
+
+int32_t
+_gekkota_reactor_wait(
+        GekkotaReactor *reactor,
+        GekkotaReactorEvent *events,
+        size_t capacity,
+        int32_t timeout)
+{
+    GekkotaReactorSource *source;
+#ifdef HAVE_EPOLL
+    struct epoll_event readyEvents[GEKKOTA_REACTOR_MAX_EVENTS];
+    int32_t count, i;
+
+    if (capacity > GEKKOTA_REACTOR_MAX_EVENTS)
+        capacity = GEKKOTA_REACTOR_MAX_EVENTS;
+
+    if ((count = epoll_wait(
+            reactor->handle, readyEvents, (int) capacity, timeout)) == -1)
+    {
+        if (errno == EINTR)
+            return 0;
+
+        errno = GEKKOTA_ERROR_NETWORK_FAILURE;
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        source = (GekkotaReactorSource *) readyEvents[i].data.ptr;
+        source->isReady = TRUE;
+
+        events[i].socket = source->socket;
+        events[i].xudp = source->xudp;
+        events[i].userData = source->userData;
+    }
+
+    return count;
+#else
+    GekkotaListIterator iterator;
+    fd_set readSet;
+    struct timeval timeval, *selectTimeout = NULL;
+    socket_t handle, maxSocket = 0;
+    int32_t count = 0;
+
+    if (timeout > -1)
+    {
+        timeval.tv_sec = timeout / 1000;
+        timeval.tv_usec = (timeout % 1000) * 1000;
+        selectTimeout = &timeval;
+    }
+
+    FD_ZERO(&readSet);
+
+    for (iterator = gekkota_list_head(&reactor->sources);
+            iterator != gekkota_list_tail(&reactor->sources);
+            iterator = gekkota_list_next(iterator))
+    {
+        source = _gekkota_reactor_source_from_node(iterator);
+        handle = _gekkota_socket_get_read_handle(source->socket);
+        FD_SET(handle, &readSet);
+
+        if (handle > maxSocket)
+            maxSocket = handle;
+    }
+
+    if (select(maxSocket + 1, &readSet, NULL, NULL, selectTimeout) == -1)
+    {
+        if (errno == EINTR)
+            return 0;
+
+        errno = GEKKOTA_ERROR_NETWORK_FAILURE;
+        return -1;
+    }
+
+    for (iterator = gekkota_list_head(&reactor->sources);
+            iterator != gekkota_list_tail(&reactor->sources) &&
+            (size_t) count < capacity;
+            iterator = gekkota_list_next(iterator))
+    {
+        source = _gekkota_reactor_source_from_node(iterator);
+
+        if (!FD_ISSET(_gekkota_socket_get_read_handle(source->socket), &readSet))
+            continue;
+
+        source->isReady = TRUE;
+
+        events[count].socket = source->socket;
+        events[count].xudp = source->xudp;
+        events[count].userData = source->userData;
+        ++count;
+    }
+
+    return count;
+#endif /* HAVE_EPOLL */
+}
@@ -0,0 +1,113 @@
+/******************************************************************************
+ * @file    gekkota_reactor_win32.c
+ * @date    17-Oct-2026
+ * @author  <a href="mailto:giuseppe.greco@agamura.com">Giuseppe Greco</a>
+ *
+ * Copyright (C) 2026 Agamura, Inc. - http://www.agamura.com
+ * All right reserved.
+ ******************************************************************************/
+
+#include <errno.h>
+#include "gekkota.h"
+#include "gekkota_errors.h"
+#include "gekkota_reactor.h"
+
+int32_t
+_gekkota_reactor_open(GekkotaReactor *reactor)
+{
+    reactor->handle = -1;
+    return 0;
+}
+
+void_t
+_gekkota_reactor_close(GekkotaReactor *reactor)
+{
+    reactor->handle = -1;
+}
+
+int32_t
+_gekkota_reactor_add(GekkotaReactor *reactor, GekkotaReactorSource *source)
+{
+    /*
+     * Winsock fd_sets hold at most FD_SETSIZE sockets, whatever their
+     * values.
+     */
+    if (reactor->sourceCount >= FD_SETSIZE)
+    {
+        errno = GEKKOTA_ERROR_SOCKET_LIMIT_REACHED;
+        return -1;
+    }
+
+    return 0;
+}
+
+void_t
+_gekkota_reactor_remove(GekkotaReactor *reactor, GekkotaReactorSource *source)
+{
+}
+
+int32_t
+_gekkota_reactor_wait(
+        GekkotaReactor *reactor,
+        GekkotaReactorEvent *events,
+        size_t capacity,
+        int32_t timeout)
+{
+    GekkotaReactorSource *source;
+    GekkotaListIterator iterator;
+    fd_set readSet;
+    struct timeval timeval, *selectTimeout = NULL;
+    int32_t count = 0;
+
+    /*
+     * Winsock refuses to select on empty sets.
+     */
+    if (reactor->sourceCount == 0)
+    {
+        Sleep(timeout < 0 ? INFINITE : (DWORD) timeout);
+        return 0;
+    }
+
+    if (timeout > -1)
+    {
+        timeval.tv_sec = timeout / 1000;
+        timeval.tv_usec = (timeout % 1000) * 1000;
+        selectTimeout = &timeval;
+    }
+
+    FD_ZERO(&readSet);
+
+    for (iterator = gekkota_list_head(&reactor->sources);
+            iterator != gekkota_list_tail(&reactor->sources);
+            iterator = gekkota_list_next(iterator))
+        FD_SET(_gekkota_reactor_source_from_node(iterator)->socket->client, &readSet);
+
+    if (select(0, &readSet, NULL, NULL, selectTimeout) == SOCKET_ERROR)
+    {
+        if (WSAGetLastError() == WSAEINTR)
+            return 0;
+
+        errno = GEKKOTA_ERROR_NETWORK_FAILURE;
+        return -1;
+    }
+
+    for (iterator = gekkota_list_head(&reactor->sources);
+            iterator != gekkota_list_tail(&reactor->sources) &&
+            (size_t) count < capacity;
+            iterator = gekkota_list_next(iterator))
+    {
+        source = _gekkota_reactor_source_from_node(iterator);
+
+        if (!FD_ISSET(source->socket->client, &readSet))
+            continue;
+
+        source->isReady = TRUE;
+
+        events[count].socket = source->socket;
+        events[count].xudp = source->xudp;
+        events[count].userData = source->userData;
+        ++count;
+    }
+
+    return count;
+}
@@ -10,6 +10,7 @@
 #include <errno.h>
 #include <string.h>
 #include "gekkota.h"
+#include "gekkota_bit.h"
 #include "gekkota_dns.h"
 #include "gekkota_errors.h"
 #include "gekkota_memory.h"
@@ -17,9 +18,33 @@
 #include "gekkota_networkinterface.h"
 #include "gekkota_socket.h"
 
+#ifndef WIN32
+#include <netinet/tcp.h>
+#endif /* !WIN32 */
+
 #define GEKKOTA_SOCKET_DEFAULT_RECEIVE_BUFFER_SIZE  256 * 1024
 #define GEKKOTA_SOCKET_DEFAULT_SEND_BUFFER_SIZE     256 * 1024
 
+int32_t
+gekkota_socket_receive_batch(
+        const GekkotaSocket *socket,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount)
+{
+    if (socket == NULL || datagrams == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    if (datagramCount > 0)
+        return socket->ring != NULL
+            ? _gekkota_socket_ring_receive_batch(socket->ring, datagrams, datagramCount)
+            : _gekkota_socket_receive_batch(socket->client, datagrams, datagramCount);
+
+    return 0;
+}
+
 static GekkotaSocket *
 _gekkota_socket_new(
         GekkotaSocketType socketType,
@@ -169,6 +194,13 @@ gekkota_socket_destroy(GekkotaSocket *socket)
 
     if (--socket->refCount == 0)
     {
+        /*
+         * The ring goes first, while the kernel can still be asked to
+         * let go of its receive buffers.
+         */
+        if (socket->ring != NULL)
+            _gekkota_socket_ring_destroy(socket->ring);
+
         _gekkota_socket_close(socket->client);
         gekkota_ipendpoint_destroy(socket->localEndPoint);
         gekkota_ipendpoint_destroy(socket->remoteEndPoint);
@@ -484,9 +516,13 @@ gekkota_socket_join_multicast_group_2(
         return -1;
 
     if (multicastAddress->family == AF_INET)
+    {
+        uint8_t hops = (uint8_t) ttl;
+
         return _gekkota_socket_setsockopt(
                 socket->client, IPPROTO_IP, IP_MULTICAST_TTL,
-                (const void_t *) &((uint8_t) ttl), sizeof(uint8_t));
+                (const void_t *) &hops, sizeof(uint8_t));
+    }
     else
         return _gekkota_socket_setsockopt(
                 socket->client, IPPROTO_IPV6, IPV6_MULTICAST_HOPS,
@@ -568,6 +604,9 @@ gekkota_socket_poll(
         return -1;
     }
 
+    if (socket->ring != NULL && selectMode == GEKKOTA_SELECT_MODE_READ)
+        return _gekkota_socket_ring_poll(socket->ring, timeout);
+
     return _gekkota_socket_poll(socket->client, selectMode, timeout);
 }
 
@@ -614,6 +653,28 @@ gekkota_socket_send(
     return 0;
 }
 
+int32_t
+gekkota_socket_send_batch(
+        const GekkotaSocket *socket,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount)
+{
+    if (socket == NULL || datagrams == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    if (datagramCount > 0)
+        return socket->ring != NULL
+            ? _gekkota_socket_ring_send_batch(
+                    socket->ring, datagrams, datagramCount, socket->offloads)
+            : _gekkota_socket_send_batch(
+                    socket->client, datagrams, datagramCount, socket->offloads);
+
+    return 0;
+}
+
 int32_t
 gekkota_socket_receive(
         const GekkotaSocket *socket,
@@ -633,7 +694,28 @@ gekkota_socket_receive(
     {
         GekkotaSocketAddress socketAddress;
 
-        if ((recv = _gekkota_socket_receive(
+        if (socket->ring != NULL)
+        {
+            GekkotaDatagram datagram;
+
+            datagram.remoteSocketAddress = remoteEndPoint != NULL ? &socketAddress : NULL;
+            datagram.buffers = buffers;
+            datagram.bufferCount = bufferCount;
+            datagram.length = 0;
+
+            if ((recv = _gekkota_socket_ring_receive_batch(
+                    socket->ring, &datagram, 1)) == -1)
+                return -1;
+
+            if (recv > 0 && datagram.length == 0)
+            {
+                errno = GEKKOTA_ERROR_MESSAGE_TRUNCATED;
+                return -1;
+            }
+
+            recv = (int32_t) datagram.length;
+        }
+        else if ((recv = _gekkota_socket_receive(
                 socket->client,
                 buffers, bufferCount,
                 remoteEndPoint != NULL ? &socketAddress : NULL)) == -1)
@@ -654,6 +736,49 @@ gekkota_socket_receive(
     return recv;
 }
 
+int32_t
+_gekkota_socket_attach_ring(GekkotaSocket *socket, size_t bufferSize)
+{
+    if (socket->type != SOCK_DGRAM)
+    {
+        errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+        return -1;
+    }
+
+    if (socket->ring != NULL)
+        return 0;
+
+    if ((socket->ring = _gekkota_socket_ring_new(socket->client, bufferSize)) == NULL)
+        return -1;
+
+    return 0;
+}
+
+int32_t
+_gekkota_socket_enable_coalescing(GekkotaSocket *socket)
+{
+    /*
+     * Ring buffers are only as large as a single datagram.
+     */
+    if (!gekkota_bit_isset(socket->offloads, GEKKOTA_SOCKET_OFFLOAD_COALESCING) ||
+            socket->ring != NULL)
+    {
+        errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+        return -1;
+    }
+
+    if (!socket->isCoalescing)
+    {
+        if (_gekkota_socket_enable_offload(
+                socket->client, GEKKOTA_SOCKET_OFFLOAD_COALESCING) != 0)
+            return -1;
+
+        socket->isCoalescing = TRUE;
+    }
+
+    return 0;
+}
+
 static GekkotaSocket *
 _gekkota_socket_new(
         GekkotaSocketType socketType,
@@ -693,6 +818,9 @@ _gekkota_socket_new(
     newSocket->type = socketType;
     newSocket->refCount = 1;
 
+    if (newSocket->type == SOCK_DGRAM)
+        newSocket->offloads = _gekkota_socket_probe_offloads(client);
+
     return newSocket;
 }
 
@@ -782,8 +910,12 @@ _gekkota_socket_transcode_option_level_and_name(
                 break;
 
             case GEKKOTA_SOCKET_OPTION_NAME_USE_LOOPBACK:
+#ifdef SO_USELOOPBACK
                 *name = SO_USELOOPBACK;
                 break;
+#else
+                return -1;
+#endif /* SO_USELOOPBACK */
 
             default:
                 return -1;
@@ -87,6 +87,28 @@ typedef enum
 
 typedef struct _GekkotaSocket GekkotaSocket;
 
+typedef struct _GekkotaDatagram
+{
+    GekkotaSocketAddress    *remoteSocketAddress;
+    GekkotaBuffer           *buffers;
+    size_t                  bufferCount;
+    size_t                  length;         /* number of bytes transferred */
+    size_t                  segmentSize;    /* see below */
+    uint64_t                receiveTime;    /* see below */
+} GekkotaDatagram;
+
+/*
+ * Sockets that let the kernel coalesce incoming datagrams of the same flow
+ * may receive several of them in a single buffer; [segmentSize] is then
+ * the size of each datagram but the last, which may be shorter. It is 0
+ * for buffers holding a single datagram and is ignored when sending.
+ *
+ * On sockets with receive timestamps enabled, [receiveTime] is the time
+ * the kernel received the datagram at, in microseconds on the clock of
+ * gekkota_time_now_us(); it is 0 if no timestamp is available and is
+ * ignored when sending.
+ */
+
 #define gekkota_socket_new(socketType) \
     (gekkota_socket_new_1(socketType, 0))
 
@@ -188,6 +210,12 @@ gekkota_socket_send(
         const GekkotaBuffer *buffers,
         size_t bufferCount);
 
+GEKKOTA_API int32_t
+gekkota_socket_send_batch(
+        const GekkotaSocket *socket,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount);
+
 GEKKOTA_API int32_t
 gekkota_socket_receive(
         const GekkotaSocket *socket,
@@ -195,6 +223,12 @@ gekkota_socket_receive(
         size_t bufferCount,
         GekkotaIPEndPoint **remoteEndPoint);
 
+GEKKOTA_API int32_t
+gekkota_socket_receive_batch(
+        const GekkotaSocket *socket,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount);
+
 #if defined (GEKKOTA_BUILDING_LIB) || defined (GEKKOTA_BUILDING_STATIC_LIB)
 #include "gekkota_socket_internal.h"
 #endif /* GEKKOTA_BUILDING_LIB || GEKKOTA_BUILDING_STATIC_LIB */
@@ -27,19 +27,66 @@ typedef int32_t socket_t;
 #define GEKKOTA_INVALID_SOCKET  -1
 #endif /* WIN32 */
 
+/*
+ * Maximum number of datagrams handed to the kernel with a single
+ * system call when sending or receiving in batch mode.
+ */
+#define GEKKOTA_SOCKET_MAX_BATCH_SIZE   64
+
+/*
+ * Offloads the kernel supports on a datagram socket. With segmentation, a
+ * run of equal-sized datagrams to the same destination is handed down as
+ * a single buffer the kernel splits; with coalescing, a run of datagrams
+ * of the same flow may be received as a single buffer.
+ */
+#define GEKKOTA_SOCKET_OFFLOAD_SEGMENTATION 0x01
+#define GEKKOTA_SOCKET_OFFLOAD_COALESCING   0x02
+
+/*
+ * Maximum number of datagrams and bytes sent as a single segmented buffer,
+ * and size of the buffers needed to receive coalesced datagrams.
+ */
+#define GEKKOTA_SOCKET_MAX_SEGMENTS         64
+#define GEKKOTA_SOCKET_MAX_SEGMENTED_SIZE   65507
+#define GEKKOTA_SOCKET_MAX_COALESCED_SIZE   65535
+
 #ifndef HAVE_SOCKLEN_T
 typedef int32_t socklen_t;
 #endif /* !HAVE_SOCKLEN_T */
 
+/*
+ * Submission/completion rings a datagram socket can be driven through
+ * instead of plain system calls; only available with io_uring.
+ */
+typedef struct _GekkotaSocketRing GekkotaSocketRing;
+
 struct _GekkotaSocket
 {
     socket_t            client;
     int32_t             type;
     GekkotaIPEndPoint   *localEndPoint;
     GekkotaIPEndPoint   *remoteEndPoint;
+    GekkotaSocketRing   *ring;
+    uint32_t            offloads;           /* probed at creation */
+    bool_t              isCoalescing;
     uint32_t            refCount;
 };
 
+/*
+ * With a ring, incoming datagrams are consumed by the kernel as they
+ * arrive, so readiness must be waited for on the ring, not the socket.
+ */
+#define _gekkota_socket_get_read_handle(socket) \
+    ((socket)->ring != NULL \
+        ? _gekkota_socket_ring_get_handle((socket)->ring) \
+        : (socket)->client)
+
+extern int32_t
+_gekkota_socket_attach_ring(GekkotaSocket *socket, size_t bufferSize);
+
+extern int32_t
+_gekkota_socket_enable_coalescing(GekkotaSocket *socket);
+
 extern int32_t
 _gekkota_socket_startup(void_t);
 
@@ -103,6 +150,13 @@ _gekkota_socket_send(
         const GekkotaBuffer *buffers,
         size_t bufferCount);
 
+extern inline int32_t
+_gekkota_socket_send_batch(
+        socket_t socket,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount,
+        uint32_t offloads);
+
 extern inline int32_t
 _gekkota_socket_receive(
         socket_t socket,
@@ -110,4 +164,44 @@ _gekkota_socket_receive(
         size_t bufferCount,
         GekkotaSocketAddress *remoteSocketAddress);
 
+extern inline int32_t
+_gekkota_socket_receive_batch(
+        socket_t socket,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount);
+
+extern uint32_t
+_gekkota_socket_probe_offloads(socket_t socket);
+
+extern int32_t
+_gekkota_socket_enable_offload(socket_t socket, uint32_t offload);
+
+extern int32_t
+_gekkota_socket_enable_receive_timestamps(socket_t socket);
+
+extern GekkotaSocketRing *
+_gekkota_socket_ring_new(socket_t socket, size_t bufferSize);
+
+extern void_t
+_gekkota_socket_ring_destroy(GekkotaSocketRing *ring);
+
+extern socket_t
+_gekkota_socket_ring_get_handle(const GekkotaSocketRing *ring);
+
+extern int32_t
+_gekkota_socket_ring_poll(GekkotaSocketRing *ring, int32_t timeout);
+
+extern int32_t
+_gekkota_socket_ring_send_batch(
+        GekkotaSocketRing *ring,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount,
+        uint32_t offloads);
+
+extern int32_t
+_gekkota_socket_ring_receive_batch(
+        GekkotaSocketRing *ring,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount);
+
 #endif /* !__GEKKOTA_SOCKET_INTERNAL_H__ */
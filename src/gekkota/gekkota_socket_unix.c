@@ -11,7 +11,10 @@
 #include <string.h>
 #include "gekkota_bit.h"
 #include "gekkota_errors.h"
+#include "gekkota_memory.h"
 #include "gekkota_socket.h"
+#include "gekkota_time.h"
+#include "gekkota_utils.h"
 
 #ifdef HAVE_FCNTL
 #include <fcntl.h>
@@ -27,10 +30,146 @@
 #include <sys/poll.h>
 #endif /* HAVE_POLL */
 
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif /* HAVE_IO_URING */
+
+#ifdef HAVE_SO_TIMESTAMPING
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <sys/time.h>
+#endif /* HAVE_SO_TIMESTAMPING */
+
 #ifndef MSG_NOSIGNAL
 #define MSG_NOSIGNAL 0
 #endif /* !MSG_NOSIGNAL */
 
+#ifdef UDP_SEGMENT
+/*
+ * Room for the control message telling the segment size of a segmented
+ * buffer; control messages are aligned like size_t, see CMSG_ALIGN(),
+ * since struct cmsghdr may end with a flexible array and so cannot be
+ * used in arrays.
+ */
+typedef union _GekkotaSocketSegmentControl
+{
+    byte_t              buffer[CMSG_SPACE(sizeof(int32_t))];
+    size_t              align;
+} GekkotaSocketSegmentControl;
+#endif /* UDP_SEGMENT */
+
+#ifdef UDP_GRO
+#define GEKKOTA_SOCKET_SEGMENT_CONTROL_SIZE \
+    CMSG_SPACE(sizeof(int32_t))
+#else
+#define GEKKOTA_SOCKET_SEGMENT_CONTROL_SIZE 0
+#endif /* UDP_GRO */
+
+#ifdef HAVE_SO_TIMESTAMPING
+#define GEKKOTA_SOCKET_TIMESTAMP_CONTROL_SIZE \
+    CMSG_SPACE(sizeof(struct scm_timestamping))
+#else
+#define GEKKOTA_SOCKET_TIMESTAMP_CONTROL_SIZE 0
+#endif /* HAVE_SO_TIMESTAMPING */
+
+#if defined (UDP_GRO) || defined (HAVE_SO_TIMESTAMPING)
+/*
+ * Room for the control messages telling the segment size of a coalesced
+ * buffer and the time it was received at.
+ */
+typedef union _GekkotaSocketReceiveControl
+{
+    byte_t              buffer[GEKKOTA_SOCKET_SEGMENT_CONTROL_SIZE
+                            + GEKKOTA_SOCKET_TIMESTAMP_CONTROL_SIZE];
+    size_t              align;
+} GekkotaSocketReceiveControl;
+#endif /* UDP_GRO || HAVE_SO_TIMESTAMPING */
+
+#ifdef HAVE_SO_TIMESTAMPING
+/*
+ * Kernel timestamps are taken on the wall clock; both clocks are read at
+ * most once per batch to bring them to the clock of gekkota_time_now_us().
+ */
+typedef struct _GekkotaSocketClock
+{
+    uint64_t            realTime;           /* 0 until read */
+    uint64_t            time;
+} GekkotaSocketClock;
+#endif /* HAVE_SO_TIMESTAMPING */
+
+#ifdef UDP_SEGMENT
+/*
+ * Maximum number of buffers segmented messages can be made of altogether
+ * in a single batch.
+ */
+#define GEKKOTA_SOCKET_MAX_SEGMENT_BUFFERS  512
+
+/*
+ * Scratch space for the segmented messages of a batch, whose buffers come
+ * from several datagrams.
+ */
+typedef struct _GekkotaSocketSegmentation
+{
+    struct iovec        buffers[GEKKOTA_SOCKET_MAX_SEGMENT_BUFFERS];
+    size_t              bufferCount;
+    GekkotaSocketSegmentControl controls[GEKKOTA_SOCKET_MAX_BATCH_SIZE];
+    size_t              controlCount;
+} GekkotaSocketSegmentation;
+#endif /* UDP_SEGMENT */
+
+#ifdef HAVE_IO_URING
+/*
+ * Number of buffers the kernel fills with incoming datagrams on its own;
+ * must be a power of 2.
+ */
+#define GEKKOTA_SOCKET_RING_BUFFER_COUNT    256
+
+/*
+ * Buffer group the receive buffers are registered with.
+ */
+#define GEKKOTA_SOCKET_RING_BUFFER_GROUP    0
+
+typedef struct _GekkotaSocketQueue
+{
+    int32_t             fd;
+    byte_t              *rings;             /* SQ and CQ, mapped together */
+    size_t              ringsSize;
+    struct io_uring_sqe *sqes;
+    size_t              sqesSize;
+    uint32_t            *sqHead;
+    uint32_t            *sqTail;
+    uint32_t            sqPending;          /* entries filled, not yet */
+                                            /* published to the kernel */
+    uint32_t            *sqArray;
+    uint32_t            sqMask;
+    uint32_t            sqEntries;
+    uint32_t            *cqHead;
+    uint32_t            *cqTail;
+    uint32_t            cqMask;
+    struct io_uring_cqe *cqes;
+} GekkotaSocketQueue;
+
+struct _GekkotaSocketRing
+{
+    socket_t            socket;
+    GekkotaSocketQueue  sendQueue;
+    GekkotaSocketQueue  receiveQueue;
+    struct io_uring_buf_ring *bufferRing;
+    size_t              bufferRingSize;
+    byte_t              *buffers;
+    size_t              bufferSize;
+    uint16_t            bufferTail;
+    struct msghdr       receiveHeader;      /* read by every receive */
+    bool_t              isReceiving;        /* multishot receive posted */
+};
+#endif /* HAVE_IO_URING */
+
 #ifndef HAVE_POLL
 static inline int32_t
 _gekkota_socket_select(
@@ -42,6 +181,55 @@ _gekkota_socket_select(
 static int32_t
 _gekkota_socket_transcode_error(int32_t error, int32_t defaultError);
 
+#ifdef UDP_SEGMENT
+static size_t
+_gekkota_socket_prepare_message(
+        struct msghdr *msg,
+        GekkotaSocketSegmentation *segmentation,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount,
+        uint32_t offloads);
+
+static void_t
+_gekkota_socket_set_sent_lengths(GekkotaDatagram *datagrams, size_t datagramCount);
+#endif /* UDP_SEGMENT */
+
+#ifdef UDP_GRO
+static size_t
+_gekkota_socket_get_segment_size(struct msghdr *msg);
+#endif /* UDP_GRO */
+
+#ifdef HAVE_SO_TIMESTAMPING
+static uint64_t
+_gekkota_socket_get_receive_time(struct msghdr *msg, GekkotaSocketClock *clock);
+#endif /* HAVE_SO_TIMESTAMPING */
+
+#ifdef HAVE_IO_URING
+static int32_t
+_gekkota_socket_queue_open(
+        GekkotaSocketQueue *queue,
+        uint32_t entries,
+        uint32_t completionEntries);
+
+static void_t
+_gekkota_socket_queue_close(GekkotaSocketQueue *queue);
+
+static struct io_uring_sqe *
+_gekkota_socket_queue_get_entry(GekkotaSocketQueue *queue);
+
+static int32_t
+_gekkota_socket_queue_submit(
+        GekkotaSocketQueue *queue,
+        uint32_t entryCount,
+        uint32_t completionCount);
+
+static int32_t
+_gekkota_socket_ring_post_receive(GekkotaSocketRing *ring);
+
+static void_t
+_gekkota_socket_ring_recycle_buffer(GekkotaSocketRing *ring, uint16_t bufferId);
+#endif /* HAVE_IO_URING */
+
 int32_t
 _gekkota_socket_startup(void_t)
 {
@@ -353,7 +541,7 @@ inline int32_t
 _gekkota_socket_send(
         socket_t socket,
         GekkotaSocketAddress *remoteSocketAddress,
-        GekkotaBuffer *buffers,
+        const GekkotaBuffer *buffers,
         size_t bufferCount)
 {
     int32_t sent = 0;
@@ -381,6 +569,135 @@ _gekkota_socket_send(
     return sent;
 }
 
+inline int32_t
+_gekkota_socket_send_batch(
+        socket_t socket,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount,
+        uint32_t offloads)
+{
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[GEKKOTA_SOCKET_MAX_BATCH_SIZE];
+#ifdef UDP_SEGMENT
+    GekkotaSocketSegmentation segmentation;
+#endif /* UDP_SEGMENT */
+    size_t runs[GEKKOTA_SOCKET_MAX_BATCH_SIZE];
+    size_t next;
+    int32_t sent = 0;
+    int32_t count, sentCount;
+    int32_t i;
+
+    while (datagramCount > 0)
+    {
+        memset(msgs, 0x00, sizeof(struct mmsghdr) * gekkota_utils_min(
+                datagramCount, GEKKOTA_SOCKET_MAX_BATCH_SIZE));
+#ifdef UDP_SEGMENT
+        segmentation.bufferCount = segmentation.controlCount = 0;
+#endif /* UDP_SEGMENT */
+
+        for (count = 0, next = 0;
+                count < GEKKOTA_SOCKET_MAX_BATCH_SIZE && next < datagramCount;
+                next += runs[count++])
+        {
+#ifdef UDP_SEGMENT
+            runs[count] = _gekkota_socket_prepare_message(
+                    &msgs[count].msg_hdr, &segmentation,
+                    &datagrams[next], datagramCount - next, offloads);
+#else
+            if (datagrams[next].remoteSocketAddress != NULL)
+            {
+                msgs[count].msg_hdr.msg_name = datagrams[next].remoteSocketAddress;
+                msgs[count].msg_hdr.msg_namelen = sizeof(GekkotaSocketAddress);
+            }
+
+            msgs[count].msg_hdr.msg_iov = (struct iovec *) datagrams[next].buffers;
+            msgs[count].msg_hdr.msg_iovlen = datagrams[next].bufferCount;
+            runs[count] = 1;
+#endif /* UDP_SEGMENT */
+        }
+
+        if ((i = sendmmsg(socket, msgs, count, MSG_NOSIGNAL)) == -1)
+        {
+            if (errno == EWOULDBLOCK)
+                return sent;
+
+#ifdef UDP_SEGMENT
+            /*
+             * Segmented messages are refused if, for instance, segments do
+             * not fit the path MTU: send those datagrams one by one.
+             */
+            if (runs[0] > 1 && (errno == EINVAL || errno == EIO))
+            {
+                if ((i = _gekkota_socket_send_batch(
+                        socket, datagrams, runs[0], 0)) == -1)
+                    return sent > 0 ? sent : -1;
+
+                sent += i;
+
+                if ((size_t) i < runs[0])
+                    break;
+
+                datagrams += runs[0];
+                datagramCount -= runs[0];
+                continue;
+            }
+#endif /* UDP_SEGMENT */
+
+            /*
+             * If some datagrams have already been handed to the kernel,
+             * report them; the error will be raised again by the next call
+             */
+            if (sent > 0)
+                return sent;
+
+            errno = _gekkota_socket_transcode_error(errno, GEKKOTA_ERROR_NETWORK_FAILURE);
+            return -1;
+        }
+
+        for (next = 0, sentCount = i, i = 0; i < sentCount; next += runs[i++])
+        {
+#ifdef UDP_SEGMENT
+            if (runs[i] > 1)
+                _gekkota_socket_set_sent_lengths(&datagrams[next], runs[i]);
+            else
+#endif /* UDP_SEGMENT */
+                datagrams[next].length = msgs[i].msg_len;
+        }
+
+        sent += (int32_t) next;
+
+        if (sentCount < count)
+            break;  /* socket send buffer full */
+
+        datagrams += next;
+        datagramCount -= next;
+    }
+
+    return sent;
+#else
+    int32_t sent = 0;
+    int32_t length;
+
+    for (; datagramCount > 0; datagrams++, datagramCount--)
+    {
+        if ((length = _gekkota_socket_send(
+                socket,
+                datagrams->remoteSocketAddress,
+                datagrams->buffers,
+                datagrams->bufferCount)) == -1)
+            return sent > 0 ? sent : -1;
+
+        if (length == 0)
+            break;  /* socket send buffer full */
+
+        datagrams->length = (size_t) length;
+        sent++;
+    }
+
+    return sent;
+#endif /* HAVE_SENDMMSG */
+}
+
 inline int32_t
 _gekkota_socket_receive(
         socket_t socket,
@@ -401,7 +718,7 @@ _gekkota_socket_receive(
     msg.msg_iov = (struct iovec *) buffers;
     msg.msg_iovlen = bufferCount;
 
-    if ((recv = recvmsg(socket, &msg, MSG_NOSIGNAL)) == -1)
+    if ((recv = recvmsg(socket, &msg, 0)) == -1)
     {
         if (errno == EWOULDBLOCK)
             return 0;
@@ -421,6 +738,1028 @@ _gekkota_socket_receive(
     return recv;
 }
 
+inline int32_t
+_gekkota_socket_receive_batch(
+        socket_t socket,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount)
+{
+#ifdef HAVE_RECVMMSG
+    struct mmsghdr msgs[GEKKOTA_SOCKET_MAX_BATCH_SIZE];
+#if defined (UDP_GRO) || defined (HAVE_SO_TIMESTAMPING)
+    GekkotaSocketReceiveControl controls[GEKKOTA_SOCKET_MAX_BATCH_SIZE];
+#endif /* UDP_GRO || HAVE_SO_TIMESTAMPING */
+#ifdef HAVE_SO_TIMESTAMPING
+    GekkotaSocketClock clock = { 0, 0 };
+#endif /* HAVE_SO_TIMESTAMPING */
+    int32_t recv;
+    int32_t i;
+
+    /*
+     * The caller is expected to walk the received datagrams before
+     * asking for more, so a single system call is issued.
+     */
+    recv = (int32_t) gekkota_utils_min(datagramCount, GEKKOTA_SOCKET_MAX_BATCH_SIZE);
+    memset(msgs, 0x00, sizeof(struct mmsghdr) * recv);
+
+    for (i = 0; i < recv; i++)
+    {
+        if (datagrams[i].remoteSocketAddress != NULL)
+        {
+            msgs[i].msg_hdr.msg_name = datagrams[i].remoteSocketAddress;
+            msgs[i].msg_hdr.msg_namelen = sizeof(GekkotaSocketAddress);
+        }
+
+        msgs[i].msg_hdr.msg_iov = (struct iovec *) datagrams[i].buffers;
+        msgs[i].msg_hdr.msg_iovlen = datagrams[i].bufferCount;
+
+#if defined (UDP_GRO) || defined (HAVE_SO_TIMESTAMPING)
+        /*
+         * Only filled in on sockets coalescing incoming datagrams or
+         * with receive timestamps enabled.
+         */
+        msgs[i].msg_hdr.msg_control = controls[i].buffer;
+        msgs[i].msg_hdr.msg_controllen = sizeof(controls[i].buffer);
+#endif /* UDP_GRO || HAVE_SO_TIMESTAMPING */
+    }
+
+    if ((recv = recvmmsg(socket, msgs, recv, 0, NULL)) == -1)
+    {
+        if (errno == EWOULDBLOCK)
+            return 0;
+
+        errno = _gekkota_socket_transcode_error(errno, GEKKOTA_ERROR_NETWORK_FAILURE);
+        return -1;
+    }
+
+    for (i = 0; i < recv; i++)
+    {
+        /*
+         * Truncated datagrams are reported with length 0 instead of
+         * failing the whole batch.
+         */
+        datagrams[i].length = gekkota_bit_isset(msgs[i].msg_hdr.msg_flags, MSG_TRUNC)
+            ? 0
+            : msgs[i].msg_len;
+
+#ifdef UDP_GRO
+        datagrams[i].segmentSize = _gekkota_socket_get_segment_size(&msgs[i].msg_hdr);
+#else
+        datagrams[i].segmentSize = 0;
+#endif /* UDP_GRO */
+
+#ifdef HAVE_SO_TIMESTAMPING
+        datagrams[i].receiveTime = _gekkota_socket_get_receive_time(&msgs[i].msg_hdr, &clock);
+#else
+        datagrams[i].receiveTime = 0;
+#endif /* HAVE_SO_TIMESTAMPING */
+    }
+
+    return recv;
+#else
+    int32_t recv = 0;
+    int32_t length;
+
+    for (; datagramCount > 0; datagrams++, datagramCount--)
+    {
+        if ((length = _gekkota_socket_receive(
+                socket,
+                datagrams->buffers,
+                datagrams->bufferCount,
+                datagrams->remoteSocketAddress)) == -1)
+        {
+            if (errno != GEKKOTA_ERROR_MESSAGE_TRUNCATED)
+                return recv > 0 ? recv : -1;
+
+            length = 0;
+        }
+        else if (length == 0)
+            break;  /* no more data available */
+
+        datagrams->length = (size_t) length;
+        datagrams->segmentSize = 0;
+        datagrams->receiveTime = 0;
+        recv++;
+    }
+
+    return recv;
+#endif /* HAVE_RECVMMSG */
+}
+
+uint32_t
+_gekkota_socket_probe_offloads(socket_t socket)
+{
+    uint32_t offloads = 0;
+#if defined (UDP_SEGMENT) || defined (UDP_GRO)
+    int32_t value;
+    socklen_t length;
+#endif /* UDP_SEGMENT || UDP_GRO */
+
+    /*
+     * Kernels that know about an option also let it be read.
+     */
+#ifdef UDP_SEGMENT
+    length = sizeof(int32_t);
+
+    if (getsockopt(socket, IPPROTO_UDP, UDP_SEGMENT, &value, &length) == 0)
+        gekkota_bit_set(offloads, GEKKOTA_SOCKET_OFFLOAD_SEGMENTATION);
+#endif /* UDP_SEGMENT */
+
+#ifdef UDP_GRO
+    length = sizeof(int32_t);
+
+    if (getsockopt(socket, IPPROTO_UDP, UDP_GRO, &value, &length) == 0)
+        gekkota_bit_set(offloads, GEKKOTA_SOCKET_OFFLOAD_COALESCING);
+#endif /* UDP_GRO */
+
+    return offloads;
+}
+
+int32_t
+_gekkota_socket_enable_offload(socket_t socket, uint32_t offload)
+{
+#ifdef UDP_GRO
+    int32_t enable = 1;
+
+    /*
+     * Segmentation is requested message by message, so only coalescing
+     * has to be turned on.
+     */
+    if (offload == GEKKOTA_SOCKET_OFFLOAD_COALESCING)
+        return _gekkota_socket_setsockopt(
+                socket, IPPROTO_UDP, UDP_GRO, &enable, sizeof(int32_t));
+#endif /* UDP_GRO */
+
+    errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+    return -1;
+}
+
+int32_t
+_gekkota_socket_enable_receive_timestamps(socket_t socket)
+{
+#ifdef HAVE_SO_TIMESTAMPING
+    int32_t flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+
+    /*
+     * Software timestamps are taken as datagrams enter the network stack;
+     * hardware ones would come from a clock of the interface.
+     */
+    return _gekkota_socket_setsockopt(
+            socket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(int32_t));
+#else
+    errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+    return -1;
+#endif /* HAVE_SO_TIMESTAMPING */
+}
+
+GekkotaSocketRing *
+_gekkota_socket_ring_new(socket_t socket, size_t bufferSize)
+{
+#ifdef HAVE_IO_URING
+    GekkotaSocketRing *ring;
+    struct io_uring_buf_reg bufferReg;
+    uint16_t i;
+
+    if ((ring = gekkota_memory_alloc(sizeof(GekkotaSocketRing), TRUE)) == NULL)
+        return NULL;
+
+    ring->socket = socket;
+    ring->sendQueue.fd = ring->receiveQueue.fd = -1;
+
+    /*
+     * Every receive buffer starts with the header the kernel describes
+     * the datagram with, followed by the source address and the receive
+     * timestamp, if any.
+     */
+    ring->receiveHeader.msg_namelen = sizeof(GekkotaSocketAddress);
+    ring->receiveHeader.msg_controllen = GEKKOTA_SOCKET_TIMESTAMP_CONTROL_SIZE;
+    ring->bufferSize = sizeof(struct io_uring_recvmsg_out)
+        + sizeof(GekkotaSocketAddress)
+        + GEKKOTA_SOCKET_TIMESTAMP_CONTROL_SIZE + bufferSize;
+
+    /*
+     * Sends and receives complete on rings of their own, so that waiting
+     * for a batch of sends never has to step over incoming datagrams.
+     */
+    if (_gekkota_socket_queue_open(
+            &ring->sendQueue,
+            GEKKOTA_SOCKET_MAX_BATCH_SIZE, 0) != 0 ||
+        _gekkota_socket_queue_open(
+            &ring->receiveQueue,
+            1, GEKKOTA_SOCKET_RING_BUFFER_COUNT * 2) != 0)
+        goto error;
+
+    if ((ring->buffers = gekkota_memory_alloc(
+            ring->bufferSize * GEKKOTA_SOCKET_RING_BUFFER_COUNT, FALSE)) == NULL)
+        goto error;
+
+    /*
+     * The buffer ring is shared with the kernel and must be page aligned.
+     */
+    ring->bufferRingSize = sizeof(struct io_uring_buf) * GEKKOTA_SOCKET_RING_BUFFER_COUNT;
+
+    if ((ring->bufferRing = mmap(
+            NULL, ring->bufferRingSize,
+            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+            -1, 0)) == MAP_FAILED)
+    {
+        ring->bufferRing = NULL;
+        errno = GEKKOTA_ERROR_OUT_OF_MEMORY;
+        goto error;
+    }
+
+    memset(&bufferReg, 0x00, sizeof(struct io_uring_buf_reg));
+    bufferReg.ring_addr = (uint64_t) (uintptr_t) ring->bufferRing;
+    bufferReg.ring_entries = GEKKOTA_SOCKET_RING_BUFFER_COUNT;
+    bufferReg.bgid = GEKKOTA_SOCKET_RING_BUFFER_GROUP;
+
+    if (syscall(__NR_io_uring_register, ring->receiveQueue.fd,
+            IORING_REGISTER_PBUF_RING, &bufferReg, 1) == -1)
+    {
+        errno = _gekkota_socket_transcode_error(errno, GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED);
+        goto error;
+    }
+
+    for (i = 0; i < GEKKOTA_SOCKET_RING_BUFFER_COUNT; i++)
+        _gekkota_socket_ring_recycle_buffer(ring, i);
+
+    __atomic_store_n(&ring->bufferRing->tail, ring->bufferTail, __ATOMIC_RELEASE);
+
+    if (_gekkota_socket_ring_post_receive(ring) != 0)
+        goto error;
+
+    return ring;
+
+error:
+    _gekkota_socket_ring_destroy(ring);
+    return NULL;
+#else
+    errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+    return NULL;
+#endif /* HAVE_IO_URING */
+}
+
+void_t
+_gekkota_socket_ring_destroy(GekkotaSocketRing *ring)
+{
+#ifdef HAVE_IO_URING
+    struct io_uring_buf_reg bufferReg;
+
+    if (ring->bufferRing != NULL)
+    {
+        /*
+         * Unregistering the buffers makes sure the kernel no longer writes
+         * to them, whatever is still pending when the rings are closed.
+         */
+        if (ring->receiveQueue.fd != -1)
+        {
+            memset(&bufferReg, 0x00, sizeof(struct io_uring_buf_reg));
+            bufferReg.bgid = GEKKOTA_SOCKET_RING_BUFFER_GROUP;
+
+            syscall(__NR_io_uring_register, ring->receiveQueue.fd,
+                    IORING_UNREGISTER_PBUF_RING, &bufferReg, 1);
+        }
+
+        munmap(ring->bufferRing, ring->bufferRingSize);
+    }
+
+    _gekkota_socket_queue_close(&ring->receiveQueue);
+    _gekkota_socket_queue_close(&ring->sendQueue);
+
+    if (ring->buffers != NULL)
+        gekkota_memory_free(ring->buffers);
+
+    gekkota_memory_free(ring);
+#endif /* HAVE_IO_URING */
+}
+
+socket_t
+_gekkota_socket_ring_get_handle(const GekkotaSocketRing *ring)
+{
+#ifdef HAVE_IO_URING
+    /*
+     * The completion ring becomes readable as datagrams are received.
+     */
+    return ring->receiveQueue.fd;
+#else
+    return GEKKOTA_INVALID_SOCKET;
+#endif /* HAVE_IO_URING */
+}
+
+int32_t
+_gekkota_socket_ring_poll(GekkotaSocketRing *ring, int32_t timeout)
+{
+#ifdef HAVE_IO_URING
+    if (!ring->isReceiving && _gekkota_socket_ring_post_receive(ring) != 0)
+        return -1;
+
+    if (*ring->receiveQueue.cqHead !=
+            __atomic_load_n(ring->receiveQueue.cqTail, __ATOMIC_ACQUIRE))
+        return 1;
+
+    return _gekkota_socket_poll(ring->receiveQueue.fd, GEKKOTA_SELECT_MODE_READ, timeout);
+#else
+    errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+    return -1;
+#endif /* HAVE_IO_URING */
+}
+
+int32_t
+_gekkota_socket_ring_send_batch(
+        GekkotaSocketRing *ring,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount,
+        uint32_t offloads)
+{
+#ifdef HAVE_IO_URING
+    struct msghdr msgs[GEKKOTA_SOCKET_MAX_BATCH_SIZE];
+#ifdef UDP_SEGMENT
+    GekkotaSocketSegmentation segmentation;
+#endif /* UDP_SEGMENT */
+    size_t runs[GEKKOTA_SOCKET_MAX_BATCH_SIZE];
+    size_t firsts[GEKKOTA_SOCKET_MAX_BATCH_SIZE];
+    struct io_uring_sqe *sqe;
+    struct io_uring_cqe *cqe;
+    GekkotaSocketQueue *queue = &ring->sendQueue;
+    uint32_t head, tail;
+    size_t next, completed;
+    int32_t sent = 0, count, submitted, result, i;
+    int32_t error, failed = 0;
+
+    while (datagramCount > 0)
+    {
+#ifdef UDP_SEGMENT
+        segmentation.bufferCount = segmentation.controlCount = 0;
+#endif /* UDP_SEGMENT */
+
+        for (count = 0, next = 0;
+                count < GEKKOTA_SOCKET_MAX_BATCH_SIZE && next < datagramCount;
+                next += runs[count++])
+        {
+            firsts[count] = next;
+
+#ifdef UDP_SEGMENT
+            runs[count] = _gekkota_socket_prepare_message(
+                    &msgs[count], &segmentation,
+                    &datagrams[next], datagramCount - next, offloads);
+#else
+            memset(&msgs[count], 0x00, sizeof(struct msghdr));
+
+            if (datagrams[next].remoteSocketAddress != NULL)
+            {
+                msgs[count].msg_name = datagrams[next].remoteSocketAddress;
+                msgs[count].msg_namelen = sizeof(GekkotaSocketAddress);
+            }
+
+            msgs[count].msg_iov = (struct iovec *) datagrams[next].buffers;
+            msgs[count].msg_iovlen = datagrams[next].bufferCount;
+            runs[count] = 1;
+#endif /* UDP_SEGMENT */
+
+            sqe = _gekkota_socket_queue_get_entry(queue);
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = ring->socket;
+            sqe->addr = (uint64_t) (uintptr_t) &msgs[count];
+            sqe->len = 1;
+            sqe->msg_flags = MSG_NOSIGNAL;
+            sqe->user_data = (uint64_t) count;
+
+            /*
+             * Linked sends go out in order, and the first one that fails
+             * cancels the others, just like a short sendmmsg().
+             */
+            sqe->flags = IOSQE_IO_LINK;
+        }
+
+        /*
+         * The last send of the batch ends the chain.
+         */
+        sqe->flags = 0;
+
+        /*
+         * The whole batch is submitted with a single system call, which
+         * also waits for it: the messages live on the stack.
+         */
+        if ((submitted = _gekkota_socket_queue_submit(queue, count, count)) == -1)
+            return sent > 0 ? sent : -1;
+
+        head = *queue->cqHead;
+        tail = __atomic_load_n(queue->cqTail, __ATOMIC_ACQUIRE);
+
+        for (completed = 0, error = 0; head != tail; head++)
+        {
+            cqe = &queue->cqes[head & queue->cqMask];
+            i = (int32_t) cqe->user_data;
+
+            if (cqe->res < 0)
+            {
+                if (error == 0 || error == ECANCELED)
+                {
+                    error = -cqe->res;
+                    failed = i;
+                }
+
+                continue;
+            }
+
+#ifdef UDP_SEGMENT
+            if (runs[i] > 1)
+                _gekkota_socket_set_sent_lengths(&datagrams[firsts[i]], runs[i]);
+            else
+#endif /* UDP_SEGMENT */
+                datagrams[firsts[i]].length = (size_t) cqe->res;
+
+            completed += runs[i];
+        }
+
+        __atomic_store_n(queue->cqHead, head, __ATOMIC_RELEASE);
+
+        /*
+         * Sends past a failed one were cancelled, so [completed] is also
+         * the index of the first datagram not sent.
+         */
+        sent += (int32_t) completed;
+
+        if (error != 0)
+        {
+#ifdef UDP_SEGMENT
+            /*
+             * Segmented messages are refused if, for instance, segments do
+             * not fit the path MTU: send those datagrams one by one.
+             */
+            if (runs[failed] > 1 && (error == EINVAL || error == EIO))
+            {
+                if ((result = _gekkota_socket_ring_send_batch(
+                        ring, &datagrams[completed], runs[failed], 0)) == -1)
+                    return sent > 0 ? sent : -1;
+
+                sent += result;
+
+                if ((size_t) result < runs[failed])
+                    return sent;
+
+                datagrams += completed + runs[failed];
+                datagramCount -= completed + runs[failed];
+                continue;
+            }
+#endif /* UDP_SEGMENT */
+
+            if (error == EWOULDBLOCK || sent > 0)
+                return sent;
+
+            errno = _gekkota_socket_transcode_error(error, GEKKOTA_ERROR_NETWORK_FAILURE);
+            return -1;
+        }
+
+        /*
+         * Sends the kernel did not take were never queued: stop there,
+         * like a short sendmmsg().
+         */
+        if (submitted < count)
+            return sent;
+
+        datagrams += next;
+        datagramCount -= next;
+    }
+
+    return sent;
+#else
+    errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+    return -1;
+#endif /* HAVE_IO_URING */
+}
+
+int32_t
+_gekkota_socket_ring_receive_batch(
+        GekkotaSocketRing *ring,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount)
+{
+#ifdef HAVE_IO_URING
+    struct io_uring_cqe *cqe;
+    struct io_uring_recvmsg_out *out;
+#ifdef HAVE_SO_TIMESTAMPING
+    struct msghdr msg;
+    GekkotaSocketClock clock = { 0, 0 };
+#endif /* HAVE_SO_TIMESTAMPING */
+    GekkotaSocketQueue *queue = &ring->receiveQueue;
+    GekkotaDatagram *datagram;
+    byte_t *buffer, *payload;
+    size_t length, available, i;
+    uint32_t head, tail;
+    uint16_t bufferId;
+    int32_t recv = 0;
+    int32_t error = 0;
+
+    if (!ring->isReceiving && _gekkota_socket_ring_post_receive(ring) != 0)
+        return -1;
+
+    head = *queue->cqHead;
+    tail = __atomic_load_n(queue->cqTail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail && (size_t) recv < datagramCount && error == 0; head++)
+    {
+        cqe = &queue->cqes[head & queue->cqMask];
+
+        /*
+         * The kernel stops receiving when it runs out of buffers or on
+         * errors; the receive is posted again once buffers are back.
+         */
+        if (!gekkota_bit_isset(cqe->flags, IORING_CQE_F_MORE))
+            ring->isReceiving = FALSE;
+
+        if (cqe->res < 0)
+        {
+            if (cqe->res != -ENOBUFS)
+                error = -cqe->res;
+
+            continue;
+        }
+
+        if (!gekkota_bit_isset(cqe->flags, IORING_CQE_F_BUFFER))
+            continue;
+
+        bufferId = (uint16_t) (cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        buffer = ring->buffers + (ring->bufferSize * bufferId);
+        out = (struct io_uring_recvmsg_out *) buffer;
+        payload = buffer + sizeof(struct io_uring_recvmsg_out)
+            + ring->receiveHeader.msg_namelen
+            + ring->receiveHeader.msg_controllen;
+        available = (size_t) cqe->res - (size_t) (payload - buffer);
+
+        datagram = &datagrams[recv++];
+
+        if (datagram->remoteSocketAddress != NULL)
+            memcpy(datagram->remoteSocketAddress,
+                    buffer + sizeof(struct io_uring_recvmsg_out),
+                    gekkota_utils_min(out->namelen, sizeof(GekkotaSocketAddress)));
+
+        /*
+         * The payload is copied out so the buffer can be handed back to
+         * the kernel right away.
+         */
+        for (i = 0, length = 0; i < datagram->bufferCount && length < available; i++)
+        {
+            size_t chunk = gekkota_utils_min(
+                    datagram->buffers[i].length, available - length);
+
+            memcpy(datagram->buffers[i].data, payload + length, chunk);
+            length += chunk;
+        }
+
+        /*
+         * Truncated datagrams are reported with length 0 instead of
+         * failing the whole batch.
+         */
+        datagram->length = gekkota_bit_isset(out->flags, MSG_TRUNC) ||
+            out->payloadlen > length
+                ? 0
+                : length;
+        datagram->segmentSize = 0;
+
+#ifdef HAVE_SO_TIMESTAMPING
+        memset(&msg, 0x00, sizeof(struct msghdr));
+        msg.msg_control = buffer + sizeof(struct io_uring_recvmsg_out)
+            + ring->receiveHeader.msg_namelen;
+        msg.msg_controllen = out->controllen;
+        datagram->receiveTime = _gekkota_socket_get_receive_time(&msg, &clock);
+#else
+        datagram->receiveTime = 0;
+#endif /* HAVE_SO_TIMESTAMPING */
+
+        _gekkota_socket_ring_recycle_buffer(ring, bufferId);
+    }
+
+    __atomic_store_n(&ring->bufferRing->tail, ring->bufferTail, __ATOMIC_RELEASE);
+    __atomic_store_n(queue->cqHead, head, __ATOMIC_RELEASE);
+
+    if (!ring->isReceiving && _gekkota_socket_ring_post_receive(ring) != 0 && recv == 0)
+        return -1;
+
+    if (error != 0 && recv == 0)
+    {
+        errno = _gekkota_socket_transcode_error(error, GEKKOTA_ERROR_NETWORK_FAILURE);
+        return -1;
+    }
+
+    return recv;
+#else
+    errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+    return -1;
+#endif /* HAVE_IO_URING */
+}
+
+#ifdef HAVE_IO_URING
+static int32_t
+_gekkota_socket_queue_open(
+        GekkotaSocketQueue *queue,
+        uint32_t entries,
+        uint32_t completionEntries)
+{
+    struct io_uring_params params;
+    byte_t *rings;
+    size_t sqSize, cqSize;
+
+    memset(&params, 0x00, sizeof(struct io_uring_params));
+
+    if (completionEntries > 0)
+    {
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = completionEntries;
+    }
+
+    if ((queue->fd = (int32_t) syscall(__NR_io_uring_setup, entries, &params)) == -1)
+    {
+        errno = errno == ENOSYS || errno == EPERM
+            ? GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED
+            : _gekkota_socket_transcode_error(errno, GEKKOTA_ERROR_NO_RESOURCE_AVAILABLE);
+        return -1;
+    }
+
+    /*
+     * Kernels old enough to map the SQ and CQ rings separately do not
+     * support multishot receives either.
+     */
+    if (!gekkota_bit_isset(params.features, IORING_FEAT_SINGLE_MMAP))
+    {
+        _gekkota_socket_queue_close(queue);
+        errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+        return -1;
+    }
+
+    sqSize = params.sq_off.array + (params.sq_entries * sizeof(uint32_t));
+    cqSize = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+    queue->ringsSize = gekkota_utils_max(sqSize, cqSize);
+    queue->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if ((rings = mmap(
+            NULL, queue->ringsSize,
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            queue->fd, IORING_OFF_SQ_RING)) == MAP_FAILED)
+    {
+        _gekkota_socket_queue_close(queue);
+        errno = GEKKOTA_ERROR_OUT_OF_MEMORY;
+        return -1;
+    }
+
+    queue->rings = rings;
+
+    if ((queue->sqes = mmap(
+            NULL, queue->sqesSize,
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            queue->fd, IORING_OFF_SQES)) == MAP_FAILED)
+    {
+        queue->sqes = NULL;
+        _gekkota_socket_queue_close(queue);
+        errno = GEKKOTA_ERROR_OUT_OF_MEMORY;
+        return -1;
+    }
+
+    queue->sqHead = (uint32_t *) (rings + params.sq_off.head);
+    queue->sqTail = (uint32_t *) (rings + params.sq_off.tail);
+    queue->sqArray = (uint32_t *) (rings + params.sq_off.array);
+    queue->sqMask = *(uint32_t *) (rings + params.sq_off.ring_mask);
+    queue->sqEntries = params.sq_entries;
+    queue->cqHead = (uint32_t *) (rings + params.cq_off.head);
+    queue->cqTail = (uint32_t *) (rings + params.cq_off.tail);
+    queue->cqMask = *(uint32_t *) (rings + params.cq_off.ring_mask);
+    queue->cqes = (struct io_uring_cqe *) (rings + params.cq_off.cqes);
+
+    return 0;
+}
+
+static void_t
+_gekkota_socket_queue_close(GekkotaSocketQueue *queue)
+{
+    if (queue->sqes != NULL)
+        munmap(queue->sqes, queue->sqesSize);
+
+    if (queue->rings != NULL)
+        munmap(queue->rings, queue->ringsSize);
+
+    if (queue->fd != -1)
+        close(queue->fd);
+
+    queue->sqes = NULL;
+    queue->rings = NULL;
+    queue->fd = -1;
+}
+
+static struct io_uring_sqe *
+_gekkota_socket_queue_get_entry(GekkotaSocketQueue *queue)
+{
+    struct io_uring_sqe *sqe;
+    uint32_t tail = *queue->sqTail + queue->sqPending++;
+
+    /*
+     * Callers never queue more entries than the ring holds and submit
+     * them all at once, so there is always room. The entries are only
+     * published by _gekkota_socket_queue_submit().
+     */
+    sqe = &queue->sqes[tail & queue->sqMask];
+    memset(sqe, 0x00, sizeof(struct io_uring_sqe));
+
+    queue->sqArray[tail & queue->sqMask] = tail & queue->sqMask;
+
+    return sqe;
+}
+
+static int32_t
+_gekkota_socket_queue_submit(
+        GekkotaSocketQueue *queue,
+        uint32_t entryCount,
+        uint32_t completionCount)
+{
+    uint32_t flags = completionCount > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int32_t submitted = 0, result, error = 0;
+
+    __atomic_store_n(queue->sqTail, *queue->sqTail + queue->sqPending, __ATOMIC_RELEASE);
+    queue->sqPending = 0;
+
+    /*
+     * Once submitted, entries may still reference the caller's memory:
+     * interruptions are retried until the completions are in.
+     */
+    while (TRUE)
+    {
+        result = (int32_t) syscall(__NR_io_uring_enter, queue->fd,
+                entryCount - submitted, completionCount, flags, NULL, 0);
+
+        if (result >= 0)
+        {
+            submitted += result;
+
+            if ((uint32_t) submitted == entryCount || result == 0)
+                break;
+
+            continue;
+        }
+
+        if (errno != EINTR && errno != EAGAIN)
+        {
+            error = errno;
+            break;
+        }
+    }
+
+    /*
+     * Entries the kernel did not take would otherwise be picked up by the
+     * next submission, long after the memory they reference is gone.
+     */
+    if ((uint32_t) submitted < entryCount)
+    {
+        __atomic_store_n(queue->sqTail,
+                __atomic_load_n(queue->sqHead, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+
+        if (completionCount > (uint32_t) submitted)
+            completionCount = (uint32_t) submitted;
+    }
+
+    /*
+     * Make sure every completion has been posted, entries submitted by
+     * an interrupted call included.
+     */
+    while (completionCount > 0 &&
+            __atomic_load_n(queue->cqTail, __ATOMIC_ACQUIRE) - *queue->cqHead < completionCount)
+        if (syscall(__NR_io_uring_enter, queue->fd,
+                0, completionCount, flags, NULL, 0) == -1 && errno != EINTR)
+        {
+            errno = _gekkota_socket_transcode_error(errno, GEKKOTA_ERROR_NETWORK_FAILURE);
+            return -1;
+        }
+
+    if (submitted == 0 && entryCount > 0)
+    {
+        errno = error != 0
+            ? _gekkota_socket_transcode_error(error, GEKKOTA_ERROR_NETWORK_FAILURE)
+            : GEKKOTA_ERROR_NO_RESOURCE_AVAILABLE;
+        return -1;
+    }
+
+    return submitted;
+}
+
+static int32_t
+_gekkota_socket_ring_post_receive(GekkotaSocketRing *ring)
+{
+    struct io_uring_sqe *sqe;
+
+    /*
+     * A single multishot receive keeps picking datagrams into the
+     * registered buffers until it runs out of them.
+     */
+    sqe = _gekkota_socket_queue_get_entry(&ring->receiveQueue);
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = ring->socket;
+    sqe->addr = (uint64_t) (uintptr_t) &ring->receiveHeader;
+    sqe->len = 1;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->buf_group = GEKKOTA_SOCKET_RING_BUFFER_GROUP;
+
+    if (_gekkota_socket_queue_submit(&ring->receiveQueue, 1, 0) == -1)
+        return -1;
+
+    ring->isReceiving = TRUE;
+    return 0;
+}
+
+static void_t
+_gekkota_socket_ring_recycle_buffer(GekkotaSocketRing *ring, uint16_t bufferId)
+{
+    struct io_uring_buf *buffer;
+
+    /*
+     * Set field by field: the first entry overlays the ring tail. The new
+     * tail is published by the caller once done.
+     */
+    buffer = &ring->bufferRing->bufs[
+        ring->bufferTail & (GEKKOTA_SOCKET_RING_BUFFER_COUNT - 1)];
+    buffer->addr = (uint64_t) (uintptr_t) (ring->buffers + (ring->bufferSize * bufferId));
+    buffer->len = (uint32_t) ring->bufferSize;
+    buffer->bid = bufferId;
+
+    ++ring->bufferTail;
+}
+#endif /* HAVE_IO_URING */
+
+#ifdef UDP_SEGMENT
+static size_t
+_gekkota_socket_prepare_message(
+        struct msghdr *msg,
+        GekkotaSocketSegmentation *segmentation,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount,
+        uint32_t offloads)
+{
+    struct cmsghdr *cmsg;
+    struct iovec *buffers;
+    size_t segmentSize, totalSize, size, bufferCount, count, i;
+
+    memset(msg, 0x00, sizeof(struct msghdr));
+
+    if (datagrams->remoteSocketAddress != NULL)
+    {
+        msg->msg_name = datagrams->remoteSocketAddress;
+        msg->msg_namelen = sizeof(GekkotaSocketAddress);
+    }
+
+    msg->msg_iov = (struct iovec *) datagrams->buffers;
+    msg->msg_iovlen = datagrams->bufferCount;
+
+    if (!gekkota_bit_isset(offloads, GEKKOTA_SOCKET_OFFLOAD_SEGMENTATION) ||
+            datagramCount < 2)
+        return 1;
+
+    for (i = 0, segmentSize = 0; i < datagrams->bufferCount; i++)
+        segmentSize += datagrams->buffers[i].length;
+
+    totalSize = segmentSize;
+    bufferCount = datagrams->bufferCount;
+
+    /*
+     * Extend the run while datagrams go to the same destination and are
+     * as large as the first; a shorter one ends it.
+     */
+    for (count = 1;
+            count < datagramCount && count < GEKKOTA_SOCKET_MAX_SEGMENTS;
+            count++)
+    {
+        GekkotaDatagram *datagram = &datagrams[count];
+
+        if (datagram->remoteSocketAddress != datagrams->remoteSocketAddress &&
+                (datagram->remoteSocketAddress == NULL ||
+                 datagrams->remoteSocketAddress == NULL ||
+                 memcmp(datagram->remoteSocketAddress,
+                        datagrams->remoteSocketAddress,
+                        sizeof(GekkotaSocketAddress)) != 0))
+            break;
+
+        for (i = 0, size = 0; i < datagram->bufferCount; i++)
+            size += datagram->buffers[i].length;
+
+        if (size == 0 || size > segmentSize ||
+                totalSize + size > GEKKOTA_SOCKET_MAX_SEGMENTED_SIZE ||
+                segmentation->bufferCount + bufferCount + datagram->bufferCount >
+                    GEKKOTA_SOCKET_MAX_SEGMENT_BUFFERS)
+            break;
+
+        totalSize += size;
+        bufferCount += datagram->bufferCount;
+
+        if (size < segmentSize)
+        {
+            ++count;
+            break;
+        }
+    }
+
+    if (count < 2 || segmentSize == 0)
+        return 1;
+
+    buffers = &segmentation->buffers[segmentation->bufferCount];
+
+    for (i = 0, bufferCount = 0; i < count; i++)
+    {
+        memcpy(&buffers[bufferCount], datagrams[i].buffers,
+                sizeof(struct iovec) * datagrams[i].bufferCount);
+        bufferCount += datagrams[i].bufferCount;
+    }
+
+    segmentation->bufferCount += bufferCount;
+
+    msg->msg_iov = buffers;
+    msg->msg_iovlen = bufferCount;
+    msg->msg_control = segmentation->controls[segmentation->controlCount++].buffer;
+    msg->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+
+    cmsg = CMSG_FIRSTHDR(msg);
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    *(uint16_t *) CMSG_DATA(cmsg) = (uint16_t) segmentSize;
+
+    return count;
+}
+
+static void_t
+_gekkota_socket_set_sent_lengths(GekkotaDatagram *datagrams, size_t datagramCount)
+{
+    size_t i;
+
+    /*
+     * A segmented message is sent as a whole or not at all.
+     */
+    for (; datagramCount > 0; datagrams++, datagramCount--)
+        for (i = 0, datagrams->length = 0; i < datagrams->bufferCount; i++)
+            datagrams->length += datagrams->buffers[i].length;
+}
+#endif /* UDP_SEGMENT */
+
+#ifdef UDP_GRO
+static size_t
+_gekkota_socket_get_segment_size(struct msghdr *msg)
+{
+    struct cmsghdr *cmsg;
+    int32_t segmentSize;
+
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO)
+        {
+            memcpy(&segmentSize, CMSG_DATA(cmsg), sizeof(int32_t));
+            return segmentSize > 0 ? (size_t) segmentSize : 0;
+        }
+    }
+
+    return 0;
+}
+#endif /* UDP_GRO */
+
+#ifdef HAVE_SO_TIMESTAMPING
+static uint64_t
+_gekkota_socket_get_receive_time(struct msghdr *msg, GekkotaSocketClock *clock)
+{
+    struct cmsghdr *cmsg;
+    struct scm_timestamping timestamping;
+    struct timeval timeVal;
+    uint64_t timestamp, age;
+
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING)
+            continue;
+
+        /*
+         * The software timestamp comes first; the others are left unset.
+         */
+        memcpy(&timestamping, CMSG_DATA(cmsg), sizeof(struct scm_timestamping));
+
+        if (timestamping.ts[0].tv_sec == 0 && timestamping.ts[0].tv_nsec == 0)
+            return 0;
+
+        if (clock->realTime == 0)
+        {
+            gettimeofday(&timeVal, NULL);
+            clock->realTime = (uint64_t) timeVal.tv_sec * 1000000 + timeVal.tv_usec;
+            clock->time = gekkota_time_now_us();
+        }
+
+        timestamp = (uint64_t) timestamping.ts[0].tv_sec * 1000000
+            + timestamping.ts[0].tv_nsec / 1000;
+
+        /*
+         * The wall clock may have been stepped since the datagram arrived.
+         */
+        age = clock->realTime > timestamp ? clock->realTime - timestamp : 0;
+
+        return age < clock->time ? clock->time - age : 0;
+    }
+
+    return 0;
+}
+#endif /* HAVE_SO_TIMESTAMPING */
+
 static int32_t
 _gekkota_socket_transcode_error(int32_t error, int32_t defaultError)
 {
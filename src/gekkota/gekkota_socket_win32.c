@@ -409,6 +409,35 @@ _gekkota_socket_send(
     return sent;
 }
 
+inline int32_t
+_gekkota_socket_send_batch(
+        socket_t socket,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount,
+        uint32_t offloads)
+{
+    int32_t sent = 0;
+    int32_t length;
+
+    for (; datagramCount > 0; datagrams++, datagramCount--)
+    {
+        if ((length = _gekkota_socket_send(
+                socket,
+                datagrams->remoteSocketAddress,
+                datagrams->buffers,
+                datagrams->bufferCount)) == -1)
+            return sent > 0 ? sent : -1;
+
+        if (length == 0)
+            break;  /* socket send buffer full */
+
+        datagrams->length = (size_t) length;
+        sent++;
+    }
+
+    return sent;
+}
+
 inline int32_t
 _gekkota_socket_receive(
         socket_t socket,
@@ -445,6 +474,114 @@ _gekkota_socket_receive(
     return (int32_t) recv;
 }
 
+inline int32_t
+_gekkota_socket_receive_batch(
+        socket_t socket,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount)
+{
+    int32_t recv = 0;
+    int32_t length;
+
+    for (; datagramCount > 0; datagrams++, datagramCount--)
+    {
+        if ((length = _gekkota_socket_receive(
+                socket,
+                datagrams->buffers,
+                datagrams->bufferCount,
+                datagrams->remoteSocketAddress)) == -1)
+        {
+            if (errno != GEKKOTA_ERROR_MESSAGE_TRUNCATED)
+                return recv > 0 ? recv : -1;
+
+            length = 0;
+        }
+        else if (length == 0)
+            break;  /* no more data available */
+
+        datagrams->length = (size_t) length;
+        datagrams->segmentSize = 0;
+        datagrams->receiveTime = 0;
+        recv++;
+    }
+
+    return recv;
+}
+
+uint32_t
+_gekkota_socket_probe_offloads(socket_t socket)
+{
+    /*
+     * UDP segmentation and receive coalescing offloads are not used on
+     * Windows.
+     */
+    return 0;
+}
+
+int32_t
+_gekkota_socket_enable_offload(socket_t socket, uint32_t offload)
+{
+    errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+    return -1;
+}
+
+int32_t
+_gekkota_socket_enable_receive_timestamps(socket_t socket)
+{
+    errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+    return -1;
+}
+
+GekkotaSocketRing *
+_gekkota_socket_ring_new(socket_t socket, size_t bufferSize)
+{
+    /*
+     * There is no io_uring on Windows: sockets keep being driven through
+     * plain system calls.
+     */
+    errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+    return NULL;
+}
+
+void_t
+_gekkota_socket_ring_destroy(GekkotaSocketRing *ring)
+{
+}
+
+socket_t
+_gekkota_socket_ring_get_handle(const GekkotaSocketRing *ring)
+{
+    return GEKKOTA_INVALID_SOCKET;
+}
+
+int32_t
+_gekkota_socket_ring_poll(GekkotaSocketRing *ring, int32_t timeout)
+{
+    errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+    return -1;
+}
+
+int32_t
+_gekkota_socket_ring_send_batch(
+        GekkotaSocketRing *ring,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount,
+        uint32_t offloads)
+{
+    errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+    return -1;
+}
+
+int32_t
+_gekkota_socket_ring_receive_batch(
+        GekkotaSocketRing *ring,
+        GekkotaDatagram *datagrams,
+        size_t datagramCount)
+{
+    errno = GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED;
+    return -1;
+}
+
 static int32_t
 _gekkota_socket_transcode_error(int32_t error, int32_t defaultError)
 {
@@ -9,8 +9,9 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include "gekkota.h"
 #include "gekkota_errors.h"
-#include "gekkota_hooks.h"
+#include "gekkota_string.h"
 
 int32_t
 _gekkota_string_to_unicode(
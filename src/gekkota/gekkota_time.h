@@ -10,11 +10,12 @@
 #ifndef __GEKKOTA_TIME_H__
 #define __GEKKOTA_TIME_H__
 
+#include <time.h>
 #include "gekkota/gekkota_types.h"
 
 #define GEKKOTA_TIME_OVERFLOW 86400000
 
-inline time_t gekkota_time_get_lag(time_t time1, time_t time2)
+static inline time_t gekkota_time_get_lag(time_t time1, time_t time2)
 {
     return (time1 - time2) >= GEKKOTA_TIME_OVERFLOW
         ? (time2 - time1)
@@ -27,4 +28,12 @@ gekkota_time_compare(time_t time1, time_t time2);
 GEKKOTA_API time_t
 gekkota_time_now();
 
+/*
+ * Returns the monotonic clock in microseconds, for measuring intervals
+ * shorter than a millisecond; the origin is unrelated to the one of
+ * gekkota_time_now().
+ */
+GEKKOTA_API uint64_t
+gekkota_time_now_us(void_t);
+
 #endif /* !__GEKKOTA_TIME_H__ */
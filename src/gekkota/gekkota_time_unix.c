@@ -7,13 +7,45 @@
  * All right reserved.
  ******************************************************************************/
 
+#ifdef HAVE_CLOCK_GETTIME
+#include <time.h>
+#endif /* HAVE_CLOCK_GETTIME */
 #include "gekkota.h"
 
+/*
+ * Timers are driven by the monotonic clock so that wall clock steps, like
+ * the ones made by NTP, do not expire or postpone them; the coarse variant
+ * is not used since its resolution can reach 4 milliseconds.
+ */
+
 uint32_t
 gekkota_time_now(void_t)
 {
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec timeSpec;
+
+    clock_gettime(CLOCK_MONOTONIC, &timeSpec);
+    return (uint32_t) (timeSpec.tv_sec * 1000 + timeSpec.tv_nsec / 1000000);
+#else
     struct timeval timeVal;
 
     gettimeofday(&timeVal, NULL);
     return timeVal.tv_sec * 1000 + timeVal.tv_usec / 1000;
+#endif /* HAVE_CLOCK_GETTIME */
+}
+
+uint64_t
+gekkota_time_now_us(void_t)
+{
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec timeSpec;
+
+    clock_gettime(CLOCK_MONOTONIC, &timeSpec);
+    return (uint64_t) timeSpec.tv_sec * 1000000 + timeSpec.tv_nsec / 1000;
+#else
+    struct timeval timeVal;
+
+    gettimeofday(&timeVal, NULL);
+    return (uint64_t) timeVal.tv_sec * 1000000 + timeVal.tv_usec;
+#endif /* HAVE_CLOCK_GETTIME */
 }
@@ -14,3 +14,16 @@ gekkota_time_now(void_t)
 {
     return (uint32_t) timeGetTime();
 }
+
+uint64_t
+gekkota_time_now_us(void_t)
+{
+    LARGE_INTEGER counter, frequency;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return (uint64_t) (counter.QuadPart / frequency.QuadPart) * 1000000
+        + (uint64_t) (counter.QuadPart % frequency.QuadPart) * 1000000
+        / frequency.QuadPart;
+}
@@ -12,7 +12,7 @@
 int32_t
 _gekkota_initialize(void_t)
 {
-    return gekkota_socket_startup();
+    return _gekkota_socket_startup();
 }
 
 int32_t
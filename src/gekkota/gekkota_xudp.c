@@ -10,6 +10,7 @@
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include "gekkota.h"
 #include "gekkota_bit.h"
 #include "gekkota_dns.h"
@@ -29,14 +30,62 @@
 #define GEKKOTA_XUDP_MULTICAST_ID_LENGTH        INET6_ADDRSTRLEN + \
                                                 GEKKOTA_XUDP_MULTICAST_PORT_LENGTH
 
+/*
+ * Offset of the session id in the encoded header, where the checksum
+ * replaces it when CRC32 is enabled.
+ */
+#define GEKKOTA_XUDP_SESSION_ID_OFFSET(version) \
+    ((version) < GEKKOTA_XUDP_PACKED_VERSION \
+        ? (size_t) &((GekkotaXudpHeader *) 0)->sessionId \
+        : sizeof(uint16_t) + sizeof(uint8_t))
+
+/*
+ * Data messages are the only ones with a compact encoding.
+ */
+#define _gekkota_xudp_is_compact(messageType, flags) \
+    (gekkota_bit_isset(flags, GEKKOTA_XUDP_MESSAGE_FLAG_COMPACT) && \
+     (messageType) >= GEKKOTA_XUDP_MESSAGE_TYPE_RELIABLE_DATA && \
+     (messageType) <= GEKKOTA_XUDP_MESSAGE_TYPE_DATA_FRAGMENT)
+
+#define _gekkota_xudp_field(type, member) \
+    { (uint8_t) (size_t) &((type *) 0)->member, (uint8_t) sizeof(((type *) 0)->member) }
+
+#define _gekkota_xudp_layout(fields, size) \
+    { fields, sizeof(fields) / sizeof(fields[0]), size }
+
+/*
+ * Only the headroom in front of the first byte of a packet is usable.
+ */
+#define _gekkota_xudp_get_headroom(packet, offset) \
+    ((offset) == 0 ? (packet)->headroom : 0)
+
 typedef struct _GekkotaXudpMessageHandlerArgs
 {
     GekkotaXudpHeader   *header;                /* [in] XUDP header */
     GekkotaXudpMessage  *message;               /* [in] XUDP message */
     GekkotaXudpClient   *client;                /* [in|out] XUDP client */
     byte_t              *data;                  /* [in|out] received data */
+    GekkotaXudpHeader   decodedHeader;          /* storage for [header] */
+    GekkotaXudpMessage  decodedMessage;         /* storage for [message] */
 } GekkotaXudpMessageHandlerArgs;
 
+/*
+ * Field of a header or message in its packed wire layout: [offset] is the
+ * offset of the field in the in-memory structure.
+ */
+typedef struct _GekkotaXudpField
+{
+    uint8_t             offset;
+    uint8_t             size;
+} GekkotaXudpField;
+
+typedef struct _GekkotaXudpLayout
+{
+    const GekkotaXudpField *fields;
+    uint8_t             fieldCount;
+    uint8_t             size;                   /* packed size */
+} GekkotaXudpLayout;
+
 /*
  * XUDP message handlers must return a value less than zero on failure,
  * zero if the message was discarded, and a value greater than zero if
@@ -50,21 +99,76 @@ typedef int32_t (GEKKOTA_CALLBACK *XudpMessageHandler) (
                                                    might generate */
 
 static GekkotaXudp *
-_gekkota_xudp_new(GekkotaIPEndPoint *localEndPoint, uint16_t maxClient);
+_gekkota_xudp_new(
+        GekkotaIPEndPoint *localEndPoint,
+        uint16_t maxClient,
+        GekkotaXudpOption options);
+
+static GekkotaXudpClient *
+_gekkota_xudp_connect(
+        GekkotaXudp *restrict xudp,
+        GekkotaIPEndPoint *remoteEndPoint,
+        uint8_t channelCount,
+        GekkotaCompressionLevel compressionLevel);
+
+static GekkotaXudpClient *
+_gekkota_xudp_join_multicast_group(
+        GekkotaXudp *restrict xudp,
+        GekkotaIPEndPoint *multicastEndPoint,
+        uint32_t multicastInterfaceIndex,
+        GekkotaMulticastTTL ttl,
+        uint8_t channelCount);
+
+static int32_t
+_gekkota_xudp_poll(GekkotaXudp *xudp, GekkotaEvent **event, int32_t timeout);
+
+static int32_t
+_gekkota_xudp_poll_batch(
+        GekkotaXudp *xudp,
+        GekkotaEvent *events,
+        size_t capacity,
+        int32_t timeout);
 
 static int32_t
 _gekkota_xudp_acknowledge(
         const GekkotaXudp *xudp,
         GekkotaXudpMessageHandlerArgs *args);
 
+static uint32_t
+_gekkota_xudp_cascade_timers(GekkotaXudp *restrict xudp, uint8_t level);
+
 static int32_t
 _gekkota_xudp_check_for_timeouts(
         GekkotaXudp *xudp,
         GekkotaXudpClient *client,
         GekkotaEvent **event);
 
+static size_t
+_gekkota_xudp_decode_compact_message(
+        const byte_t *data,
+        size_t length,
+        GekkotaXudpMessage *restrict message);
+
+static size_t
+_gekkota_xudp_decode_header(
+        const byte_t *data,
+        size_t length,
+        GekkotaXudpHeader *restrict header);
+
+static size_t
+_gekkota_xudp_decode_message(
+        const byte_t *data,
+        size_t length,
+        uint8_t version,
+        GekkotaXudpMessage *restrict message);
+
 static int32_t
 _gekkota_xudp_dispatch(
+        GekkotaXudp *restrict xudp,
+        GekkotaEvent *restrict event);
+
+static int32_t
+_gekkota_xudp_dispatch_0(
         GekkotaXudp *restrict xudp,
         GekkotaEvent **restrict event);
 
@@ -74,11 +178,40 @@ _gekkota_xudp_dispose_acknowledged_message(
         uint16_t sequenceNumber,
         uint8_t channelId);
 
+static size_t
+_gekkota_xudp_encode_compact_message(
+        const GekkotaXudpMessage *message,
+        byte_t *restrict data);
+
+static size_t
+_gekkota_xudp_encode_header(
+        const GekkotaXudpHeader *header,
+        byte_t *restrict data);
+
+static size_t
+_gekkota_xudp_encode_message(
+        const GekkotaXudpMessage *message,
+        uint8_t version,
+        byte_t *restrict data);
+
+static int32_t
+_gekkota_xudp_expire_timers(
+        GekkotaXudp *xudp,
+        GekkotaEvent **event);
+
 static int32_t
 _gekkota_xudp_get_message_handler_args(
         GekkotaXudp *xudp,
         GekkotaXudpMessageHandlerArgs *args);
 
+static uint32_t
+_gekkota_xudp_get_next_timeout(const GekkotaXudp *xudp, uint32_t currentTime);
+
+static void_t
+_gekkota_xudp_insert_timer(
+        GekkotaXudp *restrict xudp,
+        GekkotaXudpClient *restrict client);
+
 static int32_t
 _gekkota_xudp_notify_connect(
         GekkotaXudp *restrict xudp,
@@ -91,6 +224,15 @@ _gekkota_xudp_notify_disconnect(
         GekkotaXudpClient *client,
         GekkotaEvent **restrict event);
 
+static int32_t
+_gekkota_xudp_on_acknowledgement(
+        GekkotaXudp *xudp,
+        GekkotaXudpMessageHandlerArgs *args,
+        uint16_t sequenceNumber,
+        uint32_t bitmap,
+        uint16_t sentTime,
+        GekkotaEvent **event);
+
 static int32_t
 _gekkota_xudp_on_acknowledge_message(
         GekkotaXudp *xudp,
@@ -133,6 +275,13 @@ _gekkota_xudp_on_ping_message(
         GekkotaXudpMessageHandlerArgs *args,
         GekkotaEvent **event);
 
+static GekkotaPacket *
+_gekkota_xudp_new_incoming_packet(
+        GekkotaXudp *xudp,
+        byte_t *data,
+        size_t dataLength,
+        GekkotaPacketFlag flags);
+
 static int32_t
 _gekkota_xudp_on_reliable_data_message(
         GekkotaXudp *xudp,
@@ -169,11 +318,35 @@ _gekkota_xudp_on_configure_throttle_message(
         GekkotaXudpMessageHandlerArgs *args,
         GekkotaEvent **event);
 
+static int32_t
+_gekkota_xudp_on_acknowledge_range_message(
+        GekkotaXudp *xudp,
+        GekkotaXudpMessageHandlerArgs *args,
+        GekkotaEvent **event);
+
+static int32_t
+_gekkota_xudp_on_timer(
+        GekkotaXudp *xudp,
+        GekkotaXudpClient *client,
+        GekkotaEvent **event);
+
+static bool_t
+_gekkota_xudp_read_varint(
+        const byte_t **data,
+        const byte_t *end,
+        uint32_t *restrict value);
+
 static int32_t
 _gekkota_xudp_receive(
         GekkotaXudp *xudp,
         GekkotaEvent **event);
 
+static void_t
+_gekkota_xudp_schedule_timer(
+        GekkotaXudp *restrict xudp,
+        GekkotaXudpClient *restrict client,
+        uint32_t deadline);
+
 static int32_t
 _gekkota_xudp_send(
         GekkotaXudp *xudp,
@@ -185,6 +358,14 @@ _gekkota_xudp_send_acknowledgements(
         GekkotaXudp *restrict xudp,
         GekkotaXudpClient *restrict client);
 
+static void_t
+_gekkota_xudp_coalesce_datagram(
+        GekkotaXudp *restrict xudp,
+        GekkotaXudpDatagram *datagram);
+
+static int32_t
+_gekkota_xudp_send_datagrams(GekkotaXudp *restrict xudp);
+
 static int32_t
 _gekkota_xudp_send_reliable(
         GekkotaXudp *restrict xudp,
@@ -198,6 +379,21 @@ _gekkota_xudp_send_unreliable(
 static int32_t
 _gekkota_xudp_throttle_bandwidth(GekkotaXudp *restrict xudp);
 
+static void_t
+_gekkota_xudp_update_retransmit_timer(GekkotaXudpClient *restrict client);
+
+static uint32_t
+_gekkota_xudp_update_round_trip_time_us(
+        const GekkotaXudp *restrict xudp,
+        GekkotaXudpClient *restrict client,
+        uint16_t sequenceNumber,
+        uint8_t channelId,
+        uint16_t sentTime,
+        uint32_t roundTripTime);
+
+static size_t
+_gekkota_xudp_write_varint(byte_t *restrict data, uint32_t value);
+
 static size_t messageSizes[] =
 {
     0,
@@ -213,7 +409,130 @@ static size_t messageSizes[] =
     sizeof(GekkotaXudpUnsequencedDataMessage),
     sizeof(GekkotaXudpDataFragmentMessage),
     sizeof(GekkotaXudpConfigureBandwidthMessage),
-    sizeof(GekkotaXudpConfigureThrottleMessage)
+    sizeof(GekkotaXudpConfigureThrottleMessage),
+    sizeof(GekkotaXudpAcknowledgeRangeMessage)
+};
+
+static const GekkotaXudpField headerFields[] =
+{
+    _gekkota_xudp_field(GekkotaXudpHeader, protocolId),
+    _gekkota_xudp_field(GekkotaXudpHeader, version),
+    _gekkota_xudp_field(GekkotaXudpHeader, sessionId),
+    _gekkota_xudp_field(GekkotaXudpHeader, clientId),
+    _gekkota_xudp_field(GekkotaXudpHeader, sentTime)
+};
+
+static const GekkotaXudpField messageHeaderFields[] =
+{
+    _gekkota_xudp_field(GekkotaXudpMessageHeader, messageType),
+    _gekkota_xudp_field(GekkotaXudpMessageHeader, channelId),
+    _gekkota_xudp_field(GekkotaXudpMessageHeader, flags),
+    _gekkota_xudp_field(GekkotaXudpMessageHeader, sequenceNumber)
+};
+
+static const GekkotaXudpField acknowledgeFields[] =
+{
+    _gekkota_xudp_field(GekkotaXudpAcknowledgeMessage, sequenceNumber),
+    _gekkota_xudp_field(GekkotaXudpAcknowledgeMessage, sentTime)
+};
+
+static const GekkotaXudpField connectFields[] =
+{
+    _gekkota_xudp_field(GekkotaXudpConnectMessage, clientId),
+    _gekkota_xudp_field(GekkotaXudpConnectMessage, sessionId),
+    _gekkota_xudp_field(GekkotaXudpConnectMessage, channelCount),
+    _gekkota_xudp_field(GekkotaXudpConnectMessage, mtu),
+    _gekkota_xudp_field(GekkotaXudpConnectMessage, windowSize),
+    _gekkota_xudp_field(GekkotaXudpConnectMessage, incomingBandwidth),
+    _gekkota_xudp_field(GekkotaXudpConnectMessage, outgoingBandwidth),
+    _gekkota_xudp_field(GekkotaXudpConnectMessage, throttleInterval),
+    _gekkota_xudp_field(GekkotaXudpConnectMessage, throttleAcceleration),
+    _gekkota_xudp_field(GekkotaXudpConnectMessage, throttleDeceleration),
+    _gekkota_xudp_field(GekkotaXudpConnectMessage, compressionLevel)
+};
+
+static const GekkotaXudpField validateConnectFields[] =
+{
+    _gekkota_xudp_field(GekkotaXudpValidateConnectMessage, clientId),
+    _gekkota_xudp_field(GekkotaXudpValidateConnectMessage, channelCount),
+    _gekkota_xudp_field(GekkotaXudpValidateConnectMessage, mtu),
+    _gekkota_xudp_field(GekkotaXudpValidateConnectMessage, windowSize),
+    _gekkota_xudp_field(GekkotaXudpValidateConnectMessage, incomingBandwidth),
+    _gekkota_xudp_field(GekkotaXudpValidateConnectMessage, outgoingBandwidth),
+    _gekkota_xudp_field(GekkotaXudpValidateConnectMessage, throttleInterval),
+    _gekkota_xudp_field(GekkotaXudpValidateConnectMessage, throttleAcceleration),
+    _gekkota_xudp_field(GekkotaXudpValidateConnectMessage, throttleDeceleration),
+    _gekkota_xudp_field(GekkotaXudpValidateConnectMessage, compressionLevel)
+};
+
+static const GekkotaXudpField reliableDataFields[] =
+{
+    _gekkota_xudp_field(GekkotaXudpReliableDataMessage, length)
+};
+
+static const GekkotaXudpField unreliableDataFields[] =
+{
+    _gekkota_xudp_field(GekkotaXudpUnreliableDataMessage, sequenceNumber),
+    _gekkota_xudp_field(GekkotaXudpUnreliableDataMessage, length)
+};
+
+static const GekkotaXudpField unsequencedDataFields[] =
+{
+    _gekkota_xudp_field(GekkotaXudpUnsequencedDataMessage, group),
+    _gekkota_xudp_field(GekkotaXudpUnsequencedDataMessage, length)
+};
+
+static const GekkotaXudpField dataFragmentFields[] =
+{
+    _gekkota_xudp_field(GekkotaXudpDataFragmentMessage, startSequenceNumber),
+    _gekkota_xudp_field(GekkotaXudpDataFragmentMessage, fragmentCount),
+    _gekkota_xudp_field(GekkotaXudpDataFragmentMessage, fragmentNumber),
+    _gekkota_xudp_field(GekkotaXudpDataFragmentMessage, fragmentOffset),
+    _gekkota_xudp_field(GekkotaXudpDataFragmentMessage, totalLength),
+    _gekkota_xudp_field(GekkotaXudpDataFragmentMessage, length)
+};
+
+static const GekkotaXudpField configureBandwidthFields[] =
+{
+    _gekkota_xudp_field(GekkotaXudpConfigureBandwidthMessage, incomingBandwidth),
+    _gekkota_xudp_field(GekkotaXudpConfigureBandwidthMessage, outgoingBandwidth)
+};
+
+static const GekkotaXudpField configureThrottleFields[] =
+{
+    _gekkota_xudp_field(GekkotaXudpConfigureThrottleMessage, throttleInterval),
+    _gekkota_xudp_field(GekkotaXudpConfigureThrottleMessage, throttleAcceleration),
+    _gekkota_xudp_field(GekkotaXudpConfigureThrottleMessage, throttleDeceleration)
+};
+
+static const GekkotaXudpField acknowledgeRangeFields[] =
+{
+    _gekkota_xudp_field(GekkotaXudpAcknowledgeRangeMessage, sequenceNumber),
+    _gekkota_xudp_field(GekkotaXudpAcknowledgeRangeMessage, sentTime),
+    _gekkota_xudp_field(GekkotaXudpAcknowledgeRangeMessage, bitmap)
+};
+
+/*
+ * Packed layouts of the message bodies, indexed by message type; packed
+ * sizes include the 5-byte message header.
+ */
+static const GekkotaXudpLayout messageLayouts[] =
+{
+    { NULL, 0, 0 },
+    _gekkota_xudp_layout(acknowledgeFields, 9),
+    _gekkota_xudp_layout(connectFields, 39),
+    _gekkota_xudp_layout(validateConnectFields, 35),
+    { NULL, 0, 5 },                                 /* disconnect */
+    { NULL, 0, 5 },                                 /* join multicast group */
+    { NULL, 0, 5 },                                 /* leave multicast group */
+    { NULL, 0, 5 },                                 /* ping */
+    _gekkota_xudp_layout(reliableDataFields, 7),
+    _gekkota_xudp_layout(unreliableDataFields, 9),
+    _gekkota_xudp_layout(unsequencedDataFields, 9),
+    _gekkota_xudp_layout(dataFragmentFields, 25),
+    _gekkota_xudp_layout(configureBandwidthFields, 13),
+    _gekkota_xudp_layout(configureThrottleFields, 17),
+    _gekkota_xudp_layout(acknowledgeRangeFields, 13)
 };
 
 static XudpMessageHandler messageHandlers[] =
@@ -231,7 +550,8 @@ static XudpMessageHandler messageHandlers[] =
     _gekkota_xudp_on_unsequenced_data_message,
     _gekkota_xudp_on_data_fragment_message,
     _gekkota_xudp_on_configure_bandwidth_message,
-    _gekkota_xudp_on_configure_throttle_message
+    _gekkota_xudp_on_configure_throttle_message,
+    _gekkota_xudp_on_acknowledge_range_message
 };
 
 GekkotaXudp *
@@ -249,7 +569,7 @@ gekkota_xudp_new_4(uint16_t port, uint16_t maxClient)
     if ((localEndPoint = gekkota_ipendpoint_new(NULL, port)) == NULL)
         return NULL;
 
-    xudp = _gekkota_xudp_new(localEndPoint, maxClient);
+    xudp = _gekkota_xudp_new(localEndPoint, maxClient, GEKKOTA_XUDP_OPTION_NONE);
     gekkota_ipendpoint_destroy(localEndPoint);
 
     return xudp;
@@ -264,7 +584,7 @@ gekkota_xudp_new_5(GekkotaIPEndPoint *localEndPoint, uint16_t maxClient)
         return NULL;
     }
 
-    return _gekkota_xudp_new(localEndPoint, maxClient);
+    return _gekkota_xudp_new(localEndPoint, maxClient, GEKKOTA_XUDP_OPTION_NONE);
 }
 
 GekkotaXudp *
@@ -302,7 +622,7 @@ gekkota_xudp_new_6(
                             (GekkotaIPHostAddress *) iterator), port)) == NULL)
                 return NULL;
 
-            xudp = _gekkota_xudp_new(localEndPoint, maxClient);
+            xudp = _gekkota_xudp_new(localEndPoint, maxClient, GEKKOTA_XUDP_OPTION_NONE);
             gekkota_ipendpoint_destroy(localEndPoint);
 
             if (xudp != NULL)
@@ -315,10 +635,27 @@ gekkota_xudp_new_6(
     return xudp;
 }
 
+GekkotaXudp *
+gekkota_xudp_new_7(
+        GekkotaIPEndPoint *localEndPoint,
+        uint16_t maxClient,
+        GekkotaXudpOption options)
+{
+    if (!gekkota_is_initialized())
+    {
+        errno = GEKKOTA_ERROR_LIB_NOT_INITIALIZED;
+        return NULL;
+    }
+
+    return _gekkota_xudp_new(localEndPoint, maxClient, options);
+}
+
 int32_t
 gekkota_xudp_destroy(GekkotaXudp *xudp)
 {
+    GekkotaMemoryArena *arena;
     GekkotaXudpClient *client;
+    uint16_t i;
 
     if (xudp == NULL)
     {
@@ -326,15 +663,31 @@ gekkota_xudp_destroy(GekkotaXudp *xudp)
         return -1;
     }
 
-    for (client = xudp->clients;
-            client < &xudp->clients[xudp->clientCount];
-            client++)
+    arena = gekkota_memory_set_arena(xudp->arena);
+
+    while (!gekkota_list_is_empty(&xudp->connectedClients))
+    {
+        client = _gekkota_xudpclient_from_node(
+                gekkota_list_first(&xudp->connectedClients), connectedNode);
         gekkota_xudpclient_destroy(client);
+    }
 
     gekkota_socket_destroy(xudp->socket);
-    gekkota_ipendpoint_destroy(xudp->remoteEndPoint);
 
+    /*
+     * Receive buffers still referenced by incoming packets outlive the
+     * pool and are freed when the last of those packets is destroyed.
+     */
+    for (i = 0; i < GEKKOTA_XUDP_RECEIVE_RING_SIZE; i++)
+        if (xudp->receivePackets[i] != NULL)
+            gekkota_packet_destroy(xudp->receivePackets[i]);
+
+    _gekkota_packet_pool_destroy(xudp->receivePool);
+
+    gekkota_memory_free(xudp->datagrams);
     gekkota_memory_free(xudp);
+
+    gekkota_memory_set_arena(arena);
     return 0;
 }
 
@@ -406,127 +759,507 @@ gekkota_xudp_set_outgoing_bandwidth(GekkotaXudp *restrict xudp, uint32_t bandwid
     return 0;
 }
 
-GekkotaSocket *
-gekkota_xudp_get_socket(const GekkotaXudp *xudp)
+uint32_t
+gekkota_xudp_get_memory_limit(const GekkotaXudp *xudp)
 {
     if (xudp == NULL)
     {
         errno = GEKKOTA_ERROR_NULL_ARGUMENT;
-        return NULL;
+        return 0;
     }
 
-    return xudp->socket;
+    errno = GEKKOTA_ERROR_SUCCESS;
+    return xudp->memoryLimit;
 }
 
 int32_t
-gekkota_xudp_broadcast(
-        GekkotaXudp *restrict xudp,
-        uint8_t channelId,
-        GekkotaPacket *packet)
+gekkota_xudp_set_memory_limit(GekkotaXudp *restrict xudp, uint32_t limit)
 {
-    GekkotaXudpClient *client;
-
-    if (xudp == NULL || packet == NULL)
+    if (xudp == NULL)
     {
         errno = GEKKOTA_ERROR_NULL_ARGUMENT;
         return -1;
     }
 
-    for (client = xudp->clients;
-            client < &xudp->clients[xudp->clientCount];
-            client++)
-    {
-        if (client->state != GEKKOTA_CLIENT_STATE_CONNECTED)
-            continue;
-
-        if (gekkota_xudpclient_send(client, channelId, packet) != 0)
-            return -1;
-    }
-
+    xudp->memoryLimit = limit;
     return 0;
 }
 
-GekkotaXudpClient *
-gekkota_xudp_connect_2(
-        GekkotaXudp *restrict xudp,
-        char_t *remoteHostNameOrAddress,
-        uint16_t port,
-        uint8_t channelCount,
-        GekkotaCompressionLevel compressionLevel)
+uint32_t
+gekkota_xudp_get_client_memory_limit(const GekkotaXudp *xudp)
 {
-    GekkotaIPHostEntry *hostEntry;
-    GekkotaXudpClient *client = NULL;
-
-    if (xudp == NULL || remoteHostNameOrAddress == NULL)
+    if (xudp == NULL)
     {
         errno = GEKKOTA_ERROR_NULL_ARGUMENT;
-        return NULL;
+        return 0;
     }
 
-    if ((hostEntry = gekkota_dns_get_host_entry(remoteHostNameOrAddress)) != NULL)
-    {
-        GekkotaList *hostAddresses;
-        GekkotaListIterator iterator;
-        GekkotaIPEndPoint *remoteEndPoint;
-    
-        hostAddresses = gekkota_iphostentry_get_addresses(hostEntry);
+    errno = GEKKOTA_ERROR_SUCCESS;
+    return xudp->clientMemoryLimit;
+}
 
-        for (iterator = gekkota_list_first(hostAddresses);
-                iterator != gekkota_list_tail(hostAddresses);
-                iterator = gekkota_list_next(iterator))
-        {
-            if ((remoteEndPoint = gekkota_ipendpoint_new(
-                    gekkota_iphostentry_address(
-                            (GekkotaIPHostAddress *) iterator), port)) == NULL)
-                return NULL;
+int32_t
+gekkota_xudp_set_client_memory_limit(GekkotaXudp *restrict xudp, uint32_t limit)
+{
+    if (xudp == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
 
-            client = gekkota_xudp_connect_3(
-                    xudp,
-                    remoteEndPoint,
-                    channelCount, compressionLevel);
+    xudp->clientMemoryLimit = limit;
+    return 0;
+}
 
-            gekkota_ipendpoint_destroy(remoteEndPoint);
+uint32_t
+gekkota_xudp_get_memory_usage(const GekkotaXudp *xudp)
+{
+    if (xudp == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return 0;
+    }
 
-            if (client != NULL)
-                break;
-        }
+    errno = GEKKOTA_ERROR_SUCCESS;
+    return xudp->incomingMemory + xudp->outgoingMemory;
+}
 
-        gekkota_iphostentry_destroy(hostEntry);
+int32_t
+gekkota_xudp_get_send_batch_size(const GekkotaXudp *xudp)
+{
+    if (xudp == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
     }
 
-    return client;
+    return (int32_t) xudp->sendBatchSize;
 }
 
-GekkotaXudpClient *
-gekkota_xudp_connect_3(
-        GekkotaXudp *restrict xudp,
-        GekkotaIPEndPoint *remoteEndPoint,
-        uint8_t channelCount,
-        GekkotaCompressionLevel compressionLevel)
+int32_t
+gekkota_xudp_set_send_batch_size(GekkotaXudp *restrict xudp, uint16_t batchSize)
 {
-    GekkotaXudpClient *client;
-    GekkotaChannel *channel;
-    GekkotaXudpMessage message;
+    GekkotaMemoryArena *arena;
+    GekkotaXudpDatagram *datagrams;
 
-    if (xudp == NULL || remoteEndPoint == NULL)
+    if (xudp == NULL)
     {
         errno = GEKKOTA_ERROR_NULL_ARGUMENT;
-        return NULL;
+        return -1;
     }
 
-    if (gekkota_ipaddress_is_multicast(remoteEndPoint->address) ||
-            compressionLevel < GEKKOTA_COMPRESSION_LEVEL_FASTEST ||
-            compressionLevel > GEKKOTA_COMPRESSION_LEVEL_BEST)
+    if (batchSize == 0 || batchSize > GEKKOTA_XUDP_MAX_SEND_BATCH_SIZE)
     {
         errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
-        return NULL;
+        return -1;
     }
 
-    if (channelCount == 0)
-        channelCount = GEKKOTA_XUDP_DEFAULT_CHANNEL_COUNT;
+    if (batchSize == xudp->sendBatchSize)
+        return 0;
 
     /*
-     * Search for the first available client, if any.
+     * Datagrams still pending reference the current batch storage,
+     * so hand them to the socket before replacing it.
+     */
+    if (_gekkota_xudp_send_datagrams(xudp) != 0)
+        return -1;
+
+    arena = gekkota_memory_set_arena(xudp->arena);
+
+    if ((datagrams = gekkota_memory_alloc(
+            sizeof(GekkotaXudpDatagram) * batchSize, FALSE)) != NULL)
+    {
+        gekkota_memory_free(xudp->datagrams);
+        xudp->datagrams = datagrams;
+        xudp->sendBatchSize = batchSize;
+    }
+
+    gekkota_memory_set_arena(arena);
+    return datagrams != NULL ? 0 : -1;
+}
+
+int32_t
+gekkota_xudp_get_next_timeout(const GekkotaXudp *xudp)
+{
+    if (xudp == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    return (int32_t) _gekkota_xudp_get_next_timeout(
+            xudp, (uint32_t) gekkota_time_now());
+}
+
+GekkotaMemoryArena *
+gekkota_xudp_get_arena(const GekkotaXudp *xudp)
+{
+    if (xudp == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return NULL;
+    }
+
+    return xudp->arena;
+}
+
+GekkotaSocket *
+gekkota_xudp_get_socket(const GekkotaXudp *xudp)
+{
+    if (xudp == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return NULL;
+    }
+
+    return xudp->socket;
+}
+
+int32_t
+gekkota_xudp_broadcast(
+        GekkotaXudp *restrict xudp,
+        uint8_t channelId,
+        GekkotaPacket *packet)
+{
+    GekkotaXudpClient *client;
+    GekkotaListIterator iterator;
+
+    if (xudp == NULL || packet == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    for (iterator = gekkota_list_head(&xudp->connectedClients);
+            iterator != gekkota_list_tail(&xudp->connectedClients);
+            iterator = gekkota_list_next(iterator))
+    {
+        client = _gekkota_xudpclient_from_node(iterator, connectedNode);
+
+        if (client->state != GEKKOTA_CLIENT_STATE_CONNECTED)
+            continue;
+
+        if (gekkota_xudpclient_send(client, channelId, packet) != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+GekkotaXudpClient *
+gekkota_xudp_connect_2(
+        GekkotaXudp *restrict xudp,
+        char_t *remoteHostNameOrAddress,
+        uint16_t port,
+        uint8_t channelCount,
+        GekkotaCompressionLevel compressionLevel)
+{
+    GekkotaIPHostEntry *hostEntry;
+    GekkotaXudpClient *client = NULL;
+
+    if (xudp == NULL || remoteHostNameOrAddress == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return NULL;
+    }
+
+    if ((hostEntry = gekkota_dns_get_host_entry(remoteHostNameOrAddress)) != NULL)
+    {
+        GekkotaList *hostAddresses;
+        GekkotaListIterator iterator;
+        GekkotaIPEndPoint *remoteEndPoint;
+    
+        hostAddresses = gekkota_iphostentry_get_addresses(hostEntry);
+
+        for (iterator = gekkota_list_first(hostAddresses);
+                iterator != gekkota_list_tail(hostAddresses);
+                iterator = gekkota_list_next(iterator))
+        {
+            if ((remoteEndPoint = gekkota_ipendpoint_new(
+                    gekkota_iphostentry_address(
+                            (GekkotaIPHostAddress *) iterator), port)) == NULL)
+                return NULL;
+
+            client = gekkota_xudp_connect_3(
+                    xudp,
+                    remoteEndPoint,
+                    channelCount, compressionLevel);
+
+            gekkota_ipendpoint_destroy(remoteEndPoint);
+
+            if (client != NULL)
+                break;
+        }
+
+        gekkota_iphostentry_destroy(hostEntry);
+    }
+
+    return client;
+}
+
+GekkotaXudpClient *
+gekkota_xudp_connect_3(
+        GekkotaXudp *restrict xudp,
+        GekkotaIPEndPoint *remoteEndPoint,
+        uint8_t channelCount,
+        GekkotaCompressionLevel compressionLevel)
+{
+    GekkotaMemoryArena *arena;
+    GekkotaXudpClient *client;
+
+    if (xudp == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return NULL;
+    }
+
+    arena = gekkota_memory_set_arena(xudp->arena);
+    client = _gekkota_xudp_connect(xudp, remoteEndPoint, channelCount, compressionLevel);
+    gekkota_memory_set_arena(arena);
+
+    return client;
+}
+
+GekkotaXudpClient *
+gekkota_xudp_join_multicast_group_1(
+        GekkotaXudp *restrict xudp,
+        GekkotaIPEndPoint *multicastEndPoint,
+        uint32_t multicastInterfaceIndex,
+        GekkotaMulticastTTL ttl,
+        uint8_t channelCount)
+{
+    GekkotaMemoryArena *arena;
+    GekkotaXudpClient *client;
+
+    if (xudp == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return NULL;
+    }
+
+    arena = gekkota_memory_set_arena(xudp->arena);
+    client = _gekkota_xudp_join_multicast_group(xudp, multicastEndPoint, multicastInterfaceIndex, ttl, channelCount);
+    gekkota_memory_set_arena(arena);
+
+    return client;
+}
+
+int32_t
+gekkota_xudp_flush(GekkotaXudp *xudp)
+{
+    GekkotaMemoryArena *arena;
+    int32_t rc;
+
+    if (xudp == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    arena = gekkota_memory_set_arena(xudp->arena);
+
+    xudp->currentTime = (uint32_t) gekkota_time_now();
+    rc = _gekkota_xudp_send(xudp, NULL, FALSE);
+
+    gekkota_memory_set_arena(arena);
+    return rc;
+}
+
+int32_t
+gekkota_xudp_poll(GekkotaXudp *xudp, GekkotaEvent **event, int32_t timeout)
+{
+    GekkotaMemoryArena *arena;
+    int32_t rc;
+
+    if (xudp == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    arena = gekkota_memory_set_arena(xudp->arena);
+    rc = _gekkota_xudp_poll(xudp, event, timeout);
+    gekkota_memory_set_arena(arena);
+
+    return rc;
+}
+
+int32_t
+gekkota_xudp_poll_batch(
+        GekkotaXudp *xudp,
+        GekkotaEvent *events,
+        size_t capacity,
+        int32_t timeout)
+{
+    GekkotaMemoryArena *arena;
+    int32_t rc;
+
+    if (xudp == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    arena = gekkota_memory_set_arena(xudp->arena);
+    rc = _gekkota_xudp_poll_batch(xudp, events, capacity, timeout);
+    gekkota_memory_set_arena(arena);
+
+    return rc;
+}
+
+size_t
+_gekkota_xudp_header_size(uint8_t version)
+{
+    /*
+     * Size of the header including [sentTime].
+     */
+    return version < GEKKOTA_XUDP_PACKED_VERSION
+        ? sizeof(GekkotaXudpHeader)
+        : sizeof(uint16_t) * 3 + sizeof(uint8_t) + sizeof(uint32_t);
+}
+
+size_t
+_gekkota_xudp_message_size(GekkotaXudpMessageType messageType, uint8_t version)
+{
+    return version < GEKKOTA_XUDP_PACKED_VERSION
+        ? messageSizes[messageType]
+        : messageLayouts[messageType].size;
+}
+
+static GekkotaXudp *
+_gekkota_xudp_new(
+        GekkotaIPEndPoint *localEndPoint,
+        uint16_t maxClient,
+        GekkotaXudpOption options)
+{
+    GekkotaXudp *xudp;
+    GekkotaXudpClient *client;
+    size_t memSize;
+    uint16_t level, index;
+
+    if (maxClient == 0)
+        maxClient = GEKKOTA_XUDP_DEFAULT_CLIENT_COUNT;
+
+    memSize = sizeof(GekkotaXudp) + (sizeof(GekkotaXudpClient) * maxClient);
+
+    if ((xudp = gekkota_memory_alloc(memSize, TRUE)) == NULL)
+        return NULL;
+
+    if ((xudp->socket = gekkota_socket_new_3(
+            GEKKOTA_SOCKET_TYPE_DATAGRAM, localEndPoint)) == NULL)
+    {
+        gekkota_memory_free(xudp);
+        return NULL;
+    }
+
+    /*
+     * Without io_uring or coalescing the socket is simply driven the
+     * usual way.
+     */
+    if (gekkota_bit_isset(options, GEKKOTA_XUDP_OPTION_IO_URING))
+        _gekkota_socket_attach_ring(xudp->socket, GEKKOTA_XUDP_MAX_MTU);
+
+    if (gekkota_bit_isset(options, GEKKOTA_XUDP_OPTION_COALESCING))
+        _gekkota_socket_enable_coalescing(xudp->socket);
+
+    xudp->preciseRoundTripTime = gekkota_bit_isset(
+            options, GEKKOTA_XUDP_OPTION_PRECISE_ROUND_TRIP_TIME);
+
+    /*
+     * Like coalescing, timestamps are given up on where not available.
+     */
+    xudp->receiveTimestamps = gekkota_bit_isset(
+            options, GEKKOTA_XUDP_OPTION_RECEIVE_TIMESTAMPS) &&
+        _gekkota_socket_enable_receive_timestamps(xudp->socket->client) == 0;
+
+    if ((xudp->datagrams = gekkota_memory_alloc(
+            sizeof(GekkotaXudpDatagram) * GEKKOTA_XUDP_DEFAULT_SEND_BATCH_SIZE,
+            FALSE)) == NULL)
+    {
+        gekkota_socket_destroy(xudp->socket);
+        gekkota_memory_free(xudp);
+        return NULL;
+    }
+
+    if ((xudp->receivePool = _gekkota_packet_pool_new(xudp->socket->isCoalescing
+            ? GEKKOTA_SOCKET_MAX_COALESCED_SIZE
+            : GEKKOTA_XUDP_MAX_MTU)) == NULL)
+    {
+        gekkota_memory_free(xudp->datagrams);
+        gekkota_socket_destroy(xudp->socket);
+        gekkota_memory_free(xudp);
+        return NULL;
+    }
+
+    xudp->arena = gekkota_memory_get_arena();
+    xudp->protocolId = gekkota_host_to_net_16(gekkota_hash_16(GEKKOTA_XUDP_ID));
+    xudp->sendBatchSize = GEKKOTA_XUDP_DEFAULT_SEND_BATCH_SIZE;
+    xudp->memoryLimit = GEKKOTA_XUDP_DEFAULT_MEMORY_LIMIT;
+    xudp->clientMemoryLimit = GEKKOTA_XUDP_DEFAULT_CLIENT_MEMORY_LIMIT;
+    xudp->clients = (GekkotaXudpClient *) (xudp + 1);
+    xudp->clientCount = maxClient;
+    xudp->mtu = GEKKOTA_XUDP_DEFAULT_MTU;
+    xudp->timerWheelTime = (uint32_t) gekkota_time_now();
+
+    for (level = 0; level < GEKKOTA_XUDP_TIMER_WHEEL_LEVELS; level++)
+        for (index = 0; index < GEKKOTA_XUDP_TIMER_WHEEL_SLOTS; index++)
+        {
+            gekkota_list_clear(&xudp->timerWheel[level][index]);
+        }
+
+    gekkota_list_clear(&xudp->connectedClients);
+    gekkota_list_clear(&xudp->outgoingClients);
+    gekkota_list_clear(&xudp->dispatchClients);
+    gekkota_list_clear(&xudp->readyChannels);
+
+    for (client = xudp->clients;
+            client < &xudp->clients[xudp->clientCount];
+            client++)
+    {
+        client->xudp = xudp;
+
+        gekkota_list_clear(&client->acknowledgements);
+        gekkota_list_clear(&client->sentReliableMessages);
+        gekkota_list_clear(&client->sentUnreliableMessages);
+        gekkota_list_clear(&client->outgoingReliableMessages);
+        gekkota_list_clear(&client->outgoingUnreliableMessages);
+
+        _gekkota_xudpclient_reset(client);
+    }
+
+    return xudp;
+}
+
+static GekkotaXudpClient *
+_gekkota_xudp_connect(
+        GekkotaXudp *restrict xudp,
+        GekkotaIPEndPoint *remoteEndPoint,
+        uint8_t channelCount,
+        GekkotaCompressionLevel compressionLevel)
+{
+    GekkotaXudpClient *client;
+    GekkotaChannel *channel;
+    GekkotaXudpMessage message;
+
+    if (xudp == NULL || remoteEndPoint == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return NULL;
+    }
+
+    if (gekkota_ipaddress_is_multicast(remoteEndPoint->address) ||
+            compressionLevel < GEKKOTA_COMPRESSION_LEVEL_FASTEST ||
+            compressionLevel > GEKKOTA_COMPRESSION_LEVEL_BEST)
+    {
+        errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
+        return NULL;
+    }
+
+    if (channelCount == 0)
+        channelCount = GEKKOTA_XUDP_DEFAULT_CHANNEL_COUNT;
+
+    /*
+     * Search for the first available client, if any.
      */
     for (client = xudp->clients;
             client < &xudp->clients[xudp->clientCount];
@@ -545,8 +1278,9 @@ gekkota_xudp_connect_3(
         return NULL;
 
     client->channelCount = channelCount;
-    client->state = GEKKOTA_CLIENT_STATE_CONNECTING;
+    _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_CONNECTING);
     client->remoteEndPoint = gekkota_ipendpoint_new_0(remoteEndPoint, FALSE);
+    gekkota_ipendpoint_to_socketaddress(remoteEndPoint, &client->remoteSocketAddress);
     client->isMulticastGroupMember = FALSE;
     client->sessionId = (uint32_t) rand();
     client->compressionLevel = compressionLevel;
@@ -569,6 +1303,7 @@ gekkota_xudp_connect_3(
             channel < &client->channels[channelCount];
             channel++)
     {
+        channel->client = client;
         gekkota_list_clear(&channel->incomingReliableMessages);
         gekkota_list_clear(&channel->incomingUnreliableMessages);
     }
@@ -576,7 +1311,9 @@ gekkota_xudp_connect_3(
     /* message header */
     message.header.messageType = GEKKOTA_XUDP_MESSAGE_TYPE_CONNECT;
     message.header.channelId = 0xFF;
-    message.header.flags = GEKKOTA_XUDP_MESSAGE_FLAG_ACKNOWLEDGE;
+    message.header.flags = GEKKOTA_XUDP_MESSAGE_FLAG_ACKNOWLEDGE |
+        GEKKOTA_XUDP_MESSAGE_FLAG_ACKNOWLEDGE_RANGE |
+        GEKKOTA_XUDP_MESSAGE_FLAG_COMPACT;
 
     /* message body */
     message.connect.clientId = gekkota_host_to_net_16(client->localClientId);
@@ -601,8 +1338,8 @@ gekkota_xudp_connect_3(
     return client;
 }
 
-GekkotaXudpClient *
-gekkota_xudp_join_multicast_group_1(
+static GekkotaXudpClient *
+_gekkota_xudp_join_multicast_group(
         GekkotaXudp *restrict xudp,
         GekkotaIPEndPoint *multicastEndPoint,
         uint32_t multicastInterfaceIndex,
@@ -698,7 +1435,7 @@ gekkota_xudp_join_multicast_group_1(
     strcat_s(multicastId, sizeof(multicastId), ":");
     strcat_s(multicastId, sizeof(multicastId), multicastPort);
 #else
-    itoa(multicastEndPoint->port, multicastPort, 16);
+    sprintf(multicastPort, "%x", multicastEndPoint->port);
     strcat(multicastId, ":");
     strcat(multicastId, multicastPort);
 #endif /* WIN32 */
@@ -712,9 +1449,10 @@ gekkota_xudp_join_multicast_group_1(
 
     client->remoteClientId = gekkota_hash_16(multicastId);
     client->remoteEndPoint = gekkota_ipendpoint_new_0(multicastEndPoint, FALSE);
+    gekkota_ipendpoint_to_socketaddress(multicastEndPoint, &client->remoteSocketAddress);
     client->isMulticastGroupMember = TRUE;
     client->multicastInterfaceIndex = multicastInterfaceIndex;
-    client->state = GEKKOTA_CLIENT_STATE_CONNECTED;
+    _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_CONNECTED);
     client->channelCount = channelCount;
     client->compressionLevel = GEKKOTA_COMPRESSION_LEVEL_FAST;
 
@@ -736,6 +1474,7 @@ gekkota_xudp_join_multicast_group_1(
             channel < &client->channels[channelCount];
             channel++)
     {
+        channel->client = client;
         gekkota_list_clear(&channel->incomingReliableMessages);
         gekkota_list_clear(&channel->incomingUnreliableMessages);
     }
@@ -755,24 +1494,11 @@ gekkota_xudp_join_multicast_group_1(
     return client;
 }
 
-int32_t
-gekkota_xudp_flush(GekkotaXudp *xudp)
-{
-    if (xudp == NULL)
-    {
-        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
-        return -1;
-    }
-
-    xudp->currentTime = (uint32_t) gekkota_time_now();
-    return _gekkota_xudp_send(xudp, NULL, FALSE);
-}
-
-int32_t
-gekkota_xudp_poll(GekkotaXudp *xudp, GekkotaEvent **event, int32_t timeout)
+static int32_t
+_gekkota_xudp_poll(GekkotaXudp *xudp, GekkotaEvent **event, int32_t timeout)
 {
-    int32_t poll;
-    time_t pollTimeout;
+    int32_t poll, waitTimeout;
+    time_t pollTimeout = 0;
 
     if (xudp == NULL)
     {
@@ -782,7 +1508,7 @@ gekkota_xudp_poll(GekkotaXudp *xudp, GekkotaEvent **event, int32_t timeout)
 
     if (event != NULL)
     {
-        switch (_gekkota_xudp_dispatch(xudp, event))
+        switch (_gekkota_xudp_dispatch_0(xudp, event))
         {
             case -1:    return -1;  /* error */
             case 1:     return 1;   /* message dispatched */
@@ -827,7 +1553,7 @@ gekkota_xudp_poll(GekkotaXudp *xudp, GekkotaEvent **event, int32_t timeout)
 
         if (event != NULL)
         {
-            switch (_gekkota_xudp_dispatch(xudp, event))
+            switch (_gekkota_xudp_dispatch_0(xudp, event))
             {
                 case -1:    return -1;  /* error */
                 case 1:     return 1;   /* message dispatched */
@@ -835,8 +1561,6 @@ gekkota_xudp_poll(GekkotaXudp *xudp, GekkotaEvent **event, int32_t timeout)
             }
         }
 
-        xudp->currentTime = (uint32_t) gekkota_time_now();
-
         /*
          * If [timeout] is greater than 0, then wait at least [timeout]
          * milliseconds for an event to occur on the underlying socket.
@@ -852,71 +1576,114 @@ gekkota_xudp_poll(GekkotaXudp *xudp, GekkotaEvent **event, int32_t timeout)
                 return 0;
 
         /*
-         * Listen for incoming packets.
+         * Listen for incoming packets, but do not wait past the next timer
+         * deadline.
          */
+        waitTimeout = timeout < 0
+            ? GEKKOTA_XUDP_DEFAULT_POLL_TIMEOUT
+            : (int32_t) gekkota_time_get_lag(pollTimeout, xudp->currentTime);
+
+        waitTimeout = gekkota_utils_min(waitTimeout,
+                (int32_t) _gekkota_xudp_get_next_timeout(xudp, xudp->currentTime));
+
         if ((poll = gekkota_socket_poll(
-                xudp->socket, GEKKOTA_SELECT_MODE_READ,
-                timeout < 0
-                    ? GEKKOTA_XUDP_DEFAULT_POLL_TIMEOUT
-                    : (int32_t) gekkota_time_get_lag(pollTimeout, xudp->currentTime))) == -1)
+                xudp->socket, GEKKOTA_SELECT_MODE_READ, waitTimeout)) == -1)
             return -1;
 
-        xudp->currentTime = (uint32_t) gekkota_time_now();
-    } while (poll > 0 || timeout < 0);
+        /*
+         * The clock is read once per iteration, as the wait returns.
+         */
+        xudp->currentTime = (uint32_t) gekkota_time_now();
+    } while (poll > 0 || timeout < 0);
+
+    return 0;
+}
+
+static int32_t
+_gekkota_xudp_poll_batch(
+        GekkotaXudp *xudp,
+        GekkotaEvent *events,
+        size_t capacity,
+        int32_t timeout)
+{
+    int32_t poll, waitTimeout, rc;
+    time_t pollTimeout = 0;
+    size_t count = 0;
+
+    if (xudp == NULL || events == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return -1;
+    }
+
+    if (capacity == 0 || capacity > INT32_MAX)
+    {
+        errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
+        return -1;
+    }
+
+    xudp->currentTime = (uint32_t) gekkota_time_now();
+
+    if (timeout >= 0)
+        pollTimeout = (time_t) timeout + xudp->currentTime;
+
+    do
+    {
+        if (gekkota_time_get_lag(
+                xudp->currentTime,
+                xudp->bandwidthThrottleEpoch) >= GEKKOTA_XUDP_BANDWIDTH_THROTTLE_INTERVAL)
+        {
+            _gekkota_xudp_throttle_bandwidth(xudp);
+        }
+
+        /*
+         * Without an event to fill in, connects, disconnects and timeouts
+         * are deferred to the dispatch queues, so a whole I/O cycle runs
+         * before events are drained.
+         */
+        while ((rc = _gekkota_xudp_send(xudp, NULL, TRUE)) == 1);
+
+        if (rc < 0 || _gekkota_xudp_receive(xudp, NULL) < 0)
+            return -1;
 
-    return 0;
-}
+        while ((rc = _gekkota_xudp_send(xudp, NULL, TRUE)) == 1);
 
-size_t
-_gekkota_xudp_message_size(GekkotaXudpMessageType messageType)
-{
-    return messageSizes[messageType];
-}
+        if (rc < 0)
+            return -1;
 
-static GekkotaXudp *
-_gekkota_xudp_new(GekkotaIPEndPoint *localEndPoint, uint16_t maxClient)
-{
-    GekkotaXudp *xudp;
-    GekkotaXudpClient *client;
-    size_t memSize;
+        while (count < capacity)
+        {
+            if ((rc = _gekkota_xudp_dispatch(xudp, &events[count])) <= 0)
+                break;
 
-    if (maxClient == 0)
-        maxClient = GEKKOTA_XUDP_DEFAULT_CLIENT_COUNT;
+            ++count;
+        }
 
-    memSize = sizeof(GekkotaXudp) + (sizeof(GekkotaXudpClient) * maxClient);
+        if (count > 0)
+            return (int32_t) count;
 
-    if ((xudp = gekkota_memory_alloc(memSize, TRUE)) == NULL)
-        return NULL;
+        if (rc < 0)
+            return -1;
 
-    if ((xudp->socket = gekkota_socket_new_3(
-            GEKKOTA_SOCKET_TYPE_DATAGRAM, localEndPoint)) == NULL)
-    {
-        gekkota_memory_free(xudp);
-        return NULL;
-    }
+        if (timeout > -1)
+            if (gekkota_time_compare(xudp->currentTime, pollTimeout) >= 0)
+                return 0;
 
-    xudp->protocolId = gekkota_host_to_net_16(gekkota_hash_16(GEKKOTA_XUDP_ID));
-    xudp->clients = (GekkotaXudpClient *) (xudp + 1);
-    xudp->clientCount = maxClient;
-    xudp->mtu = GEKKOTA_XUDP_DEFAULT_MTU;
-    xudp->lastServicedClient = xudp->clients;
+        waitTimeout = timeout < 0
+            ? GEKKOTA_XUDP_DEFAULT_POLL_TIMEOUT
+            : (int32_t) gekkota_time_get_lag(pollTimeout, xudp->currentTime);
 
-    for (client = xudp->clients;
-            client < &xudp->clients[xudp->clientCount];
-            client++)
-    {
-        client->xudp = xudp;
+        waitTimeout = gekkota_utils_min(waitTimeout,
+                (int32_t) _gekkota_xudp_get_next_timeout(xudp, xudp->currentTime));
 
-        gekkota_list_clear(&client->acknowledgements);
-        gekkota_list_clear(&client->sentReliableMessages);
-        gekkota_list_clear(&client->sentUnreliableMessages);
-        gekkota_list_clear(&client->outgoingReliableMessages);
-        gekkota_list_clear(&client->outgoingUnreliableMessages);
+        if ((poll = gekkota_socket_poll(
+                xudp->socket, GEKKOTA_SELECT_MODE_READ, waitTimeout)) == -1)
+            return -1;
 
-        _gekkota_xudpclient_reset(client);
-    }
+        xudp->currentTime = (uint32_t) gekkota_time_now();
+    } while (poll > 0 || timeout < 0);
 
-    return xudp;
+    return 0;
 }
 
 static int32_t
@@ -967,6 +1734,33 @@ _gekkota_xudp_acknowledge(
     return 1;
 }
 
+static uint32_t
+_gekkota_xudp_cascade_timers(GekkotaXudp *restrict xudp, uint8_t level)
+{
+    GekkotaList *slot;
+    GekkotaListNode *timerNode;
+    uint32_t index;
+
+    index = (xudp->timerWheelTime >> (level * GEKKOTA_XUDP_TIMER_WHEEL_SLOT_BITS))
+        & GEKKOTA_XUDP_TIMER_WHEEL_MASK;
+
+    slot = &xudp->timerWheel[level][index];
+
+    /*
+     * Move the timers of the current slot down to the lower levels.
+     */
+    while (!gekkota_list_is_empty(slot))
+    {
+        timerNode = gekkota_list_remove(gekkota_list_head(slot));
+        --xudp->timerCount;
+
+        _gekkota_xudp_insert_timer(xudp,
+                _gekkota_xudpclient_from_node(timerNode, timerNode));
+    }
+
+    return index;
+}
+
 static int32_t
 _gekkota_xudp_check_for_timeouts(
         GekkotaXudp *xudp,
@@ -1009,9 +1803,11 @@ _gekkota_xudp_check_for_timeouts(
 
         outgoingMessage->roundTripTimeout *= 2;
 
+        _gekkota_xudpclient_remove_sent_reliable_message(client, outgoingMessage);
         gekkota_list_insert(
                 gekkota_list_head(&client->outgoingReliableMessages),
-                gekkota_list_remove(&outgoingMessage->listNode));
+                outgoingMessage);
+        _gekkota_xudpclient_schedule_output(client);
 
         if (iterator == gekkota_list_head(&client->sentReliableMessages) &&
                 !gekkota_list_is_empty(&client->sentReliableMessages))
@@ -1024,86 +1820,319 @@ _gekkota_xudp_check_for_timeouts(
     return 0;
 }
 
+static size_t
+_gekkota_xudp_decode_compact_message(
+        const byte_t *data,
+        size_t length,
+        GekkotaXudpMessage *restrict message)
+{
+    const byte_t *end = data + length, *cursor = data;
+    uint32_t fragmentNumber, fragmentCount, totalLength, dataLength;
+    uint16_t sequenceNumber;
+
+    if (length < sizeof(uint8_t) * 3 + sizeof(uint16_t))
+        return 0;
+
+    message->header.messageType = *cursor++;
+    message->header.channelId = *cursor++;
+    message->header.flags = *cursor++;
+    memcpy(&message->header.sequenceNumber, cursor, sizeof(uint16_t));
+    cursor += sizeof(uint16_t);
+
+    switch (message->header.messageType)
+    {
+        case GEKKOTA_XUDP_MESSAGE_TYPE_RELIABLE_DATA:
+            if (!_gekkota_xudp_read_varint(&cursor, end, &dataLength) ||
+                    dataLength > 0xFFFF)
+                return 0;
+
+            message->reliableData.length = gekkota_host_to_net_16((uint16_t) dataLength);
+            break;
+
+        case GEKKOTA_XUDP_MESSAGE_TYPE_UNRELIABLE_DATA:
+            if (cursor + sizeof(uint16_t) > end)
+                return 0;
+
+            memcpy(&message->unreliableData.sequenceNumber, cursor, sizeof(uint16_t));
+            cursor += sizeof(uint16_t);
+
+            if (!_gekkota_xudp_read_varint(&cursor, end, &dataLength) ||
+                    dataLength > 0xFFFF)
+                return 0;
+
+            message->unreliableData.length = gekkota_host_to_net_16((uint16_t) dataLength);
+            break;
+
+        case GEKKOTA_XUDP_MESSAGE_TYPE_UNSEQUENCED_DATA:
+            if (cursor + sizeof(uint16_t) > end)
+                return 0;
+
+            memcpy(&message->unsequencedData.group, cursor, sizeof(uint16_t));
+            cursor += sizeof(uint16_t);
+
+            if (!_gekkota_xudp_read_varint(&cursor, end, &dataLength) ||
+                    dataLength > 0xFFFF)
+                return 0;
+
+            message->unsequencedData.length = gekkota_host_to_net_16((uint16_t) dataLength);
+            break;
+
+        case GEKKOTA_XUDP_MESSAGE_TYPE_DATA_FRAGMENT:
+            if (!_gekkota_xudp_read_varint(&cursor, end, &fragmentNumber) ||
+                    !_gekkota_xudp_read_varint(&cursor, end, &fragmentCount) ||
+                    !_gekkota_xudp_read_varint(&cursor, end, &totalLength) ||
+                    !_gekkota_xudp_read_varint(&cursor, end, &dataLength) ||
+                    dataLength > 0xFFFF ||
+                    fragmentNumber >= fragmentCount)
+                return 0;
+
+            /*
+             * Fragments take consecutive sequence numbers and, but for the
+             * last one, are all the same size.
+             */
+            sequenceNumber = gekkota_net_to_host_16(message->header.sequenceNumber);
+
+            message->dataFragment.startSequenceNumber = gekkota_host_to_net_16(
+                    (uint16_t) (sequenceNumber - fragmentNumber));
+            message->dataFragment.fragmentCount = gekkota_host_to_net_32(fragmentCount);
+            message->dataFragment.fragmentNumber = gekkota_host_to_net_32(fragmentNumber);
+            message->dataFragment.fragmentOffset = gekkota_host_to_net_32(fragmentNumber
+                    * (totalLength / fragmentCount + (totalLength % fragmentCount != 0)));
+            message->dataFragment.totalLength = gekkota_host_to_net_32(totalLength);
+            message->dataFragment.length = gekkota_host_to_net_16((uint16_t) dataLength);
+            break;
+
+        default:
+            return 0;
+    }
+
+    return (size_t) (cursor - data);
+}
+
+static size_t
+_gekkota_xudp_decode_header(
+        const byte_t *data,
+        size_t length,
+        GekkotaXudpHeader *restrict header)
+{
+    const GekkotaXudpField *field;
+    size_t headerSize, offset = 0;
+    bool_t hasSentTime;
+
+    /*
+     * The version byte follows the protocol id in both layouts.
+     */
+    if (length < sizeof(uint16_t) + sizeof(uint8_t))
+        return 0;
+
+    hasSentTime = gekkota_bit_isset(
+            data[sizeof(uint16_t)] & GEKKOTA_XUDP_HEADER_FLAG_MASK,
+            GEKKOTA_XUDP_HEADER_FLAG_SENT_TIME) ? TRUE : FALSE;
+
+    if ((data[sizeof(uint16_t)] >> 2) < GEKKOTA_XUDP_PACKED_VERSION)
+    {
+        if (length < sizeof(GekkotaXudpHeader))
+            return 0;
+
+        memcpy(header, data, sizeof(GekkotaXudpHeader));
+
+        return hasSentTime
+            ? sizeof(GekkotaXudpHeader)
+            : (size_t) &((GekkotaXudpHeader *) 0)->sentTime;
+    }
+
+    headerSize = _gekkota_xudp_header_size(GEKKOTA_XUDP_PACKED_VERSION);
+
+    if (!hasSentTime)
+        headerSize -= sizeof(uint16_t);
+
+    if (length < headerSize)
+        return 0;
+
+    header->sentTime = 0;
+
+    for (field = headerFields; offset < headerSize; field++)
+    {
+        memcpy((byte_t *) header + field->offset, data + offset, field->size);
+        offset += field->size;
+    }
+
+    return headerSize;
+}
+
+static size_t
+_gekkota_xudp_decode_message(
+        const byte_t *data,
+        size_t length,
+        uint8_t version,
+        GekkotaXudpMessage *restrict message)
+{
+    const GekkotaXudpLayout *layout;
+    const GekkotaXudpField *field;
+    size_t messageSize;
+
+    /*
+     * The flags follow the message type and the channel id.
+     */
+    if (version >= GEKKOTA_XUDP_PACKED_VERSION && length > 2 &&
+            _gekkota_xudp_is_compact(data[0], data[2]))
+        return _gekkota_xudp_decode_compact_message(data, length, message);
+
+    messageSize = _gekkota_xudp_message_size(data[0], version);
+
+    if (length < messageSize)
+        return 0;
+
+    if (version < GEKKOTA_XUDP_PACKED_VERSION)
+    {
+        memcpy(message, data, messageSize);
+        return messageSize;
+    }
+
+    for (field = messageHeaderFields;
+            field < &messageHeaderFields[sizeof(messageHeaderFields) / sizeof(GekkotaXudpField)];
+            field++)
+    {
+        memcpy((byte_t *) message + field->offset, data, field->size);
+        data += field->size;
+    }
+
+    layout = &messageLayouts[message->header.messageType];
+
+    for (field = layout->fields; field < &layout->fields[layout->fieldCount]; field++)
+    {
+        memcpy((byte_t *) message + field->offset, data, field->size);
+        data += field->size;
+    }
+
+    return messageSize;
+}
+
 static int32_t
 _gekkota_xudp_dispatch(
         GekkotaXudp *restrict xudp,
-        GekkotaEvent **restrict event)
+        GekkotaEvent *restrict event)
 {
     GekkotaXudpClient *client;
     GekkotaChannel *channel;
     GekkotaPacket *packet;
-    GekkotaIPEndPoint *remoteEndPoint;
+    GekkotaSocketAddress remoteSocketAddress;
 
-    client = xudp->lastServicedClient;
-    
-    do
+    /*
+     * Connect and disconnect events come first.
+     */
+    while (!gekkota_list_is_empty(&xudp->dispatchClients))
     {
-        ++client;
-
-        if (client >= &xudp->clients[xudp->clientCount])
-            client = xudp->clients;
+        client = _gekkota_xudpclient_from_node(
+                gekkota_list_remove(gekkota_list_head(&xudp->dispatchClients)),
+                dispatchNode);
 
         switch (client->state)
         {
             case GEKKOTA_CLIENT_STATE_CONNECTION_PENDING:
             case GEKKOTA_CLIENT_STATE_CONNECTION_SUCCEEDED:
-                client->state = GEKKOTA_CLIENT_STATE_CONNECTED;
+                _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_CONNECTED);
+
+                /*
+                 * Messages received before the connect event was dispatched
+                 * could not be delivered so far.
+                 */
+                for (channel = client->channels;
+                        channel < &client->channels[client->channelCount];
+                        channel++)
+                {
+                    if (!gekkota_list_is_empty(&channel->incomingReliableMessages) ||
+                            !gekkota_list_is_empty(&channel->incomingUnreliableMessages))
+                        _gekkota_xudpclient_schedule_receive(channel);
+                }
 
-                return ((*event = _gekkota_event_new(
-                        GEKKOTA_EVENT_TYPE_CONNECT, client,
+                _gekkota_event_init(
+                        event, GEKKOTA_EVENT_TYPE_CONNECT, client,
                         0, NULL,
-                        client->remoteEndPoint, TRUE)) == NULL) ? -1 : 1;
+                        &client->remoteSocketAddress, TRUE);
+                return 1;
 
             case GEKKOTA_CLIENT_STATE_ZOMBIE:
+                /*
+                 * Fill in the event before destroying the client, which
+                 * also resets its remote socket address.
+                 */
+                _gekkota_event_init(
+                        event, GEKKOTA_EVENT_TYPE_DISCONNECT, client,
+                        0, NULL,
+                        &client->remoteSocketAddress, TRUE);
+
                 xudp->reconfigureBandwidth = TRUE;
                 gekkota_xudpclient_destroy(client);
-                xudp->lastServicedClient = client;
+                return 1;
 
-                return ((*event = _gekkota_event_new(
-                        GEKKOTA_EVENT_TYPE_DISCONNECT, client,
-                        0, NULL,
-                        client->remoteEndPoint, TRUE)) == NULL) ? -1 : 1;
+            default:
+                break;
         }
+    }
+
+    /*
+     * Channels are serviced round-robin: a channel that delivered a packet
+     * goes back to the end of the ready queue, while a channel with nothing
+     * left to deliver leaves it until new messages become deliverable.
+     */
+    while (!gekkota_list_is_empty(&xudp->readyChannels))
+    {
+        channel = (GekkotaChannel *) gekkota_list_remove(
+                gekkota_list_head(&xudp->readyChannels));
+        client = channel->client;
 
         if (client->state != GEKKOTA_CLIENT_STATE_CONNECTED)
             continue;
 
-        for (channel = client->channels;
-                channel < &client->channels[client->channelCount];
-                channel++)
+        switch (_gekkota_xudpclient_receive(
+                client, (uint8_t) (channel - client->channels),
+                &packet, &remoteSocketAddress))
         {
-            if (gekkota_list_is_empty(&channel->incomingReliableMessages) &&
-                    gekkota_list_is_empty(&channel->incomingUnreliableMessages))
-                continue;
+            case -1:    return -1;  /* error */
+            case 0:     continue;   /* no packet received */
+            case 1:     break;      /* packet received */
+        }
 
-            switch (gekkota_xudpclient_receive(
-                    client, (uint8_t) (channel - client->channels),
-                    &packet, &remoteEndPoint))
-            {
-                case -1:    return -1;  /* error */
-                case 0:     continue;   /* no packet received */
-                case 1:     break;      /* packet received */
-            }
+        _gekkota_event_init(
+                event, GEKKOTA_EVENT_TYPE_RECEIVE, client,
+                (uint8_t) (channel - client->channels),
+                packet, &remoteSocketAddress, FALSE);
+        return 1;
+    }
 
-            *event = _gekkota_event_new(
-                    GEKKOTA_EVENT_TYPE_RECEIVE, client,
-                    (uint8_t) (channel - client->channels),
-                    packet, remoteEndPoint, FALSE);
+    return 0;
+}
 
-            if (*event == NULL)
-            {
-                gekkota_packet_destroy(packet);
-                gekkota_ipendpoint_destroy(remoteEndPoint);
+static int32_t
+_gekkota_xudp_dispatch_0(
+        GekkotaXudp *restrict xudp,
+        GekkotaEvent **restrict event)
+{
+    GekkotaEvent dispatchedEvent;
 
-                return -1;
-            }
+    switch (_gekkota_xudp_dispatch(xudp, &dispatchedEvent))
+    {
+        case -1:    return -1;  /* error */
+        case 0:     return 0;   /* no event dispatched */
+        default:    break;      /* event dispatched */
+    }
 
-            xudp->lastServicedClient = client;
-            return 1;
-        }
-    } while (client != xudp->lastServicedClient);
+    /*
+     * The new event takes over the packet of the dispatched one.
+     */
+    if ((*event = _gekkota_event_new(
+            dispatchedEvent.type,
+            dispatchedEvent.client,
+            dispatchedEvent.channelId,
+            dispatchedEvent.packet,
+            &dispatchedEvent.remoteSocketAddress, FALSE)) == NULL)
+    {
+        gekkota_event_clear(&dispatchedEvent);
+        return -1;
+    }
 
-    return 0;
+    return 1;
 }
 
 static GekkotaXudpMessageType
@@ -1112,45 +2141,208 @@ _gekkota_xudp_dispose_acknowledged_message(
         uint16_t sequenceNumber,
         uint8_t channelId)
 {
-    GekkotaListIterator iterator;
     GekkotaOutgoingMessage *outgoingMessage;
     GekkotaXudpMessageType messageType;
 
-    for (iterator = gekkota_list_head(&client->sentReliableMessages);
-            iterator != gekkota_list_tail(&client->sentReliableMessages);
-            iterator = gekkota_list_next(iterator))
+    if ((outgoingMessage = _gekkota_xudpclient_find_sent_reliable_message(
+            client, sequenceNumber, channelId)) == NULL)
+        return GEKKOTA_XUDP_MESSAGE_TYPE_UNDEFINED;
+
+    messageType = outgoingMessage->message.header.messageType;
+    _gekkota_xudpclient_remove_sent_reliable_message(client, outgoingMessage);
+
+    if (outgoingMessage->packet != NULL)
+    {
+        client->reliableDataInTransit -= outgoingMessage->fragmentLength;
+        _gekkota_xudpclient_unpin_memory(client, outgoingMemory, outgoingMessage->fragmentLength);
+        gekkota_packet_destroy(outgoingMessage->packet);
+    }
+
+    gekkota_memory_free(outgoingMessage);
+
+    return messageType;
+}
+
+static size_t
+_gekkota_xudp_encode_compact_message(
+        const GekkotaXudpMessage *message,
+        byte_t *restrict data)
+{
+    byte_t *cursor = data;
+
+    *cursor++ = message->header.messageType;
+    *cursor++ = message->header.channelId;
+    *cursor++ = message->header.flags;
+    memcpy(cursor, &message->header.sequenceNumber, sizeof(uint16_t));
+    cursor += sizeof(uint16_t);
+
+    switch (message->header.messageType)
+    {
+        case GEKKOTA_XUDP_MESSAGE_TYPE_RELIABLE_DATA:
+            cursor += _gekkota_xudp_write_varint(cursor,
+                    gekkota_net_to_host_16(message->reliableData.length));
+            break;
+
+        case GEKKOTA_XUDP_MESSAGE_TYPE_UNRELIABLE_DATA:
+            memcpy(cursor, &message->unreliableData.sequenceNumber, sizeof(uint16_t));
+            cursor += sizeof(uint16_t);
+            cursor += _gekkota_xudp_write_varint(cursor,
+                    gekkota_net_to_host_16(message->unreliableData.length));
+            break;
+
+        case GEKKOTA_XUDP_MESSAGE_TYPE_UNSEQUENCED_DATA:
+            memcpy(cursor, &message->unsequencedData.group, sizeof(uint16_t));
+            cursor += sizeof(uint16_t);
+            cursor += _gekkota_xudp_write_varint(cursor,
+                    gekkota_net_to_host_16(message->unsequencedData.length));
+            break;
+
+        case GEKKOTA_XUDP_MESSAGE_TYPE_DATA_FRAGMENT:
+            cursor += _gekkota_xudp_write_varint(cursor,
+                    gekkota_net_to_host_32(message->dataFragment.fragmentNumber));
+            cursor += _gekkota_xudp_write_varint(cursor,
+                    gekkota_net_to_host_32(message->dataFragment.fragmentCount));
+            cursor += _gekkota_xudp_write_varint(cursor,
+                    gekkota_net_to_host_32(message->dataFragment.totalLength));
+            cursor += _gekkota_xudp_write_varint(cursor,
+                    gekkota_net_to_host_16(message->dataFragment.length));
+            break;
+    }
+
+    return (size_t) (cursor - data);
+}
+
+static size_t
+_gekkota_xudp_encode_header(
+        const GekkotaXudpHeader *header,
+        byte_t *restrict data)
+{
+    const GekkotaXudpField *field;
+    size_t headerSize, offset = 0;
+    uint8_t version = header->version >> 2;
+
+    headerSize = _gekkota_xudp_header_size(version);
+
+    if (!gekkota_bit_isset(
+            header->version & GEKKOTA_XUDP_HEADER_FLAG_MASK,
+            GEKKOTA_XUDP_HEADER_FLAG_SENT_TIME))
+        headerSize = version < GEKKOTA_XUDP_PACKED_VERSION
+            ? (size_t) &((GekkotaXudpHeader *) 0)->sentTime
+            : headerSize - sizeof(uint16_t);
+
+    if (version < GEKKOTA_XUDP_PACKED_VERSION)
+    {
+        memcpy(data, header, headerSize);
+        return headerSize;
+    }
+
+    for (field = headerFields; offset < headerSize; field++)
+    {
+        memcpy(data + offset, (const byte_t *) header + field->offset, field->size);
+        offset += field->size;
+    }
+
+    return headerSize;
+}
+
+static size_t
+_gekkota_xudp_encode_message(
+        const GekkotaXudpMessage *message,
+        uint8_t version,
+        byte_t *restrict data)
+{
+    const GekkotaXudpLayout *layout;
+    const GekkotaXudpField *field;
+    size_t messageSize;
+
+    if (version >= GEKKOTA_XUDP_PACKED_VERSION &&
+            _gekkota_xudp_is_compact(message->header.messageType, message->header.flags))
+        return _gekkota_xudp_encode_compact_message(message, data);
+
+    messageSize = _gekkota_xudp_message_size(message->header.messageType, version);
+
+    if (version < GEKKOTA_XUDP_PACKED_VERSION)
+    {
+        memcpy(data, message, messageSize);
+        return messageSize;
+    }
+
+    for (field = messageHeaderFields;
+            field < &messageHeaderFields[sizeof(messageHeaderFields) / sizeof(GekkotaXudpField)];
+            field++)
+    {
+        memcpy(data, (const byte_t *) message + field->offset, field->size);
+        data += field->size;
+    }
+
+    layout = &messageLayouts[message->header.messageType];
+
+    for (field = layout->fields; field < &layout->fields[layout->fieldCount]; field++)
     {
-        outgoingMessage = (GekkotaOutgoingMessage *) iterator;
-
-        if (outgoingMessage->reliableSequenceNumber == sequenceNumber &&
-                outgoingMessage->message.header.channelId == channelId)
-            break;
+        memcpy(data, (const byte_t *) message + field->offset, field->size);
+        data += field->size;
     }
 
-    if (iterator == gekkota_list_tail(&client->sentReliableMessages))
-        return GEKKOTA_XUDP_MESSAGE_TYPE_UNDEFINED;
+    return messageSize;
+}
 
-    messageType = outgoingMessage->message.header.messageType;
-    gekkota_list_remove(&outgoingMessage->listNode);
+static int32_t
+_gekkota_xudp_expire_timers(
+        GekkotaXudp *xudp,
+        GekkotaEvent **event)
+{
+    GekkotaList expiredTimers, *slot;
+    GekkotaListNode *timerNode;
+    GekkotaXudpClient *client;
+    int32_t rc = 0;
 
-    if (outgoingMessage->packet != NULL)
+    gekkota_list_clear(&expiredTimers);
+
+    /*
+     * Advance the wheel up to the current time, collecting the timers of
+     * each slot that comes due.
+     */
+    while (xudp->timerCount > 0 &&
+            (int32_t) (xudp->currentTime - xudp->timerWheelTime) >= 0)
     {
-        client->reliableDataInTransit -= outgoingMessage->fragmentLength;
-        gekkota_packet_destroy(outgoingMessage->packet);
+        if ((xudp->timerWheelTime & GEKKOTA_XUDP_TIMER_WHEEL_MASK) == 0 &&
+                _gekkota_xudp_cascade_timers(xudp, 1) == 0)
+            _gekkota_xudp_cascade_timers(xudp, 2);
+
+        slot = &xudp->timerWheel[0][xudp->timerWheelTime & GEKKOTA_XUDP_TIMER_WHEEL_MASK];
+
+        while (!gekkota_list_is_empty(slot))
+        {
+            timerNode = gekkota_list_remove(gekkota_list_head(slot));
+            gekkota_list_add(&expiredTimers, timerNode);
+            --xudp->timerCount;
+        }
+
+        ++xudp->timerWheelTime;
     }
 
-    gekkota_memory_free(outgoingMessage);
+    if (xudp->timerCount == 0)
+        xudp->timerWheelTime = xudp->currentTime + 1;
 
-    if (gekkota_list_is_empty(&client->sentReliableMessages))
-        return messageType;
+    while (!gekkota_list_is_empty(&expiredTimers))
+    {
+        timerNode = gekkota_list_remove(gekkota_list_head(&expiredTimers));
+        client = _gekkota_xudpclient_from_node(timerNode, timerNode);
 
-    outgoingMessage = (GekkotaOutgoingMessage *)
-        gekkota_list_first(&client->sentReliableMessages);
+        if (rc != 0)
+        {
+            /*
+             * An event has already been generated: leave the remaining
+             * timers due, so that they expire on the next call.
+             */
+            _gekkota_xudp_insert_timer(xudp, client);
+            continue;
+        }
 
-    client->nextTimeout = outgoingMessage->sentTime
-            + outgoingMessage->roundTripTimeout;
+        rc = _gekkota_xudp_on_timer(xudp, client, event);
+    }
 
-    return messageType;
+    return rc;
 }
 
 static int32_t
@@ -1174,14 +2366,15 @@ _gekkota_xudp_get_message_handler_args(
         uint16_t clientId;
         uint8_t headerFlags;
 
-        if (xudp->receivedDataLength < sizeof(GekkotaXudpHeader))
+        header = &args->decodedHeader;
+
+        if ((headerSize = _gekkota_xudp_decode_header(
+                xudp->receivedData, xudp->receivedDataLength, header)) == 0)
             /*
              * Not an XUDP packet.
              */
             return 0;
 
-        header = (GekkotaXudpHeader *) xudp->receivedData;
-
         /*
          * The protocol version takes just 6 bits;
          * the first 2 MSB contain the header flags.
@@ -1217,14 +2410,20 @@ _gekkota_xudp_get_message_handler_args(
                  * The received data contains a message targeting a multicast
                  * group.
                  */
-                for (client = xudp->clients;
-                        client < &xudp->clients[xudp->clientCount];
-                        client++)
+                GekkotaListIterator iterator;
+
+                for (iterator = gekkota_list_head(&xudp->connectedClients);
+                        iterator != gekkota_list_tail(&xudp->connectedClients);
+                        iterator = gekkota_list_next(iterator))
+                {
+                    client = _gekkota_xudpclient_from_node(iterator, connectedNode);
+
                     if (client->isMulticastGroupMember &&
                             client->remoteClientId == clientId)
                         break;
+                }
 
-                if (client >= &xudp->clients[xudp->clientCount])
+                if (iterator == gekkota_list_tail(&xudp->connectedClients))
                     /*
                      * Multicast client not found.
                      */
@@ -1240,9 +2439,10 @@ _gekkota_xudp_get_message_handler_args(
 
                 if (client->state == GEKKOTA_CLIENT_STATE_DISCONNECTED ||
                         client->state == GEKKOTA_CLIENT_STATE_ZOMBIE ||
-                        !gekkota_ipaddress_equals(
-                            xudp->remoteEndPoint->address,
-                            client->remoteEndPoint->address))
+                        !_gekkota_ipendpoint_socketaddress_equals(
+                            xudp->remoteSocketAddress,
+                            &client->remoteSocketAddress,
+                            FALSE))
                     return 0;
             }
 
@@ -1251,7 +2451,8 @@ _gekkota_xudp_get_message_handler_args(
                 uint32_t checksum = header->sessionId;
                 GekkotaBuffer buffer;
 
-                header->sessionId = client->sessionId;
+                memcpy(xudp->receivedData + GEKKOTA_XUDP_SESSION_ID_OFFSET(header->version >> 2),
+                        &client->sessionId, sizeof(uint32_t));
 
                 buffer.data = xudp->receivedData;
                 buffer.length = xudp->receivedDataLength;
@@ -1277,10 +2478,6 @@ _gekkota_xudp_get_message_handler_args(
             return 0;
         }
 
-        headerSize = gekkota_bit_isset(headerFlags, GEKKOTA_XUDP_HEADER_FLAG_SENT_TIME)
-            ? sizeof(GekkotaXudpHeader)
-            : (size_t) &((GekkotaXudpHeader *) 0)->sentTime;
-
         args->header = header;
         args->client = client;
         args->data = xudp->receivedData + headerSize;
@@ -1290,16 +2487,18 @@ _gekkota_xudp_get_message_handler_args(
      * Get the next message and check it.
      */
 
-    message = (GekkotaXudpMessage *) args->data;
+    message = &args->decodedMessage;
 
-    if (args->data + sizeof(GekkotaXudpMessageHeader) > &xudp->receivedData[
-            xudp->receivedDataLength])
+    if (args->data >= &xudp->receivedData[xudp->receivedDataLength])
         return 0;
 
-    messageType = message->header.messageType;
+    /*
+     * The message type is the first byte in both layouts.
+     */
+    messageType = args->data[0];
 
     if (messageType == GEKKOTA_XUDP_MESSAGE_TYPE_UNDEFINED ||
-            messageType >= sizeof(messageSizes) / sizeof(0))
+            messageType >= sizeof(messageSizes) / sizeof(messageSizes[0]))
         return 0;
 
     if (args->client == NULL && messageType != GEKKOTA_XUDP_MESSAGE_TYPE_CONNECT)
@@ -1308,9 +2507,11 @@ _gekkota_xudp_get_message_handler_args(
          */
         return 0;
 
-    messageSize = messageSizes[messageType];
-
-    if (args->data + messageSize > &xudp->receivedData[xudp->receivedDataLength])
+    if ((messageSize = _gekkota_xudp_decode_message(
+            args->data,
+            (size_t) (&xudp->receivedData[xudp->receivedDataLength] - args->data),
+            args->header->version >> 2,
+            message)) == 0)
         return 0;
 
     args->data += messageSize;
@@ -1322,6 +2523,99 @@ _gekkota_xudp_get_message_handler_args(
     return 1;
 }
 
+static uint32_t
+_gekkota_xudp_get_next_timeout(const GekkotaXudp *xudp, uint32_t currentTime)
+{
+    const GekkotaList *slot;
+    const GekkotaListNode *timerNode;
+    const GekkotaXudpClient *client;
+    uint32_t deadline = 0, index, i;
+    uint8_t level;
+    bool_t found = FALSE;
+
+    if (xudp->timerCount == 0)
+        return GEKKOTA_XUDP_DEFAULT_POLL_TIMEOUT;
+
+    /*
+     * Slots are visited in expiration order starting from the current one;
+     * on the upper levels the current slot has already been cascaded and
+     * holds timers due one full revolution later, so it comes last. Timers
+     * on an upper level might expire before those on a lower one, so the
+     * first non-empty slot of every level is taken into account.
+     */
+    for (level = 0; level < GEKKOTA_XUDP_TIMER_WHEEL_LEVELS; level++)
+    {
+        index = xudp->timerWheelTime >> (level * GEKKOTA_XUDP_TIMER_WHEEL_SLOT_BITS);
+
+        if (level > 0)
+            ++index;
+
+        for (i = 0; i < GEKKOTA_XUDP_TIMER_WHEEL_SLOTS; i++)
+        {
+            slot = &xudp->timerWheel[level][(index + i) & GEKKOTA_XUDP_TIMER_WHEEL_MASK];
+
+            if (gekkota_list_is_empty(slot))
+                continue;
+
+            for (timerNode = gekkota_list_head(slot);
+                    timerNode != gekkota_list_tail(slot);
+                    timerNode = gekkota_list_next(timerNode))
+            {
+                client = _gekkota_xudpclient_from_node(timerNode, timerNode);
+
+                if (!found || (int32_t) (client->timerDeadline - deadline) < 0)
+                    deadline = client->timerDeadline;
+
+                found = TRUE;
+            }
+
+            break;
+        }
+    }
+
+    if ((int32_t) (deadline - currentTime) <= 0)
+        return 0;
+
+    return deadline - currentTime;
+}
+
+static void_t
+_gekkota_xudp_insert_timer(
+        GekkotaXudp *restrict xudp,
+        GekkotaXudpClient *restrict client)
+{
+    GekkotaList *slot;
+    uint32_t deadline, delta;
+
+    deadline = client->timerDeadline;
+    delta = deadline - xudp->timerWheelTime;
+
+    /*
+     * Level 0 resolves single milliseconds over one revolution, while each
+     * upper level covers a revolution of the level below per slot; timers
+     * too far in the future are parked in the last slot of the top level
+     * and rescheduled when they expire.
+     */
+    if ((int32_t) delta < 0)
+        slot = &xudp->timerWheel[0][xudp->timerWheelTime & GEKKOTA_XUDP_TIMER_WHEEL_MASK];
+    else if (delta < (1 << GEKKOTA_XUDP_TIMER_WHEEL_SLOT_BITS))
+        slot = &xudp->timerWheel[0][deadline & GEKKOTA_XUDP_TIMER_WHEEL_MASK];
+    else if (delta < (1 << (2 * GEKKOTA_XUDP_TIMER_WHEEL_SLOT_BITS)))
+        slot = &xudp->timerWheel[1][(deadline >> GEKKOTA_XUDP_TIMER_WHEEL_SLOT_BITS)
+            & GEKKOTA_XUDP_TIMER_WHEEL_MASK];
+    else
+    {
+        if (delta >= (1 << (3 * GEKKOTA_XUDP_TIMER_WHEEL_SLOT_BITS)))
+            deadline = xudp->timerWheelTime + (1 << (3 * GEKKOTA_XUDP_TIMER_WHEEL_SLOT_BITS)) - 1;
+
+        slot = &xudp->timerWheel[2][(deadline >> (2 * GEKKOTA_XUDP_TIMER_WHEEL_SLOT_BITS))
+            & GEKKOTA_XUDP_TIMER_WHEEL_MASK];
+    }
+
+    gekkota_list_add(slot, &client->timerNode);
+    ++xudp->timerCount;
+}
+
 static int32_t
 _gekkota_xudp_notify_connect(
         GekkotaXudp *restrict xudp,
@@ -1331,18 +2625,19 @@ _gekkota_xudp_notify_connect(
     xudp->reconfigureBandwidth = TRUE;
 
     if (event == NULL)
-        client->state = client->state == GEKKOTA_CLIENT_STATE_CONNECTING
-            ? GEKKOTA_CLIENT_STATE_CONNECTION_SUCCEEDED
-            : GEKKOTA_CLIENT_STATE_CONNECTION_PENDING;
+        _gekkota_xudpclient_set_state(client,
+                client->state == GEKKOTA_CLIENT_STATE_CONNECTING
+                    ? GEKKOTA_CLIENT_STATE_CONNECTION_SUCCEEDED
+                    : GEKKOTA_CLIENT_STATE_CONNECTION_PENDING);
     else
     {
         if ((*event = _gekkota_event_new(
                 GEKKOTA_EVENT_TYPE_CONNECT, client,
                 0, NULL,
-                client->remoteEndPoint, TRUE)) == NULL)
+                &client->remoteSocketAddress, TRUE)) == NULL)
             return -1;
 
-        client->state = GEKKOTA_CLIENT_STATE_CONNECTED;
+        _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_CONNECTED);
     }
 
     return 0;
@@ -1361,13 +2656,13 @@ _gekkota_xudp_notify_disconnect(
             client->state < GEKKOTA_CLIENT_STATE_CONNECTION_SUCCEEDED)
         gekkota_xudpclient_destroy(client);
     else if (event == NULL)
-        client->state = GEKKOTA_CLIENT_STATE_ZOMBIE;
+        _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_ZOMBIE);
     else
     {
         *event = _gekkota_event_new(
                 GEKKOTA_EVENT_TYPE_DISCONNECT, client,
                 0, NULL,
-                client->remoteEndPoint, TRUE);
+                &client->remoteSocketAddress, TRUE);
         gekkota_xudpclient_destroy(client);
 
         if (*event == NULL)
@@ -1378,45 +2673,53 @@ _gekkota_xudp_notify_disconnect(
 }
 
 static int32_t
-_gekkota_xudp_on_acknowledge_message(
+_gekkota_xudp_on_acknowledgement(
         GekkotaXudp *xudp,
         GekkotaXudpMessageHandlerArgs *args,
+        uint16_t sequenceNumber,
+        uint32_t bitmap,
+        uint16_t sentTime,
         GekkotaEvent **event)
 {
-    uint32_t roundTripTime, sentTime;
-    uint16_t sequenceNumber;
-    GekkotaXudpMessageType messageType;
+    uint32_t roundTripTime, fullSentTime;
+    GekkotaXudpMessageType messageType, disposedMessageType;
 
     GekkotaXudpClient *client = args->client;
-    GekkotaXudpMessage *message = args->message;
+    uint8_t channelId = args->message->header.channelId;
 
-    sentTime = gekkota_net_to_host_16(message->acknowledge.sentTime);
-    sentTime |= xudp->currentTime & 0xFFFF0000;
+    fullSentTime = sentTime | (xudp->currentTime & 0xFFFF0000);
 
-    if ((sentTime & 0x8000) > (xudp->currentTime & 0x8000))
-        sentTime -= 0x10000;
+    if ((fullSentTime & 0x8000) > (xudp->currentTime & 0x8000))
+        fullSentTime -= 0x10000;
 
-    if (gekkota_time_compare(xudp->currentTime, sentTime) < 0)
+    if (gekkota_time_compare(xudp->currentTime, fullSentTime) < 0)
         return 1;
 
     client->lastReceiveTime = xudp->currentTime;
     client->earliestTimeout = 0;
 
-    roundTripTime = (uint32_t) gekkota_time_get_lag(xudp->currentTime, sentTime);
+    roundTripTime = (uint32_t) gekkota_time_get_lag(xudp->receivedTime, fullSentTime);
 
-    _gekkota_xudpclient_throttle(client, roundTripTime);
+    if (xudp->preciseRoundTripTime)
+        roundTripTime = _gekkota_xudp_update_round_trip_time_us(
+                xudp, client, sequenceNumber, channelId, sentTime, roundTripTime);
 
-    client->roundTripTimeVariance -= client->roundTripTimeVariance / 4;
+    _gekkota_xudpclient_throttle(client, roundTripTime);
 
-    if (roundTripTime >= client->roundTripTime)
+    if (!xudp->preciseRoundTripTime)
     {
-        client->roundTripTime += (roundTripTime - client->roundTripTime) / 8;
-        client->roundTripTimeVariance += (roundTripTime - client->roundTripTime) / 4;
-    }
-    else
-    {
-        client->roundTripTime -= (client->roundTripTime - roundTripTime) / 8;
-        client->roundTripTimeVariance += (client->roundTripTime - roundTripTime) / 4;
+        client->roundTripTimeVariance -= client->roundTripTimeVariance / 4;
+
+        if (roundTripTime >= client->roundTripTime)
+        {
+            client->roundTripTime += (roundTripTime - client->roundTripTime) / 8;
+            client->roundTripTimeVariance += (roundTripTime - client->roundTripTime) / 4;
+        }
+        else
+        {
+            client->roundTripTime -= (client->roundTripTime - roundTripTime) / 8;
+            client->roundTripTimeVariance += (client->roundTripTime - roundTripTime) / 4;
+        }
     }
 
     if (client->roundTripTime < client->lowestRoundTripTime)
@@ -1437,10 +2740,30 @@ _gekkota_xudp_on_acknowledge_message(
         client->packetThrottleEpoch = xudp->currentTime;
     }
 
-    sequenceNumber = gekkota_net_to_host_16(message->acknowledge.sequenceNumber);
-
     messageType = _gekkota_xudp_dispose_acknowledged_message(
-            client, sequenceNumber, message->header.channelId);
+            client, sequenceNumber, channelId);
+
+    /*
+     * Bit n of [bitmap] acknowledges [sequenceNumber] + n + 1; connection
+     * control messages take precedence when determining the state change.
+     */
+    for (; bitmap != 0; bitmap >>= 1)
+    {
+        ++sequenceNumber;
+
+        if (!gekkota_bit_isset(bitmap, 1))
+            continue;
+
+        disposedMessageType = _gekkota_xudp_dispose_acknowledged_message(
+                client, sequenceNumber, channelId);
+
+        if (messageType == GEKKOTA_XUDP_MESSAGE_TYPE_UNDEFINED ||
+                disposedMessageType == GEKKOTA_XUDP_MESSAGE_TYPE_VALIDATE_CONNECT ||
+                disposedMessageType == GEKKOTA_XUDP_MESSAGE_TYPE_DISCONNECT)
+            messageType = disposedMessageType;
+    }
+
+    _gekkota_xudp_update_retransmit_timer(client);
 
     switch (client->state)
     {
@@ -1475,6 +2798,23 @@ _gekkota_xudp_on_acknowledge_message(
     return 1;
 }
 
+static int32_t
+_gekkota_xudp_on_acknowledge_message(
+        GekkotaXudp *xudp,
+        GekkotaXudpMessageHandlerArgs *args,
+        GekkotaEvent **event)
+{
+    GekkotaXudpMessage *message = args->message;
+
+    return _gekkota_xudp_on_acknowledgement(
+            xudp,
+            args,
+            gekkota_net_to_host_16(message->acknowledge.sequenceNumber),
+            0,
+            gekkota_net_to_host_16(message->acknowledge.sentTime),
+            event);
+}
+
 static int32_t
 _gekkota_xudp_on_connect_message(
         GekkotaXudp *xudp,
@@ -1487,6 +2827,7 @@ _gekkota_xudp_on_connect_message(
     uint8_t channelCount;
     GekkotaXudpMessage validateConnectMessage;
     GekkotaXudpClient *client;
+    GekkotaListIterator iterator;
 
     GekkotaXudpHeader *header = args->header;
     GekkotaXudpMessage *message = args->message;
@@ -1495,10 +2836,12 @@ _gekkota_xudp_on_connect_message(
     uint32_t checksum = header->sessionId;
     GekkotaBuffer buffer;
 
-    message->header.sequenceNumber = gekkota_host_to_net_16(
-            message->header.sequenceNumber);
-
-    header->sessionId = message->connect.sessionId;
+    /*
+     * [message] is a decoded copy, so the received data still holds the
+     * sequence number in network byte order.
+     */
+    memcpy(xudp->receivedData + GEKKOTA_XUDP_SESSION_ID_OFFSET(header->version >> 2),
+            &message->connect.sessionId, sizeof(uint32_t));
 
     buffer.data = xudp->receivedData;
     buffer.length = xudp->receivedDataLength;
@@ -1508,19 +2851,20 @@ _gekkota_xudp_on_connect_message(
         errno = GEKKOTA_ERROR_MESSAGE_CORRUPTED;
         return -1;
     }
-
-    message->header.sequenceNumber = gekkota_net_to_host_16(
-            message->header.sequenceNumber);
 #endif /* CRC32_ENAMBED */
  
     channelCount = message->connect.channelCount;
 
-    for (client = xudp->clients;
-            client < &xudp->clients[xudp->clientCount];
-            client++)
+    for (iterator = gekkota_list_head(&xudp->connectedClients);
+            iterator != gekkota_list_tail(&xudp->connectedClients);
+            iterator = gekkota_list_next(iterator))
     {
-        if (client->state != GEKKOTA_CLIENT_STATE_DISCONNECTED &&
-                gekkota_ipendpoint_equals(xudp->remoteEndPoint, client->remoteEndPoint) &&
+        client = _gekkota_xudpclient_from_node(iterator, connectedNode);
+
+        if (_gekkota_ipendpoint_socketaddress_equals(
+                    xudp->remoteSocketAddress,
+                    &client->remoteSocketAddress,
+                    TRUE) &&
                 client->sessionId == message->connect.sessionId)
             /*
              * Already connected.
@@ -1540,15 +2884,23 @@ _gekkota_xudp_on_connect_message(
          */
         return 0;
 
+    if ((client->remoteEndPoint = gekkota_ipendpoint_new_2(xudp->remoteSocketAddress)) == NULL)
+        return -1;
+
     if ((client->channels = gekkota_memory_alloc(
             sizeof(GekkotaChannel) * channelCount, TRUE)) == NULL)
+    {
+        gekkota_ipendpoint_destroy(client->remoteEndPoint);
+        client->remoteEndPoint = NULL;
         return -1;
+    }
 
     client->sessionId = message->connect.sessionId;
+    client->protocolVersion = header->version >> 2;
     client->remoteClientId = gekkota_net_to_host_16(message->connect.clientId);
-    client->remoteEndPoint = gekkota_ipendpoint_new_0(xudp->remoteEndPoint, FALSE);
+    client->remoteSocketAddress = *xudp->remoteSocketAddress;
     client->isMulticastGroupMember = FALSE;
-    client->state = GEKKOTA_CLIENT_STATE_ACKNOWLEDGING_CONNECT;
+    _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_ACKNOWLEDGING_CONNECT);
     client->channelCount = channelCount;
     client->incomingBandwidth = gekkota_net_to_host_32(message->connect.incomingBandwidth);
     client->outgoingBandwidth = gekkota_net_to_host_32(message->connect.outgoingBandwidth);
@@ -1561,6 +2913,7 @@ _gekkota_xudp_on_connect_message(
             channel < &client->channels[channelCount];
             channel++)
     {
+        channel->client = client;
         gekkota_list_clear(&channel->incomingReliableMessages);
         gekkota_list_clear(&channel->incomingUnreliableMessages);
     }
@@ -1610,6 +2963,35 @@ _gekkota_xudp_on_connect_message(
     validateConnectMessage.header.channelId = 0xFF;
     validateConnectMessage.header.flags = GEKKOTA_XUDP_MESSAGE_FLAG_ACKNOWLEDGE;
 
+    /*
+     * Range acknowledgements are used only if both ends support them: the
+     * connecting client advertises them, and the flag is echoed back.
+     */
+    if (gekkota_bit_isset(
+            message->header.flags,
+            GEKKOTA_XUDP_MESSAGE_FLAG_ACKNOWLEDGE_RANGE))
+    {
+        client->acknowledgeRanges = TRUE;
+        gekkota_bit_set(
+                validateConnectMessage.header.flags,
+                GEKKOTA_XUDP_MESSAGE_FLAG_ACKNOWLEDGE_RANGE);
+    }
+
+    /*
+     * The same goes for compact data messages, which require the packed
+     * layout.
+     */
+    if (gekkota_bit_isset(
+            message->header.flags,
+            GEKKOTA_XUDP_MESSAGE_FLAG_COMPACT) &&
+            client->protocolVersion >= GEKKOTA_XUDP_PACKED_VERSION)
+    {
+        client->compactHeaders = TRUE;
+        gekkota_bit_set(
+                validateConnectMessage.header.flags,
+                GEKKOTA_XUDP_MESSAGE_FLAG_COMPACT);
+    }
+
     /* message body */
     validateConnectMessage.validateConnect.clientId =
         gekkota_host_to_net_16(client->localClientId);
@@ -1665,11 +3047,21 @@ _gekkota_xudp_on_validate_connect_message(
                 message->validateConnect.throttleDeceleration) != client->packetThrottleDeceleration ||
             message->validateConnect.compressionLevel != client->compressionLevel)
     {
-        client->state = GEKKOTA_CLIENT_STATE_ZOMBIE;
+        _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_ZOMBIE);
         return 0;
     }
 
     _gekkota_xudp_dispose_acknowledged_message(client, 1, 0xFF);
+    _gekkota_xudp_update_retransmit_timer(client);
+
+    client->acknowledgeRanges = gekkota_bit_isset(
+            message->header.flags,
+            GEKKOTA_XUDP_MESSAGE_FLAG_ACKNOWLEDGE_RANGE) ? TRUE : FALSE;
+
+    client->compactHeaders = gekkota_bit_isset(
+            message->header.flags,
+            GEKKOTA_XUDP_MESSAGE_FLAG_COMPACT) &&
+            client->protocolVersion >= GEKKOTA_XUDP_PACKED_VERSION ? TRUE : FALSE;
 
     client->remoteClientId =
         gekkota_net_to_host_16(message->validateConnect.clientId);
@@ -1715,7 +3107,7 @@ _gekkota_xudp_on_disconnect_message(
     _gekkota_xudpclient_clear_message_queues(client);
 
     if (client->state == GEKKOTA_CLIENT_STATE_CONNECTION_SUCCEEDED)
-        client->state = GEKKOTA_CLIENT_STATE_ZOMBIE;
+        _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_ZOMBIE);
     else if (client->state != GEKKOTA_CLIENT_STATE_CONNECTED &&
         client->state != GEKKOTA_CLIENT_STATE_DELAYING_DISCONNECT)
     {
@@ -1727,9 +3119,9 @@ _gekkota_xudp_on_disconnect_message(
     else if (gekkota_bit_isset(
             message->header.flags,
             GEKKOTA_XUDP_MESSAGE_FLAG_ACKNOWLEDGE))
-        client->state = GEKKOTA_CLIENT_STATE_ACKNOWLEDGING_DISCONNECT;
+        _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_ACKNOWLEDGING_DISCONNECT);
     else
-        client->state = GEKKOTA_CLIENT_STATE_ZOMBIE;
+        _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_ZOMBIE);
 
     return 1;
 }
@@ -1749,7 +3141,7 @@ _gekkota_xudp_on_join_multicast_group_message(
         if ((*event = _gekkota_event_new(
                 GEKKOTA_EVENT_TYPE_JOIN_MULTICAST_GROUP, args->client,
                 0, NULL,
-                xudp->remoteEndPoint, TRUE)) == NULL)
+                xudp->remoteSocketAddress, TRUE)) == NULL)
             return -1;
     }
 
@@ -1771,7 +3163,7 @@ _gekkota_xudp_on_leave_multicast_group_message(
         if ((*event = _gekkota_event_new(
                 GEKKOTA_EVENT_TYPE_LEAVE_MULTICAST_GROUP, args->client,
                 0, NULL,
-                xudp->remoteEndPoint, TRUE)) == NULL)
+                xudp->remoteSocketAddress, TRUE)) == NULL)
             return -1;
     }
 
@@ -1787,6 +3179,42 @@ _gekkota_xudp_on_ping_message(
     return 1;
 }
 
+static GekkotaPacket *
+_gekkota_xudp_new_incoming_packet(
+        GekkotaXudp *xudp,
+        byte_t *data,
+        size_t dataLength,
+        GekkotaPacketFlag flags)
+{
+    GekkotaPacket *packet;
+
+    /*
+     * Small payloads are copied rather than keeping alive a receive
+     * buffer many times their size, which the client would be charged
+     * for until the application destroys the packet.
+     */
+    if (dataLength * GEKKOTA_XUDP_MAX_SLICE_OVERHEAD < xudp->receivedPacket->data.length)
+    {
+        if ((packet = gekkota_packet_new_1(gekkota_utils_max(dataLength, 1), flags)) == NULL)
+            return NULL;
+
+        memcpy(packet->data.data, data, dataLength);
+        packet->data.length = dataLength;
+
+        return packet;
+    }
+
+    /*
+     * Otherwise the packet is a slice of the receive buffer the data
+     * arrived in.
+     */
+    return _gekkota_packet_new_slice(
+            xudp->receivedPacket,
+            (size_t) (data - (byte_t *) xudp->receivedPacket->data.data),
+            dataLength,
+            flags);
+}
+
 static int32_t
 _gekkota_xudp_on_reliable_data_message(
         GekkotaXudp *xudp,
@@ -1795,7 +3223,6 @@ _gekkota_xudp_on_reliable_data_message(
 {
     int32_t rc;
     size_t dataLength;
-    GekkotaBuffer buffer;
     GekkotaPacket *packet;
     GekkotaPacketFlag flags = GEKKOTA_PACKET_FLAG_RELIABLE;
 
@@ -1816,19 +3243,17 @@ _gekkota_xudp_on_reliable_data_message(
     if (args->data > &xudp->receivedData[xudp->receivedDataLength])
         return 0;
 
-    buffer.data = (byte_t *) message + sizeof(GekkotaXudpReliableDataMessage);
-    buffer.length = dataLength;
-
     if (gekkota_bit_isset(
             message->reliableData.header.flags,
             GEKKOTA_XUDP_MESSAGE_FLAG_COMPRESSED))
         gekkota_bit_set(flags, GEKKOTA_PACKET_FLAG_COMPRESSED);
 
-    if ((packet = gekkota_packet_new_2(&buffer, flags)) == NULL)
+    if ((packet = _gekkota_xudp_new_incoming_packet(
+            xudp, args->data - dataLength, dataLength, flags)) == NULL)
         return -1;
 
     rc = _gekkota_xudpclient_queue_incoming_message(
-            client, message, packet, 0, xudp->remoteEndPoint, NULL);
+            client, message, packet, 0, xudp->remoteSocketAddress, NULL);
 
     gekkota_packet_destroy(packet);
     return rc;
@@ -1842,7 +3267,6 @@ _gekkota_xudp_on_unreliable_data_message(
 {
     int32_t rc;
     size_t dataLength;
-    GekkotaBuffer buffer;
     GekkotaPacket *packet;
     GekkotaPacketFlag flags = GEKKOTA_PACKET_FLAG_NONE;
 
@@ -1863,19 +3287,17 @@ _gekkota_xudp_on_unreliable_data_message(
     if (args->data > &xudp->receivedData[xudp->receivedDataLength])
         return 0;
 
-    buffer.data = (byte_t *) message + sizeof(GekkotaXudpUnreliableDataMessage);
-    buffer.length = dataLength;
-
     if (gekkota_bit_isset(
             message->unreliableData.header.flags,
             GEKKOTA_XUDP_MESSAGE_FLAG_COMPRESSED))
         flags = GEKKOTA_PACKET_FLAG_COMPRESSED;
 
-    if ((packet = gekkota_packet_new_2(&buffer, flags)) == NULL)
+    if ((packet = _gekkota_xudp_new_incoming_packet(
+            xudp, args->data - dataLength, dataLength, flags)) == NULL)
         return -1;
 
     rc = _gekkota_xudpclient_queue_incoming_message(
-            client, message, packet, 0, xudp->remoteEndPoint, NULL);
+            client, message, packet, 0, xudp->remoteSocketAddress, NULL);
 
     gekkota_packet_destroy(packet);
     return rc;
@@ -1890,7 +3312,6 @@ _gekkota_xudp_on_unsequenced_data_message(
     int32_t rc;
     size_t dataLength;
     uint16_t group, index;
-    GekkotaBuffer buffer;
     GekkotaPacket *packet;
     GekkotaPacketFlag flags = GEKKOTA_PACKET_FLAG_UNSEQUENCED;
 
@@ -1927,19 +3348,17 @@ _gekkota_xudp_on_unsequenced_data_message(
 
     client->unsequencedWindow[index / 32] |= 1 << (index % 32);
 
-    buffer.data = (byte_t *) message + sizeof(GekkotaXudpUnsequencedDataMessage);
-    buffer.length = dataLength;
-
     if (gekkota_bit_isset(
             message->unsequencedData.header.flags,
             GEKKOTA_XUDP_MESSAGE_FLAG_COMPRESSED))
         gekkota_bit_set(flags, GEKKOTA_PACKET_FLAG_COMPRESSED);
 
-    if ((packet = gekkota_packet_new_2(&buffer, flags)) == NULL)
+    if ((packet = _gekkota_xudp_new_incoming_packet(
+            xudp, args->data - dataLength, dataLength, flags)) == NULL)
         return -1;
 
     rc = _gekkota_xudpclient_queue_incoming_message(
-            client, message, packet, 0, xudp->remoteEndPoint, NULL);
+            client, message, packet, 0, xudp->remoteSocketAddress, NULL);
 
     gekkota_packet_destroy(packet);
     return rc;
@@ -1953,9 +3372,10 @@ _gekkota_xudp_on_data_fragment_message(
 {
     uint32_t fragmentNumber, fragmentCount, fragmentOffset, fragmentLength;
     uint32_t startSequenceNumber, totalLength;
-    GekkotaListIterator iterator;
+    uint16_t distance;
     GekkotaChannel *channel;
     GekkotaIncomingMessage *startMessage;
+    const byte_t *fragmentData;
 
     GekkotaXudpMessage *message = args->message;
     GekkotaXudpClient *client = args->client;
@@ -1969,6 +3389,7 @@ _gekkota_xudp_on_data_fragment_message(
      * Move to next message, if any.
      */
     fragmentLength = gekkota_net_to_host_16(message->dataFragment.length);
+    fragmentData = args->data;
     args->data += fragmentLength;
 
     if (args->data > &xudp->receivedData[xudp->receivedDataLength])
@@ -1979,29 +3400,17 @@ _gekkota_xudp_on_data_fragment_message(
         gekkota_net_to_host_16(message->dataFragment.startSequenceNumber);
 
     /*
-     * If the sequence numbers received so far are all at the high end of the
-     * 16-bit range, but a just received sequence number is at the low end,
-     * assume it was a sequence number that wrapped around back to the low end
-     * again and treat it as a number greater than 2e16, being values greater
-     * than or equal to 0xF000 the high end, and values less than 0x1000 the
-     * low end.
+     * Fragments of packets already delivered are just acknowledged, while
+     * those of packets starting beyond the reorder window are dropped.
      */
+    distance = (uint16_t) (startSequenceNumber - channel->incomingReliableSequenceNumber);
 
-    if (channel->incomingReliableSequenceNumber >= 0xF000 &&
-            startSequenceNumber < 0x1000)
-        startSequenceNumber += 0x10000;
-
-    /*
-     * Check if even after adjustment the sequence number is less than the ones
-     * already received; it is almost impossible to have anywhere near to 2e16
-     * packets in flight at any given time.
-     */
-
-    if (startSequenceNumber < channel->incomingReliableSequenceNumber ||
-            (channel->incomingReliableSequenceNumber < 0x1000 &&
-            (startSequenceNumber & 0x0000FFFF) >= 0xF000))
+    if (distance == 0 || distance >= 0x8000)
         return 1;
 
+    if (distance > GEKKOTA_XUDP_CLIENT_REORDER_WINDOW_SIZE)
+        return 0;
+
     fragmentNumber = gekkota_net_to_host_32(message->dataFragment.fragmentNumber);
     fragmentCount = gekkota_net_to_host_32(message->dataFragment.fragmentCount);
     fragmentOffset = gekkota_net_to_host_32(message->dataFragment.fragmentOffset);
@@ -2009,25 +3418,18 @@ _gekkota_xudp_on_data_fragment_message(
 
     if (fragmentOffset >= totalLength ||
         fragmentOffset + fragmentLength > totalLength ||
-        fragmentNumber >= fragmentCount)
+        fragmentNumber >= fragmentCount ||
+        fragmentCount > totalLength ||
+        totalLength > GEKKOTA_XUDP_CLIENT_MAX_PACKET_SIZE)
         return 0;
 
     /*
-     * Search for already received fragments, if any.
+     * Look up already received fragments, if any.
      */
-    for (iterator = gekkota_list_previous(gekkota_list_tail(&channel->incomingReliableMessages));
-            iterator != gekkota_list_tail(&channel->incomingReliableMessages);
-            iterator = gekkota_list_previous(iterator))
-    {
-        startMessage = (GekkotaIncomingMessage *) iterator;
-
-        if (startMessage->message.header.messageType == GEKKOTA_XUDP_MESSAGE_TYPE_DATA_FRAGMENT &&
-                startMessage->message.dataFragment.startSequenceNumber ==
-                (startSequenceNumber & 0x0000FFFF))
-            break;
-    }
+    startMessage = channel->incomingReliableWindow[
+        startSequenceNumber & (GEKKOTA_XUDP_CLIENT_REORDER_WINDOW_SIZE - 1)];
 
-    if (iterator == gekkota_list_tail(&channel->incomingReliableMessages))
+    if (startMessage == NULL)
     {
         /*
          * First fragment: allocate enough room to reassemble the original
@@ -2039,8 +3441,8 @@ _gekkota_xudp_on_data_fragment_message(
         GekkotaPacket *packet;
         GekkotaPacketFlag flags = GEKKOTA_PACKET_FLAG_RELIABLE;
 
-        newMessage.header.sequenceNumber = (uint16_t) (startSequenceNumber & 0x0000FFFF);
-        newMessage.dataFragment.startSequenceNumber = (uint16_t) (startSequenceNumber & 0x0000FFFF);
+        newMessage.header.sequenceNumber = (uint16_t) startSequenceNumber;
+        newMessage.dataFragment.startSequenceNumber = (uint16_t) startSequenceNumber;
         newMessage.dataFragment.length = (uint16_t) fragmentLength;
         newMessage.dataFragment.fragmentNumber = fragmentNumber;
         newMessage.dataFragment.fragmentCount = fragmentCount;
@@ -2051,16 +3453,28 @@ _gekkota_xudp_on_data_fragment_message(
                 message->dataFragment.header.flags,
                 GEKKOTA_XUDP_MESSAGE_FLAG_COMPRESSED))
             gekkota_bit_set(flags, GEKKOTA_PACKET_FLAG_COMPRESSED);
-        
+
+        /*
+         * Check the announced length against the memory limits before
+         * allocating anything, so that a peer cannot make the client pin
+         * a large reassembly buffer with a single fragment.
+         */
+        if (!_gekkota_xudpclient_fits_memory_limit(client, incomingMemory,
+                sizeof(GekkotaIncomingMessage) + totalLength))
+            return 0;
+
         if ((packet = gekkota_packet_new_1(totalLength, flags)) == NULL)
             return -1;
 
         rc = _gekkota_xudpclient_queue_incoming_message(
-                client, &newMessage, packet, fragmentCount, xudp->remoteEndPoint, &startMessage);
+                client, &newMessage, packet, fragmentCount, xudp->remoteSocketAddress, &startMessage);
 
         gekkota_packet_destroy(packet);
-        if (rc < 0) return -1;
+        if (rc <= 0 || startMessage == NULL) return rc;
     }
+    else if (startMessage->message.header.messageType != GEKKOTA_XUDP_MESSAGE_TYPE_DATA_FRAGMENT ||
+            startMessage->reliableSequenceNumber != (uint16_t) startSequenceNumber)
+        return 0;
     else if (totalLength != startMessage->packet->data.length ||
             fragmentCount != startMessage->fragmentCount)
         return 0;
@@ -2070,11 +3484,16 @@ _gekkota_xudp_on_data_fragment_message(
         --startMessage->fragmentsRemaining;
         startMessage->fragments[fragmentNumber / 32] |= (1 << (fragmentNumber % 32));
 
+        if (startMessage->fragmentsRemaining == 0 &&
+                startMessage->reliableSequenceNumber ==
+                (uint16_t) (channel->incomingReliableSequenceNumber + 1))
+            _gekkota_xudpclient_schedule_receive(channel);
+
         if (fragmentOffset + fragmentLength > startMessage->packet->data.length)
             fragmentLength = (uint16_t) (startMessage->packet->data.length - fragmentOffset);
 
         memcpy((byte_t *) startMessage->packet->data.data + fragmentOffset,
-                (byte_t *) message + sizeof(GekkotaXudpDataFragmentMessage),
+                fragmentData,
                 fragmentLength);
     }
 
@@ -2109,38 +3528,138 @@ _gekkota_xudp_on_configure_bandwidth_message(
         else if (windowSize > GEKKOTA_XUDP_MAX_WINDOW_SIZE)
             windowSize = GEKKOTA_XUDP_MAX_WINDOW_SIZE;
 
-        client->windowSize = windowSize;
+        client->windowSize = windowSize;
+    }
+
+    return 1;
+}
+
+static int32_t
+_gekkota_xudp_on_configure_throttle_message(
+        GekkotaXudp *xudp,
+        GekkotaXudpMessageHandlerArgs *args,
+        GekkotaEvent **event)
+{
+    GekkotaXudpMessage *message = args->message;
+    GekkotaXudpClient *client = args->client;
+
+    client->packetThrottleInterval =  gekkota_net_to_host_32(
+            message->configureThrottle.throttleInterval);
+    client->packetThrottleAcceleration = gekkota_net_to_host_32(
+            message->configureThrottle.throttleAcceleration);
+    client->packetThrottleDeceleration = gekkota_net_to_host_32(
+            message->configureThrottle.throttleDeceleration);
+
+    return 1;
+}
+
+static int32_t
+_gekkota_xudp_on_acknowledge_range_message(
+        GekkotaXudp *xudp,
+        GekkotaXudpMessageHandlerArgs *args,
+        GekkotaEvent **event)
+{
+    GekkotaXudpMessage *message = args->message;
+
+    return _gekkota_xudp_on_acknowledgement(
+            xudp,
+            args,
+            gekkota_net_to_host_16(message->acknowledgeRange.sequenceNumber),
+            gekkota_net_to_host_32(message->acknowledgeRange.bitmap),
+            gekkota_net_to_host_16(message->acknowledgeRange.sentTime),
+            event);
+}
+
+static int32_t
+_gekkota_xudp_on_timer(
+        GekkotaXudp *xudp,
+        GekkotaXudpClient *client,
+        GekkotaEvent **event)
+{
+    uint32_t deadline;
+
+    if (client->state == GEKKOTA_CLIENT_STATE_DISCONNECTED ||
+            client->state == GEKKOTA_CLIENT_STATE_ZOMBIE)
+        return 0;
+
+    if (!gekkota_list_is_empty(&client->sentReliableMessages))
+    {
+        if ((int32_t) (xudp->currentTime - client->nextTimeout) >= 0)
+        {
+            switch (_gekkota_xudp_check_for_timeouts(xudp, client, event))
+            {
+                case -1:    return -1;  /* error */
+                case 0:     break;      /* no connection timeout occurrd */
+                case 1:     return 1;   /* connection timeout occurred */
+            }
+        }
+    }
+    else if (gekkota_list_is_empty(&client->outgoingReliableMessages) &&
+            client->state == GEKKOTA_CLIENT_STATE_CONNECTED &&
+            !client->isMulticastGroupMember &&
+            gekkota_time_get_lag(
+                xudp->currentTime,
+                client->lastReceiveTime) >= GEKKOTA_XUDP_CLIENT_PING_INTERVAL)
+    {
+        /*
+         * Sending the ping schedules its own retransmission deadline.
+         */
+        if (gekkota_xudpclient_ping(client) != 0)
+            return -1;
+    }
+
+    /*
+     * Reschedule the client for either its next retransmission or its next
+     * ping, whichever applies.
+     */
+    if (!gekkota_list_is_empty(&client->sentReliableMessages))
+        deadline = client->nextTimeout;
+    else
+    {
+        deadline = client->lastReceiveTime + GEKKOTA_XUDP_CLIENT_PING_INTERVAL;
+
+        if ((int32_t) (deadline - xudp->currentTime) <= 0)
+            deadline = xudp->currentTime + GEKKOTA_XUDP_CLIENT_PING_INTERVAL;
     }
 
-    return 1;
+    _gekkota_xudp_schedule_timer(xudp, client, deadline);
+    return 0;
 }
 
-static int32_t
-_gekkota_xudp_on_configure_throttle_message(
-        GekkotaXudp *xudp,
-        GekkotaXudpMessageHandlerArgs *args,
-        GekkotaEvent **event)
+static bool_t
+_gekkota_xudp_read_varint(
+        const byte_t **data,
+        const byte_t *end,
+        uint32_t *restrict value)
 {
-    GekkotaXudpMessage *message = args->message;
-    GekkotaXudpClient *client = args->client;
+    const byte_t *cursor = *data;
+    uint8_t shift;
 
-    client->packetThrottleInterval =  gekkota_net_to_host_32(
-            message->configureThrottle.throttleInterval);
-    client->packetThrottleAcceleration = gekkota_net_to_host_32(
-            message->configureThrottle.throttleAcceleration);
-    client->packetThrottleDeceleration = gekkota_net_to_host_32(
-            message->configureThrottle.throttleDeceleration);
+    /*
+     * 7 bits per byte, least significant group first; the most significant
+     * bit is set on every byte but the last.
+     */
+    for (*value = 0, shift = 0; cursor < end && shift < 32; shift += 7)
+    {
+        *value |= (uint32_t) (*cursor & 0x7F) << shift;
 
-    return 1;
+        if ((*cursor++ & 0x80) == 0)
+        {
+            *data = cursor;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
 }
+
 static int32_t
 _gekkota_xudp_receive(
         GekkotaXudp *xudp,
         GekkotaEvent **event)
 {
     GekkotaXudpMessageHandlerArgs args;
-    GekkotaIPEndPoint *remoteEndPoint;
-    GekkotaBuffer buffer;
+    GekkotaDatagram *datagram;
     int32_t recv;
 
     if (event != NULL)
@@ -2148,20 +3667,114 @@ _gekkota_xudp_receive(
 
     while (TRUE)
     {
-        buffer.data = xudp->receivedData;
-        buffer.length = sizeof(xudp->receivedData);
+        if (xudp->receivedDatagramIndex == xudp->receivedDatagramCount)
+        {
+            /*
+             * All the datagrams in the receive ring have been processed:
+             * refill it.
+             */
+            uint16_t i;
+            GekkotaPacket *packet;
 
-        recv = gekkota_socket_receive(
-                xudp->socket,
-                &buffer, 1,
-                &remoteEndPoint);
+            for (i = 0; i < GEKKOTA_XUDP_RECEIVE_RING_SIZE; i++)
+            {
+                /*
+                 * Buffers still referenced by incoming packets are left
+                 * to them and replaced with fresh ones from the pool; the
+                 * reference count may drop concurrently, but once it is
+                 * down to one it cannot rise again.
+                 */
+                if ((packet = xudp->receivePackets[i]) == NULL ||
+                        packet->refCount > 1)
+                {
+                    if ((packet = _gekkota_packet_pool_get(xudp->receivePool)) == NULL)
+                        return -1;
+
+                    if (xudp->receivePackets[i] != NULL)
+                        gekkota_packet_destroy(xudp->receivePackets[i]);
+
+                    xudp->receivePackets[i] = packet;
+                }
+
+                xudp->receiveBuffers[i].data = packet->data.data;
+                xudp->receiveBuffers[i].length = packet->data.length;
+
+                xudp->receivedDatagrams[i].remoteSocketAddress = &xudp->receivedSocketAddresses[i];
+                xudp->receivedDatagrams[i].buffers = &xudp->receiveBuffers[i];
+                xudp->receivedDatagrams[i].bufferCount = 1;
+                xudp->receivedDatagrams[i].length = 0;
+            }
+
+            xudp->receivedDatagramIndex = xudp->receivedDatagramCount = 0;
+
+            recv = gekkota_socket_receive_batch(
+                    xudp->socket,
+                    xudp->receivedDatagrams,
+                    GEKKOTA_XUDP_RECEIVE_RING_SIZE);
+
+            if (recv < 0)   return -1;
+            if (recv == 0)  return 0;
+
+            xudp->receivedDatagramCount = (uint16_t) recv;
+
+            if (xudp->receiveTimestamps)
+            {
+                xudp->receivedBatchTime = gekkota_time_now();
+                xudp->receivedBatchTimeUs = gekkota_time_now_us();
+            }
+        }
+
+        datagram = &xudp->receivedDatagrams[xudp->receivedDatagramIndex];
+        xudp->receivedPacket = xudp->receivePackets[xudp->receivedDatagramIndex];
+
+        if (datagram->length == 0)
+        {
+            /*
+             * Empty or truncated datagram.
+             */
+            xudp->receivedDatagramIndex++;
+            continue;
+        }
+
+        /*
+         * The source address is kept as is; no endpoint is allocated
+         * unless the application asks for it. Coalesced datagrams are
+         * processed one at a time.
+         */
+        xudp->receivedData = (byte_t *) datagram->buffers->data + xudp->receivedSegmentOffset;
+        xudp->receivedDataLength = datagram->segmentSize > 0
+            ? gekkota_utils_min(datagram->segmentSize,
+                    datagram->length - xudp->receivedSegmentOffset)
+            : datagram->length;
+        xudp->remoteSocketAddress = datagram->remoteSocketAddress;
 
-        if (recv < 0)   return -1;
-        if (recv == 0)  return 0;
+        /*
+         * Without a kernel timestamp, data is taken as arriving when it is
+         * processed.
+         */
+        if (datagram->receiveTime != 0)
+        {
+            /*
+             * Kernel timestamps are on the microsecond clock, which need
+             * not share its origin with the millisecond one: carry over
+             * how long ago the datagram arrived instead.
+             */
+            xudp->receivedTimeUs = datagram->receiveTime;
+            xudp->receivedTime = xudp->receivedBatchTime - (uint32_t) (
+                    (xudp->receivedBatchTimeUs - gekkota_utils_min(
+                            datagram->receiveTime, xudp->receivedBatchTimeUs)) / 1000);
+        }
+        else
+        {
+            xudp->receivedTimeUs = xudp->currentTimeUs;
+            xudp->receivedTime = xudp->currentTime;
+        }
 
-        xudp->receivedDataLength = (uint16_t) recv;
-        gekkota_ipendpoint_destroy(xudp->remoteEndPoint);
-        xudp->remoteEndPoint = remoteEndPoint;
+        if ((xudp->receivedSegmentOffset += xudp->receivedDataLength) >= datagram->length)
+        {
+            xudp->receivedSegmentOffset = 0;
+            xudp->receivedDatagramIndex++;
+        }
 
         memset(&args, 0x00, sizeof(GekkotaXudpMessageHandlerArgs));
 
@@ -2176,7 +3789,13 @@ _gekkota_xudp_receive(
             switch (_gekkota_xudp_get_message_handler_args(xudp, &args))
             {
                 case -1:    goto _gekkota_xudp_receive_error;
-                case 0:     continue;   /* message discarded */
+                case 0:
+                    /*
+                     * [args.data] has not been advanced, so the rest of
+                     * the received data cannot be parsed: discard it.
+                     */
+                    args.data = &xudp->receivedData[xudp->receivedDataLength];
+                    continue;
                 default:    break;      /* message is valid */
             }
 
@@ -2215,30 +3834,84 @@ _gekkota_xudp_receive_error:
     return -1;
 }
 
+static void_t
+_gekkota_xudp_schedule_timer(
+        GekkotaXudp *restrict xudp,
+        GekkotaXudpClient *restrict client,
+        uint32_t deadline)
+{
+    /*
+     * A scheduled timer is only ever moved to an earlier deadline; if it
+     * then expires too early, it just reschedules itself.
+     */
+    if (client->timerNode.next != NULL)
+    {
+        if ((int32_t) (deadline - client->timerDeadline) >= 0)
+            return;
+
+        gekkota_list_remove(&client->timerNode);
+        --xudp->timerCount;
+    }
+
+    if (xudp->timerCount == 0)
+        xudp->timerWheelTime = xudp->currentTime;
+
+    client->timerDeadline = deadline;
+    _gekkota_xudp_insert_timer(xudp, client);
+}
+
 static int32_t
 _gekkota_xudp_send(
         GekkotaXudp *xudp,
         GekkotaEvent **event,
         bool_t checkForTimeouts)
 {
+    GekkotaXudpDatagram *datagram;
     GekkotaXudpHeader header;
     GekkotaXudpClient *client;
-    int32_t sent;       /* -1:  error */
-                        /* 0+:  number of bytes sent */
+    GekkotaListIterator iterator;
 
     int32_t send = 1;   /* -1:  error */
                         /*  0:  stop sending queued messages */
                         /*  1:  continue sending queued messages */
 
+    /*
+     * Reliable messages are stamped with the time their datagrams leave,
+     * not with the time the poll iteration started.
+     */
+    if (xudp->preciseRoundTripTime)
+        xudp->currentTimeUs = gekkota_time_now_us();
+
+    /*
+     * Retransmit timed out messages and queue pings for the clients whose
+     * timers have expired.
+     */
+    if (checkForTimeouts)
+    {
+        switch (_gekkota_xudp_expire_timers(xudp, event))
+        {
+            case -1:    return -1;  /* error */
+            case 0:     break;      /* no connection timeout occurrd */
+            case 1:     return 1;   /* connection timeout occurred */
+        }
+    }
+
     while (send)
     {
-        for (send = 0, client = xudp->clients;
-                client < &xudp->clients[xudp->clientCount];
-                client++)
+        for (send = 0, iterator = gekkota_list_head(&xudp->outgoingClients);
+                iterator != gekkota_list_tail(&xudp->outgoingClients);)
         {
+            client = _gekkota_xudpclient_from_node(iterator, outgoingNode);
+            iterator = gekkota_list_next(iterator);
+
             if (client->state == GEKKOTA_CLIENT_STATE_DISCONNECTED ||
                     client->state == GEKKOTA_CLIENT_STATE_ZOMBIE)
+            {
+                gekkota_list_remove(&client->outgoingNode);
                 continue;
+            }
+
+            datagram = &xudp->datagrams[xudp->datagramCount];
 
             xudp->headerFlags = client->isMulticastGroupMember
                 ? GEKKOTA_XUDP_HEADER_FLAG_MULTICAST
@@ -2246,77 +3919,143 @@ _gekkota_xudp_send(
 
             xudp->messageCount = 0;
             xudp->bufferCount = 1;
-            xudp->packetSize = sizeof(GekkotaXudpHeader);
+            xudp->payloadHeadroom = 0;
+            xudp->packetSize = _gekkota_xudp_header_size(client->protocolVersion);
 
             if (!gekkota_list_is_empty(&client->acknowledgements))
                 if ((send = _gekkota_xudp_send_acknowledgements(xudp, client)) < 0)
-                    return -1;
-
-            if (checkForTimeouts &&
-                    !gekkota_list_is_empty(&client->sentReliableMessages) &&
-                    gekkota_time_compare(xudp->currentTime, client->nextTimeout) >= 0)
-            {
-                switch (_gekkota_xudp_check_for_timeouts(xudp, client, event))
-                {
-                    case -1:    return -1;  /* error */
-                    case 0:     break;      /* no connection timeout occurrd */
-                    case 1:     return 1;   /* connection timeout occurred */
-                }
-            }
+                    goto _gekkota_xudp_send_error;
 
             if (!gekkota_list_is_empty(&client->outgoingReliableMessages))
                 if ((send = _gekkota_xudp_send_reliable(xudp, client)) < 0)
-                    return -1;
-            else if (gekkota_list_is_empty(&client->sentReliableMessages))
-            {
-                if (gekkota_time_get_lag(
-                        xudp->currentTime,
-                        client->lastReceiveTime) >= GEKKOTA_XUDP_CLIENT_PING_INTERVAL &&
-                        client->mtu - xudp->packetSize >= sizeof(GekkotaXudpPingMessage))
-                {
-                    gekkota_xudpclient_ping(client);
-                    if ((send = _gekkota_xudp_send_reliable(xudp, client)) < 0)
-                        return -1;
-                }
-            }
+                    goto _gekkota_xudp_send_error;
 
             if (!gekkota_list_is_empty(&client->outgoingUnreliableMessages))
                 if ((send = _gekkota_xudp_send_unreliable(xudp, client)) < 0)
-                    return -1;
+                    goto _gekkota_xudp_send_error;
+
+            /*
+             * Reliable messages held back by the window keep the client in
+             * the list until acknowledgements make room for them.
+             */
+            if (client->outgoingNode.next != NULL &&
+                    gekkota_list_is_empty(&client->acknowledgements) &&
+                    gekkota_list_is_empty(&client->outgoingReliableMessages) &&
+                    gekkota_list_is_empty(&client->outgoingUnreliableMessages))
+                gekkota_list_remove(&client->outgoingNode);
 
             if (xudp->messageCount == 0)
                 continue;
 
             header.protocolId = xudp->protocolId;
-            header.version = GEKKOTA_XUDP_VERSION << 2;
+            header.version = client->protocolVersion << 2;
             gekkota_bit_set(header.version, xudp->headerFlags & GEKKOTA_XUDP_HEADER_FLAG_MASK);
             header.sessionId = client->sessionId;
             header.clientId = gekkota_host_to_net_16(client->remoteClientId);
-            xudp->buffers->data = &header;
+            header.sentTime = gekkota_host_to_net_16((uint16_t) (xudp->currentTime & 0x0000FFFF));
 
-            if (gekkota_bit_isset(xudp->headerFlags, GEKKOTA_XUDP_HEADER_FLAG_SENT_TIME))
-            {
-                header.sentTime = gekkota_host_to_net_16((uint16_t) (xudp->currentTime & 0x0000FFFF));
-                xudp->buffers->length = sizeof(GekkotaXudpHeader);
-            }
-            else
-                xudp->buffers->length = (size_t) &((GekkotaXudpHeader *) 0)->sentTime;
+            datagram->buffers->data = datagram->header;
+            datagram->buffers->length = _gekkota_xudp_encode_header(&header, datagram->header);
  
 #ifdef CRC32_ENABLED
-            header.sessionId = gekkota_crc32_calculate(xudp->buffers, xudp->bufferCount);
+            header.sessionId = gekkota_crc32_calculate(datagram->buffers, xudp->bufferCount);
+            memcpy(datagram->header + GEKKOTA_XUDP_SESSION_ID_OFFSET(client->protocolVersion),
+                    &header.sessionId, sizeof(uint32_t));
 #endif /* CRC32_ENABLED */
 
-            sent = gekkota_socket_send(
-                    xudp->socket, client->remoteEndPoint, xudp->buffers, xudp->bufferCount);
+            if (xudp->messageCount == 1 && xudp->bufferCount == 3)
+                _gekkota_xudp_coalesce_datagram(xudp, datagram);
 
-            _gekkota_xudpclient_clear_outgoing_message_queue(&client->sentUnreliableMessages);
+            datagram->client = client;
+            datagram->bufferCount = xudp->bufferCount;
 
-            if (sent < 0)
-                return -1;
+            if (++xudp->datagramCount == xudp->sendBatchSize)
+                if (_gekkota_xudp_send_datagrams(xudp) != 0)
+                    return -1;
         }
     }
 
-    return 0;
+    return _gekkota_xudp_send_datagrams(xudp);
+
+_gekkota_xudp_send_error:
+    _gekkota_xudp_send_datagrams(xudp);
+    return -1;
+}
+
+static void_t
+_gekkota_xudp_coalesce_datagram(
+        GekkotaXudp *restrict xudp,
+        GekkotaXudpDatagram *datagram)
+{
+    GekkotaBuffer *buffers = datagram->buffers;
+    byte_t *data, *end;
+    uint16_t i;
+
+    /*
+     * A datagram made of the header, a single message and its payload is
+     * written in place in the headroom of the payload packet, if any, and
+     * goes out as one contiguous buffer.
+     */
+    if (xudp->payloadHeadroom < buffers[0].length + buffers[1].length)
+        return;
+
+    data = (byte_t *) buffers[2].data - (buffers[0].length + buffers[1].length);
+    end = (byte_t *) buffers[2].data + buffers[2].length;
+
+    /*
+     * The same packet might be waiting to be sent to another client in
+     * this batch, in which case its headroom is already taken.
+     */
+    for (i = 0; i < xudp->datagramCount; i++)
+        if (xudp->datagrams[i].bufferCount == 1 &&
+                (byte_t *) xudp->datagrams[i].buffers->data
+                + xudp->datagrams[i].buffers->length == end)
+            return;
+
+    memcpy(data, buffers[0].data, buffers[0].length);
+    memcpy(data + buffers[0].length, buffers[1].data, buffers[1].length);
+
+    buffers[0].data = data;
+    buffers[0].length = (size_t) (end - data);
+    xudp->bufferCount = 1;
+}
+
+static int32_t
+_gekkota_xudp_send_datagrams(GekkotaXudp *restrict xudp)
+{
+    GekkotaDatagram datagrams[GEKKOTA_XUDP_MAX_SEND_BATCH_SIZE];
+    GekkotaXudpDatagram *datagram;
+    int32_t sent;       /* -1:  error */
+                        /* 0+:  number of datagrams sent */
+    uint16_t i;
+
+    if (xudp->datagramCount == 0)
+        return 0;
+
+    for (i = 0; i < xudp->datagramCount; i++)
+    {
+        datagram = &xudp->datagrams[i];
+
+        datagrams[i].remoteSocketAddress = &datagram->client->remoteSocketAddress;
+        datagrams[i].buffers = datagram->buffers;
+        datagrams[i].bufferCount = datagram->bufferCount;
+        datagrams[i].length = 0;
+    }
+
+    sent = gekkota_socket_send_batch(xudp->socket, datagrams, xudp->datagramCount);
+
+    /*
+     * Unreliable messages are never retransmitted, so they are released
+     * as soon as the batch has been handed to the socket, regardless of
+     * whether or not the socket was able to send all the datagrams.
+     */
+    for (i = 0; i < xudp->datagramCount; i++)
+        _gekkota_xudpclient_clear_outgoing_message_queue(
+                xudp->datagrams[i].client,
+                &xudp->datagrams[i].client->sentUnreliableMessages);
+
+    xudp->datagramCount = 0;
+    return sent < 0 ? -1 : 0;
 }
 
 static int32_t
@@ -2324,41 +4063,97 @@ _gekkota_xudp_send_acknowledgements(
         GekkotaXudp *restrict xudp,
         GekkotaXudpClient *restrict client)
 {
-    GekkotaXudpMessage *message = &xudp->messages[xudp->messageCount];
-    GekkotaBuffer *buffer = &xudp->buffers[xudp->bufferCount];
-    GekkotaAcknowledgement *acknowledgement;
-    GekkotaListIterator iterator;
+    GekkotaXudpDatagram *datagram = &xudp->datagrams[xudp->datagramCount];
+    GekkotaXudpMessage *message = &datagram->messages[xudp->messageCount];
+    GekkotaBuffer *buffer = &datagram->buffers[xudp->bufferCount];
+    GekkotaAcknowledgement *acknowledgement, *coveredAcknowledgement;
+    GekkotaXudpMessage acknowledgeMessage;
+    GekkotaListIterator iterator, coveredIterator;
+    size_t messageSize;
+    uint32_t bitmap;
+    uint16_t distance;
     int32_t done = 0;
+
+    messageSize = _gekkota_xudp_message_size(client->acknowledgeRanges
+            ? GEKKOTA_XUDP_MESSAGE_TYPE_ACKNOWLEDGE_RANGE
+            : GEKKOTA_XUDP_MESSAGE_TYPE_ACKNOWLEDGE,
+            client->protocolVersion);
   
     iterator = gekkota_list_head(&client->acknowledgements);
 
     while (iterator != gekkota_list_tail(&client->acknowledgements))
     {
-        if (message >= &xudp->messages[sizeof(xudp->messages) / sizeof(GekkotaXudpMessage)] ||
-                buffer >= &xudp->buffers[sizeof(xudp->buffers) / sizeof(GekkotaBuffer)] ||
-                client->mtu - xudp->packetSize < sizeof(GekkotaXudpAcknowledgeMessage))
+        if (message >= &datagram->messages[sizeof(datagram->messages) / sizeof(GekkotaXudpMessage)] ||
+                buffer >= &datagram->buffers[sizeof(datagram->buffers) / sizeof(GekkotaBuffer)] ||
+                client->mtu - xudp->packetSize < messageSize)
         {
             done = 1;
             break;
         }
 
         acknowledgement = (GekkotaAcknowledgement *) iterator;
+        bitmap = 0;
+
+        if (client->acknowledgeRanges)
+        {
+            /*
+             * Fold the pending acknowledgements for the same channel that
+             * follow [acknowledgement] by at most
+             * GEKKOTA_XUDP_CLIENT_ACKNOWLEDGE_RANGE_SIZE sequence numbers
+             * into a single range acknowledgement.
+             */
+            coveredIterator = gekkota_list_next(iterator);
+
+            while (coveredIterator != gekkota_list_tail(&client->acknowledgements))
+            {
+                coveredAcknowledgement = (GekkotaAcknowledgement *) coveredIterator;
+                coveredIterator = gekkota_list_next(coveredIterator);
+
+                distance = (uint16_t) (coveredAcknowledgement->message.header.sequenceNumber
+                        - acknowledgement->message.header.sequenceNumber);
+
+                if (coveredAcknowledgement->message.header.channelId !=
+                        acknowledgement->message.header.channelId ||
+                        distance > GEKKOTA_XUDP_CLIENT_ACKNOWLEDGE_RANGE_SIZE)
+                    continue;
+
+                if (distance > 0)
+                    gekkota_bit_set(bitmap, (uint32_t) 1 << (distance - 1));
+
+                if (coveredAcknowledgement->message.header.messageType == GEKKOTA_XUDP_MESSAGE_TYPE_DISCONNECT)
+                    _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_ZOMBIE);
+
+                gekkota_list_remove(&coveredAcknowledgement->listNode);
+                gekkota_memory_free(coveredAcknowledgement);
+            }
+        }
+
         iterator = gekkota_list_next(iterator);
 
-        buffer->data = message;
-        buffer->length = sizeof(GekkotaXudpAcknowledgeMessage);
+        if (bitmap != 0)
+        {
+            acknowledgeMessage.header.messageType = GEKKOTA_XUDP_MESSAGE_TYPE_ACKNOWLEDGE_RANGE;
+            acknowledgeMessage.acknowledgeRange.bitmap = gekkota_host_to_net_32(bitmap);
+        }
+        else
+            acknowledgeMessage.header.messageType = GEKKOTA_XUDP_MESSAGE_TYPE_ACKNOWLEDGE;
 
-        xudp->packetSize += buffer->length;
- 
-        message->header.messageType = GEKKOTA_XUDP_MESSAGE_TYPE_ACKNOWLEDGE;
-        message->header.channelId = acknowledgement->message.header.channelId;
-        message->acknowledge.sequenceNumber = gekkota_host_to_net_16(
+        acknowledgeMessage.header.channelId = acknowledgement->message.header.channelId;
+        acknowledgeMessage.header.flags = 0;
+        acknowledgeMessage.header.sequenceNumber = 0;
+        acknowledgeMessage.acknowledge.sequenceNumber = gekkota_host_to_net_16(
                 acknowledgement->message.header.sequenceNumber);
-        message->acknowledge.sentTime = gekkota_host_to_net_16(
+        acknowledgeMessage.acknowledge.sentTime = gekkota_host_to_net_16(
                 (uint16_t) acknowledgement->sentTime);
 
+        buffer->data = message;
+        buffer->length = _gekkota_xudp_encode_message(
+                &acknowledgeMessage, client->protocolVersion, (byte_t *) message);
+
+        xudp->packetSize += buffer->length;
+
         if (acknowledgement->message.header.messageType == GEKKOTA_XUDP_MESSAGE_TYPE_DISCONNECT)
-            client->state = GEKKOTA_CLIENT_STATE_ZOMBIE;
+            _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_ZOMBIE);
 
         gekkota_list_remove(&acknowledgement->listNode);
         gekkota_memory_free(acknowledgement);
@@ -2367,8 +4162,8 @@ _gekkota_xudp_send_acknowledgements(
         ++buffer;
     }
 
-    xudp->messageCount = (uint16_t) (message - xudp->messages);
-    xudp->bufferCount = (uint16_t) (buffer - xudp->buffers);
+    xudp->messageCount = (uint16_t) (message - datagram->messages);
+    xudp->bufferCount = (uint16_t) (buffer - datagram->buffers);
 
     return done;
 }
@@ -2378,8 +4173,9 @@ _gekkota_xudp_send_reliable(
         GekkotaXudp *restrict xudp,
         GekkotaXudpClient *restrict client)
 {
-    GekkotaXudpMessage *message = &xudp->messages[xudp->messageCount];
-    GekkotaBuffer *buffer = &xudp->buffers[xudp->bufferCount];
+    GekkotaXudpDatagram *datagram = &xudp->datagrams[xudp->datagramCount];
+    GekkotaXudpMessage *message = &datagram->messages[xudp->messageCount];
+    GekkotaBuffer *buffer = &datagram->buffers[xudp->bufferCount];
     GekkotaOutgoingMessage *outgoingMessage;
     GekkotaListIterator iterator;
     int32_t done = 0;
@@ -2391,10 +4187,12 @@ _gekkota_xudp_send_reliable(
         size_t messageSize;
 
         outgoingMessage = (GekkotaOutgoingMessage *) iterator;
-        messageSize = messageSizes[outgoingMessage->message.header.messageType];
+        messageSize = _gekkota_xudp_message_size(
+                outgoingMessage->message.header.messageType,
+                client->protocolVersion);
 
-        if (message >= &xudp->messages[sizeof(xudp->messages) / sizeof(GekkotaXudpMessage)] ||
-                buffer + 1 >= &xudp->buffers[sizeof(xudp->buffers) / sizeof(GekkotaBuffer)] ||
+        if (message >= &datagram->messages[sizeof(datagram->messages) / sizeof(GekkotaXudpMessage)] ||
+                buffer + 1 >= &datagram->buffers[sizeof(datagram->buffers) / sizeof(GekkotaBuffer)] ||
                 client->mtu - xudp->packetSize < messageSize)
         {
             done = 1;
@@ -2410,7 +4208,12 @@ _gekkota_xudp_send_reliable(
                 break;
 
             if ((client->mtu - xudp->packetSize) <
-                    (messageSize + outgoingMessage->fragmentLength))
+                    (messageSize + outgoingMessage->fragmentLength) ||
+                    buffer + _gekkota_packet_count_segments(
+                        outgoingMessage->packet,
+                        outgoingMessage->fragmentOffset,
+                        outgoingMessage->fragmentLength)
+                    >= &datagram->buffers[sizeof(datagram->buffers) / sizeof(GekkotaBuffer)])
             {
                 done = 1;
                 break;
@@ -2426,39 +4229,46 @@ _gekkota_xudp_send_reliable(
         }
 
         if (gekkota_list_is_empty(&client->sentReliableMessages))
+        {
             client->nextTimeout = xudp->currentTime + outgoingMessage->roundTripTimeout;
+            _gekkota_xudp_schedule_timer(xudp, client, client->nextTimeout);
+        }
 
-        gekkota_list_add(
-                &client->sentReliableMessages,
-                gekkota_list_remove(&outgoingMessage->listNode));
+        gekkota_list_remove(&outgoingMessage->listNode);
+        _gekkota_xudpclient_add_sent_reliable_message(client, outgoingMessage);
 
         outgoingMessage->sentTime = xudp->currentTime;
+        outgoingMessage->sentTimeUs = xudp->currentTimeUs;
 
         buffer->data = message;
-        buffer->length = messageSize;
+        buffer->length = _gekkota_xudp_encode_message(
+                &outgoingMessage->message, client->protocolVersion, (byte_t *) message);
 
         xudp->packetSize += buffer->length;
         gekkota_bit_set(xudp->headerFlags, GEKKOTA_XUDP_HEADER_FLAG_SENT_TIME);
-        *message = outgoingMessage->message;
+
+        ++buffer;
 
         if (outgoingMessage->packet != NULL)
         {
-            ++buffer;
+            buffer += _gekkota_packet_get_segments(
+                    outgoingMessage->packet,
+                    outgoingMessage->fragmentOffset,
+                    outgoingMessage->fragmentLength,
+                    buffer);
 
-            buffer->data = (byte_t *) outgoingMessage->packet->data.data
-                + outgoingMessage->fragmentOffset;
-            buffer->length = outgoingMessage->fragmentLength;
+            xudp->payloadHeadroom = _gekkota_xudp_get_headroom(
+                    outgoingMessage->packet, outgoingMessage->fragmentOffset);
 
             xudp->packetSize += outgoingMessage->fragmentLength;
             client->reliableDataInTransit += outgoingMessage->fragmentLength;
         }
 
         ++message;
-        ++buffer;
     }
 
-    xudp->messageCount = (uint16_t) (message - xudp->messages);
-    xudp->bufferCount = (uint16_t) (buffer - xudp->buffers);
+    xudp->messageCount = (uint16_t) (message - datagram->messages);
+    xudp->bufferCount = (uint16_t) (buffer - datagram->buffers);
 
     return done;
 }
@@ -2468,8 +4278,9 @@ _gekkota_xudp_send_unreliable(
         GekkotaXudp *restrict xudp,
         GekkotaXudpClient *client)
 {
-    GekkotaXudpMessage *message = &xudp->messages[xudp->messageCount];
-    GekkotaBuffer *buffer = &xudp->buffers[xudp->bufferCount];
+    GekkotaXudpDatagram *datagram = &xudp->datagrams[xudp->datagramCount];
+    GekkotaXudpMessage *message = &datagram->messages[xudp->messageCount];
+    GekkotaBuffer *buffer = &datagram->buffers[xudp->bufferCount];
     GekkotaOutgoingMessage *outgoingMessage;
     GekkotaListIterator iterator;
     int32_t done = 0;
@@ -2481,13 +4292,18 @@ _gekkota_xudp_send_unreliable(
         size_t messageSize;
 
         outgoingMessage = (GekkotaOutgoingMessage *) iterator;
-        messageSize = messageSizes[outgoingMessage->message.header.messageType];
+        messageSize = _gekkota_xudp_message_size(
+                outgoingMessage->message.header.messageType,
+                client->protocolVersion);
 
-        if (message >= &xudp->messages[sizeof(xudp->messages) / sizeof(GekkotaXudpMessage)] ||
-                buffer + 1 >= &xudp->buffers[sizeof(xudp->buffers) / sizeof (GekkotaBuffer)] ||
+        if (message >= &datagram->messages[sizeof(datagram->messages) / sizeof(GekkotaXudpMessage)] ||
+                buffer + 1 >= &datagram->buffers[sizeof(datagram->buffers) / sizeof (GekkotaBuffer)] ||
                 client->mtu - xudp->packetSize < messageSize ||
                 (outgoingMessage->packet != NULL &&
-                client->mtu - xudp->packetSize < messageSize + outgoingMessage->packet->data.length))
+                (client->mtu - xudp->packetSize < messageSize + outgoingMessage->packet->data.length ||
+                buffer + _gekkota_packet_count_segments(
+                    outgoingMessage->packet, 0, outgoingMessage->packet->data.length)
+                >= &datagram->buffers[sizeof(datagram->buffers) / sizeof (GekkotaBuffer)])))
         {
             done = 1;
             break;
@@ -2502,6 +4318,7 @@ _gekkota_xudp_send_unreliable(
 
             if (client->packetThrottleCounter > client->packetThrottle)
             {
+                _gekkota_xudpclient_unpin_memory(client, outgoingMemory, outgoingMessage->fragmentLength);
                 gekkota_packet_destroy(outgoingMessage->packet);
                 gekkota_list_remove(&outgoingMessage->listNode);
                 gekkota_memory_free(outgoingMessage);
@@ -2511,30 +4328,35 @@ _gekkota_xudp_send_unreliable(
         }
 
         buffer->data = message;
-        buffer->length = messageSize;
+        buffer->length = _gekkota_xudp_encode_message(
+                &outgoingMessage->message, client->protocolVersion, (byte_t *) message);
         xudp->packetSize += buffer->length;
-        *message = outgoingMessage->message;
         gekkota_list_remove(&outgoingMessage->listNode);
 
+        ++buffer;
+
         if (outgoingMessage->packet != NULL)
         {
-            ++buffer;
+            buffer += _gekkota_packet_get_segments(
+                    outgoingMessage->packet,
+                    0,
+                    outgoingMessage->packet->data.length,
+                    buffer);
 
-            buffer->data = outgoingMessage->packet->data.data;
-            buffer->length = outgoingMessage->packet->data.length;
+            xudp->payloadHeadroom = _gekkota_xudp_get_headroom(
+                    outgoingMessage->packet, 0);
 
-            xudp->packetSize += buffer->length;
+            xudp->packetSize += outgoingMessage->packet->data.length;
             gekkota_list_add(&client->sentUnreliableMessages, outgoingMessage);
         }
         else
             gekkota_memory_free(outgoingMessage);
 
         ++message;
-        ++buffer;
     }
 
-    xudp->messageCount = (uint16_t) (message - xudp->messages);
-    xudp->bufferCount = (uint16_t) (buffer - xudp->buffers);
+    xudp->messageCount = (uint16_t) (message - datagram->messages);
+    xudp->bufferCount = (uint16_t) (buffer - datagram->buffers);
 
     if (client->state == GEKKOTA_CLIENT_STATE_DELAYING_DISCONNECT &&
             gekkota_list_is_empty(&client->outgoingReliableMessages) &&
@@ -2554,18 +4376,21 @@ _gekkota_xudp_throttle_bandwidth(GekkotaXudp *restrict xudp)
     uint32_t bandwidth, throttle = 0, bandwidthLimit = 0;
     bool_t adjustBandwidth;
     GekkotaXudpClient *client;
+    GekkotaListIterator iterator;
     GekkotaXudpMessage message;
 
-    elapsedTime = currentTime = (uint32_t) gekkota_time_now();
+    elapsedTime = currentTime = xudp->currentTime;
     elapsedTime -= xudp->bandwidthThrottleEpoch;
 
     if (elapsedTime < GEKKOTA_XUDP_BANDWIDTH_THROTTLE_INTERVAL)
         return 0;
 
-    for (client = xudp->clients;
-            client < &xudp->clients[xudp->clientCount];
-            client++)
+    for (iterator = gekkota_list_head(&xudp->connectedClients);
+            iterator != gekkota_list_tail(&xudp->connectedClients);
+            iterator = gekkota_list_next(iterator))
     {
+        client = _gekkota_xudpclient_from_node(iterator, connectedNode);
+
         if (client->state != GEKKOTA_CLIENT_STATE_CONNECTED &&
                 client->state != GEKKOTA_CLIENT_STATE_DELAYING_DISCONNECT)
             continue;
@@ -2595,10 +4420,12 @@ _gekkota_xudp_throttle_bandwidth(GekkotaXudp *restrict xudp)
             throttle = (bandwidth * GEKKOTA_XUDP_CLIENT_PACKET_THROTTLE_SCALE)
                 / dataTotal;
 
-        for (client = xudp->clients;
-                client < &xudp->clients[xudp->clientCount];
-                client++)
+        for (iterator = gekkota_list_head(&xudp->connectedClients);
+                iterator != gekkota_list_tail(&xudp->connectedClients);
+                iterator = gekkota_list_next(iterator))
         {
+            client = _gekkota_xudpclient_from_node(iterator, connectedNode);
+
             uint32_t clientBandwidth;
 
             if ((client->state != GEKKOTA_CLIENT_STATE_CONNECTED &&
@@ -2634,10 +4461,12 @@ _gekkota_xudp_throttle_bandwidth(GekkotaXudp *restrict xudp)
 
     if (clientsRemaining > 0)
     {
-        for (client = xudp->clients;
-                client < &xudp->clients[xudp->clientCount];
-                client++)
+        for (iterator = gekkota_list_head(&xudp->connectedClients);
+                iterator != gekkota_list_tail(&xudp->connectedClients);
+                iterator = gekkota_list_next(iterator))
         {
+            client = _gekkota_xudpclient_from_node(iterator, connectedNode);
+
             if ((client->state != GEKKOTA_CLIENT_STATE_CONNECTED &&
                     client->state != GEKKOTA_CLIENT_STATE_DELAYING_DISCONNECT) ||
                     client->outgoingBandwidthThrottleEpoch == currentTime)
@@ -2665,10 +4494,12 @@ _gekkota_xudp_throttle_bandwidth(GekkotaXudp *restrict xudp)
             adjustBandwidth = FALSE;
             bandwidthLimit = bandwidth / clientsRemaining;
 
-            for (client = xudp->clients;
-                    client < &xudp->clients[xudp->clientCount];
-                    client++)
+            for (iterator = gekkota_list_head(&xudp->connectedClients);
+                    iterator != gekkota_list_tail(&xudp->connectedClients);
+                    iterator = gekkota_list_next(iterator))
             {
+                client = _gekkota_xudpclient_from_node(iterator, connectedNode);
+
                 if ((client->state != GEKKOTA_CLIENT_STATE_CONNECTED &&
                         client->state != GEKKOTA_CLIENT_STATE_DELAYING_DISCONNECT) ||
                         client->incomingBandwidthThrottleEpoch == currentTime)
@@ -2685,10 +4516,12 @@ _gekkota_xudp_throttle_bandwidth(GekkotaXudp *restrict xudp)
             }
         }
 
-        for (client = xudp->clients;
-                client < &xudp->clients[xudp->clientCount];
-                client++)
+        for (iterator = gekkota_list_head(&xudp->connectedClients);
+                iterator != gekkota_list_tail(&xudp->connectedClients);
+                iterator = gekkota_list_next(iterator))
         {
+            client = _gekkota_xudpclient_from_node(iterator, connectedNode);
+
             if (client->state != GEKKOTA_CLIENT_STATE_CONNECTED &&
                     client->state != GEKKOTA_CLIENT_STATE_DELAYING_DISCONNECT)
                 continue;
@@ -2719,13 +4552,94 @@ _gekkota_xudp_throttle_bandwidth(GekkotaXudp *restrict xudp)
 
     xudp->bandwidthThrottleEpoch = currentTime;
 
-    for (client = xudp->clients;
-            client < &xudp->clients[xudp->clientCount];
-            client++)
+    for (iterator = gekkota_list_head(&xudp->connectedClients);
+            iterator != gekkota_list_tail(&xudp->connectedClients);
+            iterator = gekkota_list_next(iterator))
     {
+        client = _gekkota_xudpclient_from_node(iterator, connectedNode);
+
         client->incomingDataTotal = 0;
         client->outgoingDataTotal = 0;
     }
 
     return 0;
 }
+
+static void_t
+_gekkota_xudp_update_retransmit_timer(GekkotaXudpClient *restrict client)
+{
+    GekkotaOutgoingMessage *outgoingMessage;
+
+    if (gekkota_list_is_empty(&client->sentReliableMessages))
+        return;
+
+    outgoingMessage = (GekkotaOutgoingMessage *)
+        gekkota_list_first(&client->sentReliableMessages);
+
+    client->nextTimeout = outgoingMessage->sentTime
+            + outgoingMessage->roundTripTimeout;
+
+    _gekkota_xudp_schedule_timer(client->xudp, client, client->nextTimeout);
+}
+
+/*
+ * Smooths the round trip time in microseconds, the same way as it is done
+ * in milliseconds otherwise, and rounds the millisecond estimates up from
+ * it, so that sub-millisecond links do not end up with null retransmission
+ * timeouts. Only the last transmission of the acknowledged message gives a
+ * precise sample; if the acknowledgement echoes an earlier one, the sample
+ * in milliseconds is used instead. Returns the sample in milliseconds,
+ * rounded up.
+ */
+static uint32_t
+_gekkota_xudp_update_round_trip_time_us(
+        const GekkotaXudp *restrict xudp,
+        GekkotaXudpClient *restrict client,
+        uint16_t sequenceNumber,
+        uint8_t channelId,
+        uint16_t sentTime,
+        uint32_t roundTripTime)
+{
+    GekkotaOutgoingMessage *outgoingMessage;
+    uint64_t sample = (uint64_t) roundTripTime * 1000;
+    uint32_t roundTripTimeUs;
+
+    if ((outgoingMessage = _gekkota_xudpclient_find_sent_reliable_message(
+            client, sequenceNumber, channelId)) != NULL &&
+            (uint16_t) outgoingMessage->sentTime == sentTime &&
+            xudp->receivedTimeUs >= outgoingMessage->sentTimeUs)
+        sample = xudp->receivedTimeUs - outgoingMessage->sentTimeUs;
+
+    roundTripTimeUs = (uint32_t) gekkota_utils_min(sample, (uint64_t) UINT32_MAX);
+
+    client->roundTripTimeVarianceUs -= client->roundTripTimeVarianceUs / 4;
+
+    if (roundTripTimeUs >= client->roundTripTimeUs)
+    {
+        client->roundTripTimeUs += (roundTripTimeUs - client->roundTripTimeUs) / 8;
+        client->roundTripTimeVarianceUs += (roundTripTimeUs - client->roundTripTimeUs) / 4;
+    }
+    else
+    {
+        client->roundTripTimeUs -= (client->roundTripTimeUs - roundTripTimeUs) / 8;
+        client->roundTripTimeVarianceUs += (client->roundTripTimeUs - roundTripTimeUs) / 4;
+    }
+
+    client->roundTripTime = (uint32_t) (((uint64_t) client->roundTripTimeUs + 999) / 1000);
+    client->roundTripTimeVariance =
+        (uint32_t) (((uint64_t) client->roundTripTimeVarianceUs + 999) / 1000);
+
+    return (uint32_t) ((sample + 999) / 1000);
+}
+
+static size_t
+_gekkota_xudp_write_varint(byte_t *restrict data, uint32_t value)
+{
+    size_t length = 1;
+
+    for (; value >= 0x80; value >>= 7, length++)
+        *data++ = (byte_t) (value | 0x80);
+
+    *data = (byte_t) value;
+    return length;
+}
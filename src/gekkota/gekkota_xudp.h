@@ -13,6 +13,7 @@
 #include "gekkota/gekkota_event.h"
 #include "gekkota/gekkota_ipendpoint.h"
 #include "gekkota/gekkota_lzf.h"
+#include "gekkota/gekkota_memory.h"
 #include "gekkota/gekkota_packet.h"
 #include "gekkota/gekkota_socket.h"
 #include "gekkota/gekkota_types.h"
@@ -20,6 +21,29 @@
 
 typedef struct _GekkotaXudp GekkotaXudp;
 
+/*
+ * Options selected when an XUDP host is created. With
+ * GEKKOTA_XUDP_OPTION_IO_URING, datagrams are sent and received through
+ * io_uring where the platform supports it, and through plain system calls
+ * otherwise. With GEKKOTA_XUDP_OPTION_COALESCING, the kernel may hand over
+ * runs of datagrams from the same peer at once, at the cost of 64 KiB
+ * receive buffers; it is ignored together with io_uring. With
+ * GEKKOTA_XUDP_OPTION_PRECISE_ROUND_TRIP_TIME, round trip times are
+ * measured in microseconds, so that links faster than a millisecond are
+ * not estimated at 0, at the cost of reading the clock more often. With
+ * GEKKOTA_XUDP_OPTION_RECEIVE_TIMESTAMPS, acknowledgements are timed from
+ * when the kernel received them rather than from when they are processed,
+ * where the platform supports it.
+ */
+typedef enum
+{
+    GEKKOTA_XUDP_OPTION_NONE                    = 0,
+    GEKKOTA_XUDP_OPTION_IO_URING                = (1 << 0),
+    GEKKOTA_XUDP_OPTION_COALESCING              = (1 << 1),
+    GEKKOTA_XUDP_OPTION_PRECISE_ROUND_TRIP_TIME = (1 << 2),
+    GEKKOTA_XUDP_OPTION_RECEIVE_TIMESTAMPS      = (1 << 3)
+} GekkotaXudpOption;
+
 #define gekkota_xudp_new() \
     (gekkota_xudp_new_5(NULL, 0))
 
@@ -44,6 +68,12 @@ gekkota_xudp_new_6(
         uint16_t port,
         uint16_t maxClient);
 
+GEKKOTA_API GekkotaXudp *
+gekkota_xudp_new_7(
+        GekkotaIPEndPoint *localEndPoint,
+        uint16_t maxClient,
+        GekkotaXudpOption options);
+
 GEKKOTA_API int32_t
 gekkota_xudp_destroy(GekkotaXudp *xudp);
 
@@ -62,6 +92,42 @@ gekkota_xudp_get_outgoing_bandwidth(const GekkotaXudp *xudp);
 GEKKOTA_API int32_t
 gekkota_xudp_set_outgoing_bandwidth(GekkotaXudp *restrict xudp, uint32_t bandwidth);
 
+/*
+ * Memory limits cap the bytes of packet data pinned in each direction by
+ * queued outgoing messages and by received messages not yet delivered,
+ * either in reorder or reassembly buffers; 0 means no limit. Received
+ * messages are charged for the whole receive buffer they keep alive plus
+ * their own bookkeeping. Sending beyond a limit fails with
+ * GEKKOTA_ERROR_NO_BUFFER_SPACE_AVAILABLE, while messages received beyond
+ * a limit are dropped.
+ */
+GEKKOTA_API uint32_t
+gekkota_xudp_get_memory_limit(const GekkotaXudp *xudp);
+
+GEKKOTA_API int32_t
+gekkota_xudp_set_memory_limit(GekkotaXudp *restrict xudp, uint32_t limit);
+
+GEKKOTA_API uint32_t
+gekkota_xudp_get_client_memory_limit(const GekkotaXudp *xudp);
+
+GEKKOTA_API int32_t
+gekkota_xudp_set_client_memory_limit(GekkotaXudp *restrict xudp, uint32_t limit);
+
+GEKKOTA_API uint32_t
+gekkota_xudp_get_memory_usage(const GekkotaXudp *xudp);
+
+GEKKOTA_API int32_t
+gekkota_xudp_get_send_batch_size(const GekkotaXudp *xudp);
+
+GEKKOTA_API int32_t
+gekkota_xudp_set_send_batch_size(GekkotaXudp *restrict xudp, uint16_t batchSize);
+
+GEKKOTA_API int32_t
+gekkota_xudp_get_next_timeout(const GekkotaXudp *xudp);
+
+GEKKOTA_API GekkotaMemoryArena *
+gekkota_xudp_get_arena(const GekkotaXudp *xudp);
+
 GEKKOTA_API GekkotaSocket *
 gekkota_xudp_get_socket(const GekkotaXudp *xudp);
 
@@ -122,6 +188,13 @@ gekkota_xudp_flush(GekkotaXudp *xudp);
 GEKKOTA_API int32_t
 gekkota_xudp_poll(GekkotaXudp *xudp, GekkotaEvent **event, int32_t timeout);
 
+GEKKOTA_API int32_t
+gekkota_xudp_poll_batch(
+        GekkotaXudp *xudp,
+        GekkotaEvent *events,
+        size_t capacity,
+        int32_t timeout);
+
 #if defined (GEKKOTA_BUILDING_LIB) || defined (GEKKOTA_BUILDING_STATIC_LIB)
 #include "gekkota_xudp_internal.h"
 #endif /* GEKKOTA_BUILDING_LIB || GEKKOTA_BUILDING_STATIC_LIB */
@@ -12,12 +12,15 @@
 
 #include "gekkota/gekkota_buffer.h"
 #include "gekkota/gekkota_ipendpoint.h"
+#include "gekkota/gekkota_list.h"
 #include "gekkota/gekkota_socket.h"
 #include "gekkota/gekkota_types.h"
 #include "gekkota/gekkota_xudpclient.h"
 
 #define GEKKOTA_XUDP_ID                             "XUDP"
-#define GEKKOTA_XUDP_VERSION                        1
+#define GEKKOTA_XUDP_VERSION                        2
+#define GEKKOTA_XUDP_PACKED_VERSION                 2       /* first version */
+                                                            /* without padding */
 #define GEKKOTA_XUDP_MIN_MTU                        576
 #define GEKKOTA_XUDP_MAX_MTU                        4096
 #define GEKKOTA_XUDP_DEFAULT_MTU                    1400
@@ -28,6 +31,19 @@
 #define GEKKOTA_XUDP_DEFAULT_CLIENT_COUNT           16
 #define GEKKOTA_XUDP_DEFAULT_POLL_TIMEOUT           1000
 #define GEKKOTA_XUDP_BANDWIDTH_THROTTLE_INTERVAL    1000
+#define GEKKOTA_XUDP_DEFAULT_SEND_BATCH_SIZE        32
+#define GEKKOTA_XUDP_MAX_SEND_BATCH_SIZE            256
+#define GEKKOTA_XUDP_DEFAULT_MEMORY_LIMIT           (256 * 1024 * 1024)
+#define GEKKOTA_XUDP_DEFAULT_CLIENT_MEMORY_LIMIT    (16 * 1024 * 1024)
+#define GEKKOTA_XUDP_RECEIVE_RING_SIZE              32
+#define GEKKOTA_XUDP_MAX_SLICE_OVERHEAD             4       /* max ratio of */
+                                                            /* a receive buffer */
+                                                            /* to the data */
+                                                            /* sliced from it */
+#define GEKKOTA_XUDP_TIMER_WHEEL_LEVELS             3
+#define GEKKOTA_XUDP_TIMER_WHEEL_SLOT_BITS          8
+#define GEKKOTA_XUDP_TIMER_WHEEL_SLOTS              (1 << GEKKOTA_XUDP_TIMER_WHEEL_SLOT_BITS)
+#define GEKKOTA_XUDP_TIMER_WHEEL_MASK               (GEKKOTA_XUDP_TIMER_WHEEL_SLOTS - 1)
 
 #ifndef GEKKOTA_XUDP_MAX_BUFFERS
 #define GEKKOTA_XUDP_MAX_BUFFERS (1 + 2 * GEKKOTA_XUDP_MAX_MESSAGES)
@@ -48,7 +64,8 @@ typedef enum
     GEKKOTA_XUDP_MESSAGE_TYPE_UNSEQUENCED_DATA      = 0x0000000A,
     GEKKOTA_XUDP_MESSAGE_TYPE_DATA_FRAGMENT         = 0x0000000B,
     GEKKOTA_XUDP_MESSAGE_TYPE_CONFIGURE_BANDWIDTH   = 0x0000000C,
-    GEKKOTA_XUDP_MESSAGE_TYPE_CONFIGURE_THROTTLE    = 0x0000000D
+    GEKKOTA_XUDP_MESSAGE_TYPE_CONFIGURE_THROTTLE    = 0x0000000D,
+    GEKKOTA_XUDP_MESSAGE_TYPE_ACKNOWLEDGE_RANGE     = 0x0000000E
 } GekkotaXudpMessageType;
 
 typedef enum
@@ -65,9 +82,26 @@ typedef enum
     GEKKOTA_XUDP_MESSAGE_FLAG_ACKNOWLEDGE           = (1 << 0),
     GEKKOTA_XUDP_MESSAGE_FLAG_UNSEQUENCED           = (1 << 1),
     GEKKOTA_XUDP_MESSAGE_FLAG_COMPRESSED            = (1 << 2),
-    GEKKOTA_XUDP_MESSAGE_FLAG_ENCRYPTED             = (1 << 3)
+    GEKKOTA_XUDP_MESSAGE_FLAG_ENCRYPTED             = (1 << 3),
+    GEKKOTA_XUDP_MESSAGE_FLAG_ACKNOWLEDGE_RANGE     = (1 << 4), /* connect */
+                                                                /* only */
+    GEKKOTA_XUDP_MESSAGE_FLAG_COMPACT               = (1 << 5)  /* compact */
+                                                                /* encoding; */
+                                                                /* supported */
+                                                                /* on connect */
 } GekkotaXudpMessageFlag;
 
+/*
+ * Up to version 1, headers and messages are sent as laid out in memory by
+ * the compiler; since GEKKOTA_XUDP_PACKED_VERSION they are serialized field
+ * by field without padding. Multi-byte fields are in network byte order in
+ * both cases, and the version byte has the same offset in both layouts.
+ *
+ * Data messages flagged with GEKKOTA_XUDP_MESSAGE_FLAG_COMPACT encode their
+ * lengths and fragment fields as varints, and omit the fragment offset and
+ * the start sequence number, which the receiver derives.
+ */
+
 typedef struct _GekkotaXudpHeader
 {
     uint16_t                protocolId;
@@ -93,6 +127,16 @@ typedef struct _GekkotaXudpAcknowledgeMessage
     uint16_t                sentTime;
 } GekkotaXudpAcknowledgeMessage;
 
+typedef struct _GekkotaXudpAcknowledgeRangeMessage
+{
+    GekkotaXudpMessageHeader header;
+    uint16_t                sequenceNumber;
+    uint16_t                sentTime;
+    uint32_t                bitmap;                 /* bit n acknowledges */
+                                                    /* [sequenceNumber] + */
+                                                    /* n + 1 */
+} GekkotaXudpAcknowledgeRangeMessage;
+
 typedef struct _GekkotaXudpConnectMessage
 {
     GekkotaXudpMessageHeader header;
@@ -206,33 +250,99 @@ typedef union
     GekkotaXudpDataFragmentMessage          dataFragment;
     GekkotaXudpConfigureBandwidthMessage    configureBandwidth;
     GekkotaXudpConfigureThrottleMessage     configureThrottle;
+    GekkotaXudpAcknowledgeRangeMessage      acknowledgeRange;
 } GekkotaXudpMessage;
 
+typedef struct _GekkotaXudpDatagram
+{
+    GekkotaXudpClient       *client;
+    byte_t                  header[sizeof(GekkotaXudpHeader)];  /* encoded */
+    GekkotaXudpMessage      messages[GEKKOTA_XUDP_MAX_MESSAGES];    /* encoded */
+    GekkotaBuffer           buffers[GEKKOTA_XUDP_MAX_BUFFERS];
+    uint16_t                bufferCount;
+} GekkotaXudpDatagram;
+
 struct _GekkotaXudp
 {
+    GekkotaMemoryArena      *arena;                 /* arena current when */
+                                                    /* the instance was */
+                                                    /* created */
     uint16_t                protocolId;
     GekkotaSocket           *socket;
     uint32_t                currentTime;
+    uint64_t                currentTimeUs;          /* only maintained */
+                                                    /* with precise round */
+                                                    /* trip times */
+    bool_t                  preciseRoundTripTime;
+    bool_t                  receiveTimestamps;      /* whether the kernel */
+                                                    /* timestamps incoming */
+                                                    /* datagrams */
     uint32_t                incomingBandwidth;
     uint32_t                outgoingBandwidth;
     uint32_t                bandwidthThrottleEpoch;
     uint16_t                mtu;
     bool_t                  reconfigureBandwidth;
+    uint32_t                memoryLimit;            /* max bytes pinned by */
+                                                    /* all clients in each */
+                                                    /* direction, 0 = none */
+    uint32_t                clientMemoryLimit;      /* max bytes pinned by */
+                                                    /* one client in each */
+                                                    /* direction, 0 = none */
+    uint32_t                incomingMemory;         /* bytes of received */
+                                                    /* data not delivered */
+    uint32_t                outgoingMemory;         /* bytes of queued data */
+                                                    /* not acknowledged */
     GekkotaXudpClient       *clients;
     uint16_t                clientCount;
-    GekkotaXudpClient       *lastServicedClient;
+    GekkotaList             connectedClients;       /* clients not */
+                                                    /* disconnected */
+    GekkotaList             outgoingClients;        /* clients with pending */
+                                                    /* output */
+    GekkotaList             dispatchClients;        /* clients with pending */
+                                                    /* connect or disconnect */
+                                                    /* events */
+    GekkotaList             readyChannels;          /* channels with */
+                                                    /* deliverable messages */
+    uint32_t                timerWheelTime;         /* next millisecond to */
+                                                    /* expire */
+    uint32_t                timerCount;
+    GekkotaList             timerWheel[GEKKOTA_XUDP_TIMER_WHEEL_LEVELS][GEKKOTA_XUDP_TIMER_WHEEL_SLOTS];
     size_t                  packetSize;
     uint8_t                 headerFlags;
-    GekkotaXudpMessage      messages[GEKKOTA_XUDP_MAX_MESSAGES];
     uint16_t                messageCount;
-    GekkotaBuffer           buffers[GEKKOTA_XUDP_MAX_BUFFERS];
     uint16_t                bufferCount;
-    GekkotaIPEndPoint       *remoteEndPoint;
-    byte_t                  receivedData[GEKKOTA_XUDP_MAX_MTU];
+    size_t                  payloadHeadroom;        /* headroom usable in */
+                                                    /* front of the last */
+                                                    /* payload */
+    GekkotaXudpDatagram     *datagrams;
+    uint16_t                datagramCount;
+    uint16_t                sendBatchSize;
+    GekkotaSocketAddress    *remoteSocketAddress;
+    byte_t                  *receivedData;
     size_t                  receivedDataLength;
+    GekkotaPacket           *receivedPacket;    /* packet [receivedData] */
+                                                /* belongs to */
+    GekkotaDatagram         receivedDatagrams[GEKKOTA_XUDP_RECEIVE_RING_SIZE];
+    uint16_t                receivedDatagramCount;
+    uint16_t                receivedDatagramIndex;
+    size_t                  receivedSegmentOffset;  /* within coalesced */
+                                                    /* datagrams */
+    uint32_t                receivedTime;           /* arrival of */
+    uint64_t                receivedTimeUs;         /* [receivedData] */
+    uint32_t                receivedBatchTime;      /* clocks read as the */
+    uint64_t                receivedBatchTimeUs;    /* datagrams in */
+                                                    /* [receivedDatagrams] */
+                                                    /* were collected */
+    GekkotaSocketAddress    receivedSocketAddresses[GEKKOTA_XUDP_RECEIVE_RING_SIZE];
+    GekkotaBuffer           receiveBuffers[GEKKOTA_XUDP_RECEIVE_RING_SIZE];
+    GekkotaPacket           *receivePackets[GEKKOTA_XUDP_RECEIVE_RING_SIZE];
+    GekkotaPacketPool       *receivePool;
 };
 
 extern size_t
-_gekkota_xudp_message_size(GekkotaXudpMessageType messageType);
+_gekkota_xudp_header_size(uint8_t version);
+
+extern size_t
+_gekkota_xudp_message_size(GekkotaXudpMessageType messageType, uint8_t version);
 
 #endif /* !__GEKKOTA_XUDP_INTERNAL_H__ */
@@ -21,7 +21,7 @@
 static GekkotaPacket *
 _gekkota_xudpclient_deflate(
         GekkotaXudpClient *client,
-        const GekkotaPacket *packet);
+        GekkotaPacket *packet);
 
 static GekkotaPacket *
 _gekkota_xudpclient_inflate(
@@ -31,14 +31,24 @@ _gekkota_xudpclient_inflate(
 static GekkotaLZF *
 _gekkota_xudpclient_get_lzf(const GekkotaXudpClient *client);
 
-#define _gekkota_xudpclient_clear_message_queue(type_t, queue) \
+static GekkotaOutgoingMessage **
+_gekkota_xudpclient_get_sent_reliable_slot(
+        GekkotaXudpClient *restrict client,
+        uint16_t sequenceNumber,
+        uint8_t channelId,
+        uint32_t **overflow);
+
+#define _gekkota_xudpclient_clear_message_queue(type_t, client, queue, member, length) \
 { \
     type_t *message; \
     while (!gekkota_list_is_empty(queue)) \
     { \
         message = (type_t *) gekkota_list_remove(gekkota_list_head(queue)); \
         if (message->packet != NULL) \
+        { \
+            _gekkota_xudpclient_unpin_memory(client, member, length); \
             gekkota_packet_destroy(message->packet); \
+        } \
         gekkota_memory_free(message); \
     } \
 }
@@ -46,6 +56,7 @@ _gekkota_xudpclient_get_lzf(const GekkotaXudpClient *client);
 int32_t
 gekkota_xudpclient_destroy(GekkotaXudpClient *client)
 {
+    GekkotaMemoryArena *arena;
     GekkotaXudp *xudp;
 
     if (client == NULL)
@@ -54,6 +65,8 @@ gekkota_xudpclient_destroy(GekkotaXudpClient *client)
         return -1;
     }
 
+    arena = gekkota_memory_set_arena(client->xudp->arena);
+
     /*
      * Dispose of the remote endpoint.
      */
@@ -91,32 +104,46 @@ gekkota_xudpclient_destroy(GekkotaXudpClient *client)
      */
     _gekkota_xudpclient_reset(client);
 
+    gekkota_memory_set_arena(arena);
     return 0;
 }
 
 int32_t
 gekkota_xudpclient_close_1(GekkotaXudpClient *client, GekkotaCloseMode closeMode)
 {
+    GekkotaMemoryArena *arena;
+    int32_t rc;
+
     if (client == NULL)
     {
         errno = GEKKOTA_ERROR_NULL_ARGUMENT;
         return -1;
     }
 
+    arena = gekkota_memory_set_arena(client->xudp->arena);
+
     switch (closeMode)
     {
         case GEKKOTA_CLOSE_MODE_GRACEFUL:
-            return _gekkota_xudpclient_close_gracefully(client);
+            rc = _gekkota_xudpclient_close_gracefully(client);
+            break;
 
         case GEKKOTA_CLOSE_MODE_DELAYED:
-            return _gekkota_xudpclient_close_later(client);
+            rc = _gekkota_xudpclient_close_later(client);
+            break;
 
         case GEKKOTA_CLOSE_MODE_IMMEDIATE:
-            return _gekkota_xudpclient_close_now(client);
+            rc = _gekkota_xudpclient_close_now(client);
+            break;
+
+        default:
+            errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
+            rc = -1;
+            break;
     }
 
-    errno = GEKKOTA_ERROR_ARGUMENT_NOT_VALID;
-    return -1;
+    gekkota_memory_set_arena(arena);
+    return rc;
 }
 
 int32_t
@@ -167,6 +194,19 @@ gekkota_xudpclient_get_remote_endpoint(const GekkotaXudpClient *client)
     return client->remoteEndPoint;
 }
 
+uint32_t
+gekkota_xudpclient_get_memory_usage(const GekkotaXudpClient *client)
+{
+    if (client == NULL)
+    {
+        errno = GEKKOTA_ERROR_NULL_ARGUMENT;
+        return 0;
+    }
+
+    errno = GEKKOTA_ERROR_SUCCESS;
+    return client->incomingMemory + client->outgoingMemory;
+}
+
 GekkotaClientState
 gekkota_xudpclient_get_state(const GekkotaXudpClient *client)
 {
@@ -211,7 +251,9 @@ gekkota_xudpclient_set_throttle_configuration(
         uint32_t acceleration,
         uint32_t deceleration)
 {
+    GekkotaMemoryArena *arena;
     GekkotaXudpMessage message;
+    int32_t rc;
 
     if (client == NULL)
     {
@@ -235,8 +277,12 @@ gekkota_xudpclient_set_throttle_configuration(
     message.configureThrottle.throttleAcceleration = gekkota_host_to_net_32(acceleration);
     message.configureThrottle.throttleDeceleration = gekkota_host_to_net_32(deceleration);
 
-    return _gekkota_xudpclient_queue_outgoing_message(
+    arena = gekkota_memory_set_arena(client->xudp->arena);
+    rc = _gekkota_xudpclient_queue_outgoing_message(
             client, &message, NULL, 0, 0, NULL);
+    gekkota_memory_set_arena(arena);
+
+    return rc;
 }
 
 bool_t
@@ -258,9 +304,9 @@ gekkota_xudpclient_receive(
         GekkotaPacket **packet,
         GekkotaIPEndPoint **remoteEndPoint)
 {
-    GekkotaChannel *channel;
-    GekkotaIncomingMessage *incomingMessage = NULL;
-
+    GekkotaMemoryArena *arena;
+    GekkotaSocketAddress remoteSocketAddress;
+    int32_t rc;
 
     if (client == NULL || packet == NULL)
     {
@@ -274,75 +320,26 @@ gekkota_xudpclient_receive(
         return -1;
     }
 
-    channel = &client->channels[channelId];
-
-    /*
-     * Check for unreliable messages first.
-     */
-    if (!gekkota_list_is_empty(&channel->incomingUnreliableMessages))
-    {
-        incomingMessage = (GekkotaIncomingMessage *)
-            gekkota_list_first(&channel->incomingUnreliableMessages);
-
-        if (incomingMessage->message.header.messageType == GEKKOTA_XUDP_MESSAGE_TYPE_UNRELIABLE_DATA)
-        {
-            if (incomingMessage->reliableSequenceNumber != channel->incomingReliableSequenceNumber)
-                incomingMessage = NULL;
-            else
-                channel->incomingUnreliableSequenceNumber = incomingMessage->unreliableSequenceNumber;
-        }
-    }
-
-    /*
-     * If there are no unreliable messages and the client is not member of a
-     * multicast group, then check for reliable messages.
-     */
-    if (incomingMessage == NULL && !client->isMulticastGroupMember &&
-            !gekkota_list_is_empty(&channel->incomingReliableMessages))
-    {
-        incomingMessage = (GekkotaIncomingMessage *)
-            gekkota_list_first(&channel->incomingReliableMessages);
-
-        if (incomingMessage->fragmentsRemaining > 0 ||
-                incomingMessage->reliableSequenceNumber !=
-                (uint16_t) (channel->incomingReliableSequenceNumber + 1))
-            /*
-             * Still waiting for data fragments...
-             */
-            return 0;
-
-        channel->incomingReliableSequenceNumber = incomingMessage->reliableSequenceNumber;
-
-        if (incomingMessage->fragmentCount > 0)
-            channel->incomingReliableSequenceNumber
-                += (uint16_t) incomingMessage->fragmentCount - 1;
-    }
-
-    if (incomingMessage == NULL)
-        return 0;
-
-    gekkota_list_remove(&incomingMessage->listNode);
-    *packet = incomingMessage->packet;
-
-    if (remoteEndPoint != NULL)
-        *remoteEndPoint = incomingMessage->remoteEndPoint;
-    else
-        gekkota_ipendpoint_destroy(incomingMessage->remoteEndPoint);
+    arena = gekkota_memory_set_arena(client->xudp->arena);
+    rc = _gekkota_xudpclient_receive(
+            client, channelId, packet,
+            remoteEndPoint != NULL ? &remoteSocketAddress : NULL);
+    gekkota_memory_set_arena(arena);
 
     /*
-     * If the GEKKOTA_PACKET_FLAG_COMPRESSED flag is on, inflate the packet.
+     * The remote endpoint is handed to the caller, so allocate it from
+     * the caller's arena rather than from the arena of the client.
      */
-    if (gekkota_bit_isset(((GekkotaPacket *) *packet)->flags, GEKKOTA_PACKET_FLAG_COMPRESSED))
-    {
-        GekkotaPacket *inflated;
+    if (rc == 1 && remoteEndPoint != NULL)
+        *remoteEndPoint = gekkota_ipendpoint_new_2(&remoteSocketAddress);
 
-        inflated = _gekkota_xudpclient_inflate(client, *packet);
-        gekkota_packet_destroy(*packet);
-        *packet = inflated;
-    }
+        /*
+         * As in [gekkota_socket_receive], the packet is returned even if
+         * [gekkota_ipendpoint_new_2] fails; it is up to the caller to check
+         * whether or not [*remoteEndPoint] is NULL
+         */
 
-    gekkota_memory_free(incomingMessage);
-    return *packet != NULL ? 1 : -1;
+    return rc;
 }
     
 int32_t
@@ -352,6 +349,7 @@ gekkota_xudpclient_send(
         GekkotaPacket *packet)
 {
     int32_t rc = 0;
+    GekkotaMemoryArena *arena;
     GekkotaChannel *channel;
     GekkotaXudpMessage message;
     uint16_t fragmentLength;
@@ -387,10 +385,14 @@ gekkota_xudpclient_send(
         return -1;
     }
 
+    arena = gekkota_memory_set_arena(client->xudp->arena);
+
     /*
      * Reset message flags.
      */
-    message.header.flags = 0;
+    message.header.flags = client->compactHeaders
+        ? GEKKOTA_XUDP_MESSAGE_FLAG_COMPACT
+        : 0;
 
     /*
      * If the GEKKOTA_PACKET_FLAG_COMPRESSED flag is on, deflate the packet.
@@ -400,7 +402,10 @@ gekkota_xudpclient_send(
         GekkotaPacket *deflated;
 
         if ((deflated = _gekkota_xudpclient_deflate(client, packet)) == NULL)
+        {
+            gekkota_memory_set_arena(arena);
             return -1;
+        }
 
         if (deflated->data.length >= packet->data.length)
         {
@@ -414,11 +419,24 @@ gekkota_xudpclient_send(
         }
     }
 
+    /*
+     * Push back on the application rather than letting a slow client pin
+     * more memory than allowed.
+     */
+    if (!_gekkota_xudpclient_fits_memory_limit(client, outgoingMemory, packet->data.length))
+    {
+        errno = GEKKOTA_ERROR_NO_BUFFER_SPACE_AVAILABLE;
+        rc = -1;
+        goto gekkota_xudpclient_send_exit;
+    }
+
     channel = &client->channels[channelId];
 
     fragmentLength = client->mtu
-        - sizeof(GekkotaXudpHeader)
-        - sizeof(GekkotaXudpDataFragmentMessage);
+        - _gekkota_xudp_header_size(client->protocolVersion)
+        - _gekkota_xudp_message_size(
+                GEKKOTA_XUDP_MESSAGE_TYPE_DATA_FRAGMENT,
+                client->protocolVersion);
 
     if (packet->data.length > fragmentLength)
     {
@@ -440,9 +458,18 @@ gekkota_xudpclient_send(
 
         startSequenceNumber = gekkota_host_to_net_16(
                 channel->outgoingReliableSequenceNumber + 1);
-        fragmentCount = gekkota_host_to_net_32(
-                (uint32_t) (packet->data.length + fragmentLength - 1)
-                / fragmentLength);
+        fragmentCount = (uint32_t) (packet->data.length + fragmentLength - 1)
+                / fragmentLength;
+
+        if (client->compactHeaders)
+            /*
+             * Compact fragments carry no offset: spread the packet evenly,
+             * so that the offset can be derived from the fragment number.
+             */
+            fragmentLength = (uint16_t) ((packet->data.length + fragmentCount - 1)
+                / fragmentCount);
+
+        fragmentCount = gekkota_host_to_net_32(fragmentCount);
 
         gekkota_bit_set(packet->flags, GEKKOTA_PACKET_FLAG_RELIABLE);
         gekkota_bit_unset(packet->flags, GEKKOTA_PACKET_FLAG_UNSEQUENCED);
@@ -483,7 +510,10 @@ gekkota_xudpclient_send(
                         gekkota_list_remove(
                                 gekkota_list_tail(&client->outgoingReliableMessages));
 
+                    _gekkota_xudpclient_unpin_memory(
+                            client, outgoingMemory, outgoingMessage->fragmentLength);
                     gekkota_packet_destroy(outgoingMessage->packet);
+                    gekkota_memory_free(outgoingMessage);
                     --fragmentNumber;
                 }
 
@@ -529,13 +559,16 @@ gekkota_xudpclient_send_exit:
     if (gekkota_bit_isset(packet->flags, GEKKOTA_PACKET_FLAG_COMPRESSED))
         gekkota_packet_destroy(packet);
 
+    gekkota_memory_set_arena(arena);
     return rc;
 }
 
 int32_t
 gekkota_xudpclient_ping(GekkotaXudpClient *client)
 {
+    GekkotaMemoryArena *arena;
     GekkotaXudpMessage message;
+    int32_t rc;
 
     if (client == NULL)
     {
@@ -561,9 +594,13 @@ gekkota_xudpclient_ping(GekkotaXudpClient *client)
     message.header.flags = GEKKOTA_XUDP_MESSAGE_FLAG_ACKNOWLEDGE;
 
     /* no message body */
-   
-    return _gekkota_xudpclient_queue_outgoing_message(
+
+    arena = gekkota_memory_set_arena(client->xudp->arena);
+    rc = _gekkota_xudpclient_queue_outgoing_message(
             client, &message, NULL, 0, 0, NULL);
+    gekkota_memory_set_arena(arena);
+
+    return rc;
 }
 
 int32_t
@@ -615,7 +652,7 @@ _gekkota_xudpclient_close_gracefully(GekkotaXudpClient *client)
         if (client->state == GEKKOTA_CLIENT_STATE_CONNECTED ||
                 client->state == GEKKOTA_CLIENT_STATE_DELAYING_DISCONNECT)
         {
-            client->state = GEKKOTA_CLIENT_STATE_DISCONNECTING;
+            _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_DISCONNECTING);
             return 0;
         }
     }
@@ -639,7 +676,7 @@ _gekkota_xudpclient_close_later(GekkotaXudpClient *client)
             !(gekkota_list_is_empty(&client->outgoingReliableMessages) &&
                 gekkota_list_is_empty(&client->outgoingUnreliableMessages) &&
                 gekkota_list_is_empty(&client->sentReliableMessages)))
-        client->state = GEKKOTA_CLIENT_STATE_DELAYING_DISCONNECT;
+        _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_DELAYING_DISCONNECT);
     else
         return _gekkota_xudpclient_close_gracefully(client);
 
@@ -700,10 +737,14 @@ _gekkota_xudpclient_clear_message_queues(GekkotaXudpClient *client)
     /*
      * Dispose of outgoing messages.
      */
-    _gekkota_xudpclient_clear_outgoing_message_queue(&client->sentReliableMessages);
-    _gekkota_xudpclient_clear_outgoing_message_queue(&client->sentUnreliableMessages);
-    _gekkota_xudpclient_clear_outgoing_message_queue(&client->outgoingReliableMessages);
-    _gekkota_xudpclient_clear_outgoing_message_queue(&client->outgoingUnreliableMessages);
+    _gekkota_xudpclient_clear_outgoing_message_queue(client, &client->sentReliableMessages);
+    _gekkota_xudpclient_clear_outgoing_message_queue(client, &client->sentUnreliableMessages);
+
+    memset(client->sentControlMessages, 0x00, sizeof(client->sentControlMessages));
+    client->sentControlOverflow = 0;
+
+    _gekkota_xudpclient_clear_outgoing_message_queue(client, &client->outgoingReliableMessages);
+    _gekkota_xudpclient_clear_outgoing_message_queue(client, &client->outgoingUnreliableMessages);
 
     /*
      * Dispose of incoming messages.
@@ -714,8 +755,11 @@ _gekkota_xudpclient_clear_message_queues(GekkotaXudpClient *client)
                 channel < &client->channels[client->channelCount];
                 channel++)
         {
-            _gekkota_xudpclient_clear_incoming_message_queue(&channel->incomingReliableMessages);
-            _gekkota_xudpclient_clear_incoming_message_queue(&channel->incomingUnreliableMessages);
+            if (channel->readyNode.next != NULL)
+                gekkota_list_remove(&channel->readyNode);
+
+            _gekkota_xudpclient_clear_incoming_message_queue(client, &channel->incomingReliableMessages);
+            _gekkota_xudpclient_clear_incoming_message_queue(client, &channel->incomingUnreliableMessages);
         }
 
         gekkota_memory_free(client->channels);
@@ -726,15 +770,105 @@ _gekkota_xudpclient_clear_message_queues(GekkotaXudpClient *client)
 }
 
 void_t
-_gekkota_xudpclient_clear_incoming_message_queue(GekkotaList *queue)
+_gekkota_xudpclient_clear_incoming_message_queue(
+        GekkotaXudpClient *restrict client,
+        GekkotaList *queue)
+{
+    _gekkota_xudpclient_clear_message_queue(GekkotaIncomingMessage,
+            client, queue, incomingMemory, message->memoryCharge);
+}
+
+void_t
+_gekkota_xudpclient_clear_outgoing_message_queue(
+        GekkotaXudpClient *restrict client,
+        GekkotaList *queue)
+{
+    _gekkota_xudpclient_clear_message_queue(GekkotaOutgoingMessage,
+            client, queue, outgoingMemory, message->fragmentLength);
+}
+
+void_t
+_gekkota_xudpclient_add_sent_reliable_message(
+        GekkotaXudpClient *restrict client,
+        GekkotaOutgoingMessage *outgoingMessage)
+{
+    GekkotaOutgoingMessage **slot;
+    uint32_t *overflow;
+
+    slot = _gekkota_xudpclient_get_sent_reliable_slot(
+            client,
+            outgoingMessage->reliableSequenceNumber,
+            outgoingMessage->message.header.channelId,
+            &overflow);
+
+    gekkota_list_add(&client->sentReliableMessages, outgoingMessage);
+
+    if (*slot == NULL)
+        *slot = outgoingMessage;
+    else
+        ++*overflow;
+}
+
+GekkotaOutgoingMessage *
+_gekkota_xudpclient_find_sent_reliable_message(
+        GekkotaXudpClient *restrict client,
+        uint16_t sequenceNumber,
+        uint8_t channelId)
 {
-    _gekkota_xudpclient_clear_message_queue(GekkotaIncomingMessage, queue);
+    GekkotaOutgoingMessage **slot;
+    GekkotaOutgoingMessage *outgoingMessage;
+    GekkotaListIterator iterator;
+    uint32_t *overflow;
+
+    if (channelId != 0xFF && channelId >= client->channelCount)
+        return NULL;
+
+    slot = _gekkota_xudpclient_get_sent_reliable_slot(
+            client, sequenceNumber, channelId, &overflow);
+
+    if (*slot != NULL && (*slot)->reliableSequenceNumber == sequenceNumber)
+        return *slot;
+
+    if (*overflow == 0)
+        return NULL;
+
+    /*
+     * More messages than slots are in flight; fall back to a linear scan.
+     */
+    for (iterator = gekkota_list_head(&client->sentReliableMessages);
+            iterator != gekkota_list_tail(&client->sentReliableMessages);
+            iterator = gekkota_list_next(iterator))
+    {
+        outgoingMessage = (GekkotaOutgoingMessage *) iterator;
+
+        if (outgoingMessage->reliableSequenceNumber == sequenceNumber &&
+                outgoingMessage->message.header.channelId == channelId)
+            return outgoingMessage;
+    }
+
+    return NULL;
 }
 
 void_t
-_gekkota_xudpclient_clear_outgoing_message_queue(GekkotaList *queue)
+_gekkota_xudpclient_remove_sent_reliable_message(
+        GekkotaXudpClient *restrict client,
+        GekkotaOutgoingMessage *outgoingMessage)
 {
-    _gekkota_xudpclient_clear_message_queue(GekkotaOutgoingMessage, queue);
+    GekkotaOutgoingMessage **slot;
+    uint32_t *overflow;
+
+    slot = _gekkota_xudpclient_get_sent_reliable_slot(
+            client,
+            outgoingMessage->reliableSequenceNumber,
+            outgoingMessage->message.header.channelId,
+            &overflow);
+
+    gekkota_list_remove(&outgoingMessage->listNode);
+
+    if (*slot == outgoingMessage)
+        *slot = NULL;
+    else
+        --*overflow;
 }
 
 int32_t
@@ -747,15 +881,17 @@ _gekkota_xudpclient_queue_acknowledgement(
     GekkotaAcknowledgement *newAcknowledgement;
 
     if ((newAcknowledgement = gekkota_memory_alloc(
-            sizeof(GekkotaAcknowledgement), FALSE)) == NULL)
+            sizeof(GekkotaAcknowledgement), TRUE)) == NULL)
         return -1;
 
-    client->outgoingDataTotal += sizeof(GekkotaXudpAcknowledgeMessage);
+    client->outgoingDataTotal += (uint32_t) _gekkota_xudp_message_size(
+            GEKKOTA_XUDP_MESSAGE_TYPE_ACKNOWLEDGE, client->protocolVersion);
 
     newAcknowledgement->sentTime = sentTime;
     newAcknowledgement->message = *message;
 
     gekkota_list_add(&client->acknowledgements, newAcknowledgement);
+    _gekkota_xudpclient_schedule_output(client);
 
     if (acknowledgement != NULL)
         *acknowledgement = newAcknowledgement;
@@ -769,75 +905,62 @@ _gekkota_xudpclient_queue_incoming_message(
         const GekkotaXudpMessage *message,
         GekkotaPacket *packet,
         uint32_t fragmentCount,
-        GekkotaIPEndPoint *remoteEndPoint,
+        const GekkotaSocketAddress *remoteSocketAddress,
         GekkotaIncomingMessage **incomingMessage)
 {
     GekkotaChannel *channel;
     GekkotaIncomingMessage *newIncomingMessage;
+    GekkotaIncomingMessage **slot = NULL;
     GekkotaListIterator iterator;
     uint32_t unreliableSequenceNumber = 0, reliableSequenceNumber = 0;
+    uint32_t memoryCharge = 0;
+    uint16_t distance = 0;
     size_t memSize;
 
     channel = &client->channels[message->header.channelId];
 
     if (client->state == GEKKOTA_CLIENT_STATE_DELAYING_DISCONNECT)
-        return -1;
+        return 0;
 
     if (message->header.messageType != GEKKOTA_XUDP_MESSAGE_TYPE_UNSEQUENCED_DATA)
     {
         reliableSequenceNumber = message->header.sequenceNumber;
 
         /*
-         * If the sequence numbers received so far are all at the high end of the
-         * 16-bit range, but a just received sequence number is at the low end,
-         * assume it was a sequence number that wrapped around back to the low end
-         * again and treat it as a number greater than 2e16, being values greater
-         * than or equal to 0xF000 the high end, and values less than 0x1000 the
-         * low end.
-         */
-
-        if (channel->incomingReliableSequenceNumber >= 0xF000 &&
-                reliableSequenceNumber < 0x1000)
-            reliableSequenceNumber += 0x10000;
-
-        /*
-         * Check if even after adjustment the sequence number is less than the
-         * ones already received; it is almost impossible to have anywhere near
-         * to 2e16 packets in flight at any given time.
+         * Compute the distance from the last delivered reliable sequence
+         * number in 16-bit serial arithmetic, so that wrap-around needs no
+         * special treatment; distances in the upper half of the range refer
+         * to messages that have already been delivered.
          */
+        distance = (uint16_t) (reliableSequenceNumber - channel->incomingReliableSequenceNumber);
 
-        if (reliableSequenceNumber < channel->incomingReliableSequenceNumber ||
-                (channel->incomingReliableSequenceNumber < 0x1000 &&
-                (reliableSequenceNumber & 0x0000FFFF) >= 0xF000))
-            return -1;
+        if (distance >= 0x8000)
+            return message->header.messageType ==
+                GEKKOTA_XUDP_MESSAGE_TYPE_UNRELIABLE_DATA ? 0 : 1;
     }
 
     switch (message->header.messageType)
     {
         case GEKKOTA_XUDP_MESSAGE_TYPE_DATA_FRAGMENT:
         case GEKKOTA_XUDP_MESSAGE_TYPE_RELIABLE_DATA:
-            if (reliableSequenceNumber == channel->incomingReliableSequenceNumber)
-                return -1;
+            if (distance == 0)
+                return 1;   /* already delivered */
 
-            for (iterator = gekkota_list_previous(
-                        gekkota_list_tail(&channel->incomingReliableMessages));
-                    iterator != gekkota_list_tail(&channel->incomingReliableMessages);
-                    iterator = gekkota_list_previous(iterator))
-            {
-                newIncomingMessage = (GekkotaIncomingMessage *) iterator;
+            /*
+             * Messages beyond the reorder window are dropped without being
+             * acknowledged; the remote client retransmits them later.
+             */
+            if (distance > GEKKOTA_XUDP_CLIENT_REORDER_WINDOW_SIZE)
+                return 0;
 
-                if (reliableSequenceNumber >= 0x10000 &&
-                        newIncomingMessage->reliableSequenceNumber < 0xF000)
-                    reliableSequenceNumber -= 0x10000;
+            slot = &channel->incomingReliableWindow[
+                reliableSequenceNumber & (GEKKOTA_XUDP_CLIENT_REORDER_WINDOW_SIZE - 1)];
 
-                if (newIncomingMessage->reliableSequenceNumber <= reliableSequenceNumber)
-                {
-                    if (newIncomingMessage->reliableSequenceNumber < reliableSequenceNumber)
-                        break;
+            if (*slot != NULL)
+                return 1;   /* duplicate */
 
-                    return -1;
-                }
-            }
+            iterator = gekkota_list_previous(
+                    gekkota_list_tail(&channel->incomingReliableMessages));
             break;
 
         case GEKKOTA_XUDP_MESSAGE_TYPE_UNRELIABLE_DATA:
@@ -851,7 +974,7 @@ _gekkota_xudpclient_queue_incoming_message(
             if (unreliableSequenceNumber <= channel->incomingUnreliableSequenceNumber ||
                     (channel->incomingUnreliableSequenceNumber < 0x1000 &&
                     (unreliableSequenceNumber & 0xFFFF) >= 0xF000))
-                return -1;
+                return 0;
 
             for (iterator = gekkota_list_previous(
                         gekkota_list_tail(&channel->incomingUnreliableMessages));
@@ -873,7 +996,7 @@ _gekkota_xudpclient_queue_incoming_message(
                     if (newIncomingMessage->unreliableSequenceNumber < unreliableSequenceNumber)
                         break;
 
-                    return -1;
+                    return 0;
                 }
             }
             break;
@@ -883,7 +1006,20 @@ _gekkota_xudpclient_queue_incoming_message(
             break;
 
         default:
-            return -1;
+            return 0;
+    }
+
+    /*
+     * Drop messages that would make the client pin more memory than
+     * allowed; reliable ones are not acknowledged, so the remote client
+     * retransmits them once the application has caught up.
+     */
+    if (packet != NULL)
+    {
+        memoryCharge = _gekkota_xudpclient_incoming_memory_charge(packet);
+
+        if (!_gekkota_xudpclient_fits_memory_limit(client, incomingMemory, memoryCharge))
+            return 0;
     }
 
     memSize = sizeof(GekkotaIncomingMessage);
@@ -901,16 +1037,47 @@ _gekkota_xudpclient_queue_incoming_message(
     newIncomingMessage->unreliableSequenceNumber = (uint16_t) (unreliableSequenceNumber & 0xFFFF);
     newIncomingMessage->message = *message;
     newIncomingMessage->packet = gekkota_packet_new_0(packet, FALSE);
+    newIncomingMessage->memoryCharge = memoryCharge;
     newIncomingMessage->fragmentCount = fragmentCount;
     newIncomingMessage->fragmentsRemaining = fragmentCount;
-    newIncomingMessage->remoteEndPoint = gekkota_ipendpoint_new_0(remoteEndPoint, FALSE);
+    newIncomingMessage->remoteSocketAddress = *remoteSocketAddress;
+
+    if (packet != NULL)
+        _gekkota_xudpclient_pin_memory(client, incomingMemory, memoryCharge);
 
     gekkota_list_insert(gekkota_list_next(iterator), newIncomingMessage);
 
+    if (slot != NULL)
+        *slot = newIncomingMessage;
+
+    /*
+     * Make the channel ready if the new message can be delivered right
+     * away; fragmented packets are made ready once reassembled.
+     */
+    switch (message->header.messageType)
+    {
+        case GEKKOTA_XUDP_MESSAGE_TYPE_RELIABLE_DATA:
+            if (distance == 1)
+                _gekkota_xudpclient_schedule_receive(channel);
+            break;
+
+        case GEKKOTA_XUDP_MESSAGE_TYPE_UNRELIABLE_DATA:
+            if (distance == 0)
+                _gekkota_xudpclient_schedule_receive(channel);
+            break;
+
+        case GEKKOTA_XUDP_MESSAGE_TYPE_UNSEQUENCED_DATA:
+            _gekkota_xudpclient_schedule_receive(channel);
+            break;
+
+        default:
+            break;
+    }
+
     if (incomingMessage != NULL)
         *incomingMessage = newIncomingMessage;
 
-    return 0;
+    return 1;
 }
 
 int32_t
@@ -932,7 +1099,10 @@ _gekkota_xudpclient_queue_outgoing_message(
     channel = &client->channels[message->header.channelId];
 
     client->outgoingDataTotal += (uint32_t) _gekkota_xudp_message_size(
-            message->header.messageType) + length;
+            message->header.messageType, client->protocolVersion) + length;
+
+    if (packet != NULL)
+        _gekkota_xudpclient_pin_memory(client, outgoingMemory, length);
 
     if (message->header.channelId == 0xFF)
     {
@@ -967,18 +1137,115 @@ _gekkota_xudpclient_queue_outgoing_message(
     else
         gekkota_list_add(&client->outgoingUnreliableMessages, newOutgoingMessage);
 
+    _gekkota_xudpclient_schedule_output(client);
+
     if (outgoingMessage != NULL)
         *outgoingMessage = newOutgoingMessage;
 
     return 0;
 }
 
+int32_t
+_gekkota_xudpclient_receive(
+        GekkotaXudpClient *client,
+        uint8_t channelId,
+        GekkotaPacket **packet,
+        GekkotaSocketAddress *remoteSocketAddress)
+{
+    GekkotaChannel *channel;
+    GekkotaIncomingMessage *incomingMessage = NULL;
+
+    channel = &client->channels[channelId];
+
+    /*
+     * Check for unreliable messages first.
+     */
+    if (!gekkota_list_is_empty(&channel->incomingUnreliableMessages))
+    {
+        incomingMessage = (GekkotaIncomingMessage *)
+            gekkota_list_first(&channel->incomingUnreliableMessages);
+
+        if (incomingMessage->message.header.messageType == GEKKOTA_XUDP_MESSAGE_TYPE_UNRELIABLE_DATA)
+        {
+            if (incomingMessage->reliableSequenceNumber != channel->incomingReliableSequenceNumber)
+                incomingMessage = NULL;
+            else
+                channel->incomingUnreliableSequenceNumber = incomingMessage->unreliableSequenceNumber;
+        }
+    }
+
+    /*
+     * If there are no unreliable messages and the client is not member of a
+     * multicast group, then check for reliable messages.
+     */
+    if (incomingMessage == NULL && !client->isMulticastGroupMember &&
+            !gekkota_list_is_empty(&channel->incomingReliableMessages))
+    {
+        GekkotaIncomingMessage **slot;
+
+        /*
+         * The next message in sequence, if already received, sits in the
+         * reorder window right after the last delivered one.
+         */
+        slot = &channel->incomingReliableWindow[
+            (uint16_t) (channel->incomingReliableSequenceNumber + 1) &
+            (GEKKOTA_XUDP_CLIENT_REORDER_WINDOW_SIZE - 1)];
+
+        incomingMessage = *slot;
+
+        if (incomingMessage == NULL || incomingMessage->fragmentsRemaining > 0 ||
+                incomingMessage->reliableSequenceNumber !=
+                (uint16_t) (channel->incomingReliableSequenceNumber + 1))
+            /*
+             * Still waiting for missing messages or data fragments...
+             */
+            return 0;
+
+        *slot = NULL;
+        channel->incomingReliableSequenceNumber = incomingMessage->reliableSequenceNumber;
+
+        if (incomingMessage->fragmentCount > 0)
+            channel->incomingReliableSequenceNumber
+                += (uint16_t) incomingMessage->fragmentCount - 1;
+    }
+
+    if (incomingMessage == NULL)
+        return 0;
+
+    gekkota_list_remove(&incomingMessage->listNode);
+    *packet = incomingMessage->packet;
+    _gekkota_xudpclient_unpin_memory(client, incomingMemory, incomingMessage->memoryCharge);
+
+    /*
+     * Delivering a message might make the next ones deliverable as well.
+     */
+    _gekkota_xudpclient_schedule_receive(channel);
+
+    if (remoteSocketAddress != NULL)
+        *remoteSocketAddress = incomingMessage->remoteSocketAddress;
+
+    /*
+     * If the GEKKOTA_PACKET_FLAG_COMPRESSED flag is on, inflate the packet.
+     */
+    if (gekkota_bit_isset(((GekkotaPacket *) *packet)->flags, GEKKOTA_PACKET_FLAG_COMPRESSED))
+    {
+        GekkotaPacket *inflated;
+
+        inflated = _gekkota_xudpclient_inflate(client, *packet);
+        gekkota_packet_destroy(*packet);
+        *packet = inflated;
+    }
+
+    gekkota_memory_free(incomingMessage);
+    return *packet != NULL ? 1 : -1;
+}
+
 void_t
 _gekkota_xudpclient_reset(GekkotaXudpClient *restrict client)
 {
     client->localClientId = (uint16_t) (client - client->xudp->clients);
     client->remoteClientId = 0xFFFF;
-    client->state = GEKKOTA_CLIENT_STATE_DISCONNECTED;
+    _gekkota_xudpclient_set_state(client, GEKKOTA_CLIENT_STATE_DISCONNECTED);
     client->compressionLevel = GEKKOTA_COMPRESSION_LEVEL_UNDEFINED;
     client->packetThrottle = GEKKOTA_XUDP_CLIENT_DEFAULT_PACKET_THROTTLE;
     client->packetThrottleLimit = GEKKOTA_XUDP_CLIENT_PACKET_THROTTLE_SCALE;
@@ -988,8 +1255,77 @@ _gekkota_xudpclient_reset(GekkotaXudpClient *restrict client)
     client->lastRoundTripTime = GEKKOTA_XUDP_CLIENT_DEFAULT_ROUND_TRIP_TIME;
     client->lowestRoundTripTime = GEKKOTA_XUDP_CLIENT_DEFAULT_ROUND_TRIP_TIME;
     client->roundTripTime = GEKKOTA_XUDP_CLIENT_DEFAULT_ROUND_TRIP_TIME;
+    client->roundTripTimeUs = GEKKOTA_XUDP_CLIENT_DEFAULT_ROUND_TRIP_TIME * 1000;
     client->mtu = client->xudp->mtu;
     client->windowSize = GEKKOTA_XUDP_MAX_WINDOW_SIZE;
+    client->acknowledgeRanges = FALSE;
+    client->compactHeaders = FALSE;
+    client->protocolVersion = GEKKOTA_XUDP_VERSION;
+}
+
+void_t
+_gekkota_xudpclient_schedule_dispatch(GekkotaXudpClient *restrict client)
+{
+    if (client->dispatchNode.next == NULL)
+        gekkota_list_add(&client->xudp->dispatchClients, &client->dispatchNode);
+}
+
+void_t
+_gekkota_xudpclient_schedule_output(GekkotaXudpClient *restrict client)
+{
+    if (client->outgoingNode.next == NULL)
+        gekkota_list_add(&client->xudp->outgoingClients, &client->outgoingNode);
+}
+
+void_t
+_gekkota_xudpclient_schedule_receive(GekkotaChannel *restrict channel)
+{
+    if (channel->readyNode.next == NULL)
+        gekkota_list_add(&channel->client->xudp->readyChannels, &channel->readyNode);
+}
+
+void_t
+_gekkota_xudpclient_set_state(
+        GekkotaXudpClient *restrict client,
+        GekkotaClientState state)
+{
+    client->state = state;
+
+    /*
+     * Keep the active client lists of [xudp] in sync with the new state,
+     * so that the XUDP instance never has to scan disconnected clients.
+     */
+    if (state == GEKKOTA_CLIENT_STATE_DISCONNECTED)
+    {
+        if (client->connectedNode.next != NULL)
+            gekkota_list_remove(&client->connectedNode);
+
+        if (client->outgoingNode.next != NULL)
+            gekkota_list_remove(&client->outgoingNode);
+
+        if (client->dispatchNode.next != NULL)
+            gekkota_list_remove(&client->dispatchNode);
+
+        return;
+    }
+
+    if (client->connectedNode.next == NULL)
+        gekkota_list_add(&client->xudp->connectedClients, &client->connectedNode);
+
+    switch (state)
+    {
+        case GEKKOTA_CLIENT_STATE_CONNECTION_PENDING:
+        case GEKKOTA_CLIENT_STATE_CONNECTION_SUCCEEDED:
+        case GEKKOTA_CLIENT_STATE_ZOMBIE:
+            /*
+             * A connect or disconnect event is pending.
+             */
+            _gekkota_xudpclient_schedule_dispatch(client);
+            break;
+
+        default:
+            break;
+    }
 }
 
 int32_t
@@ -1024,7 +1360,7 @@ _gekkota_xudpclient_throttle(
 static GekkotaPacket *
 _gekkota_xudpclient_deflate(
         GekkotaXudpClient *client,
-        const GekkotaPacket *packet)
+        GekkotaPacket *packet)
 {
     int32_t length;
     GekkotaPacket *deflated;
@@ -1033,9 +1369,15 @@ _gekkota_xudpclient_deflate(
         if ((client->lzf = _gekkota_xudpclient_get_lzf(client)) == NULL)
             return NULL;
 
+    /*
+     * The compressor needs the data of a segmented packet in one piece.
+     */
+    if (_gekkota_packet_flatten(packet) != 0)
+        return NULL;
+
     length = gekkota_lzf_get_max_deflated_length(client->lzf, &packet->data);
 
-    if ((deflated = gekkota_packet_new(length)) == NULL)
+    if ((deflated = gekkota_packet_new_with_headroom(length, packet->flags)) == NULL)
         return NULL;
 
     if ((length = gekkota_lzf_deflate(
@@ -1048,7 +1390,6 @@ _gekkota_xudpclient_deflate(
     }
 
     deflated->data.length = length;
-    deflated->flags = packet->flags;
 
     return deflated;
 }
@@ -1083,15 +1424,18 @@ _gekkota_xudpclient_get_lzf(const GekkotaXudpClient *client)
 {
     GekkotaLZF *lzf = NULL;
     GekkotaXudpClient *currentClient;
+    GekkotaListIterator iterator;
 
     /*
      * Search for an existing LZF instance that provides
      * the required compression level.
      */
-    for (currentClient = client->xudp->clients;
-            currentClient < &client->xudp->clients[client->xudp->clientCount];
-            currentClient++)
+    for (iterator = gekkota_list_head(&client->xudp->connectedClients);
+            iterator != gekkota_list_tail(&client->xudp->connectedClients);
+            iterator = gekkota_list_next(iterator))
     {
+        currentClient = _gekkota_xudpclient_from_node(iterator, connectedNode);
+
         if (currentClient->lzf != NULL &&
                 currentClient->compressionLevel == client->compressionLevel)
         {
@@ -1111,3 +1455,26 @@ _gekkota_xudpclient_get_lzf(const GekkotaXudpClient *client)
 
     return lzf;
 }
+
+static GekkotaOutgoingMessage **
+_gekkota_xudpclient_get_sent_reliable_slot(
+        GekkotaXudpClient *restrict client,
+        uint16_t sequenceNumber,
+        uint8_t channelId,
+        uint32_t **overflow)
+{
+    GekkotaChannel *channel;
+
+    if (channelId == 0xFF)
+    {
+        *overflow = &client->sentControlOverflow;
+        return &client->sentControlMessages[
+            sequenceNumber & (GEKKOTA_XUDP_CLIENT_CONTROL_WINDOW_SIZE - 1)];
+    }
+
+    channel = &client->channels[channelId];
+
+    *overflow = &channel->sentReliableOverflow;
+    return &channel->sentReliableMessages[
+        sequenceNumber & (GEKKOTA_XUDP_CLIENT_SENT_WINDOW_SIZE - 1)];
+}
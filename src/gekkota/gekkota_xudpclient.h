@@ -61,6 +61,9 @@ gekkota_xudpclient_get_local_endpoint(const GekkotaXudpClient *client);
 GEKKOTA_API GekkotaIPEndPoint *
 gekkota_xudpclient_get_remote_endpoint(const GekkotaXudpClient *client);
 
+GEKKOTA_API uint32_t
+gekkota_xudpclient_get_memory_usage(const GekkotaXudpClient *client);
+
 GEKKOTA_API GekkotaClientState
 gekkota_xudpclient_get_state(const GekkotaXudpClient *client);
 
@@ -32,15 +32,71 @@
 #define GEKKOTA_XUDP_CLIENT_TIMEOUT_LIMIT                   32
 #define GEKKOTA_XUDP_CLIENT_PING_INTERVAL                   500
 #define GEKKOTA_XUDP_CLIENT_UNSEQUENCED_WINDOW_SIZE         4 * 32
+#define GEKKOTA_XUDP_CLIENT_SENT_WINDOW_SIZE                256     /* power of 2 */
+#define GEKKOTA_XUDP_CLIENT_CONTROL_WINDOW_SIZE             16      /* power of 2 */
+#define GEKKOTA_XUDP_CLIENT_REORDER_WINDOW_SIZE             1024    /* power of 2 */
+#define GEKKOTA_XUDP_CLIENT_ACKNOWLEDGE_RANGE_SIZE          32
+
+/*
+ * Returns the client that embeds the specified list node as [member].
+ */
+#define _gekkota_xudpclient_from_node(node, member) \
+    ((GekkotaXudpClient *) ((byte_t *) (node) - (size_t) &((GekkotaXudpClient *) 0)->member))
+
+/*
+ * Returns TRUE if [length] more bytes can be pinned by [client] in the
+ * direction accounted by [member] without exceeding the limits of either
+ * the client or its XUDP instance.
+ */
+#define _gekkota_xudpclient_fits_memory_limit(client, member, length) \
+    (((client)->xudp->clientMemoryLimit == 0 || \
+      (uint64_t) (client)->member + (length) <= (client)->xudp->clientMemoryLimit) && \
+     ((client)->xudp->memoryLimit == 0 || \
+      (uint64_t) (client)->xudp->member + (length) <= (client)->xudp->memoryLimit))
+
+/*
+ * Returns the bytes charged against the memory limits for an incoming
+ * message carrying [packet]: the whole buffer its data keeps alive, plus
+ * the message itself so that empty messages are accounted as well.
+ */
+#define _gekkota_xudpclient_incoming_memory_charge(packet) \
+    ((uint32_t) (sizeof(GekkotaIncomingMessage) + _gekkota_packet_get_pinned_size(packet)))
+
+#define _gekkota_xudpclient_pin_memory(client, member, length) \
+    ((client)->member += (uint32_t) (length), \
+     (client)->xudp->member += (uint32_t) (length))
+
+#define _gekkota_xudpclient_unpin_memory(client, member, length) \
+    ((client)->member -= (uint32_t) (length), \
+     (client)->xudp->member -= (uint32_t) (length))
 
 typedef struct _GekkotaChannel
 {
+    GekkotaListNode         readyNode;              /* node in */
+                                                    /* [xudp->readyChannels] */
+    struct _GekkotaXudpClient *client;
     uint16_t                outgoingReliableSequenceNumber;
     uint16_t                outgoingUnreliableSequenceNumber;
     uint16_t                incomingReliableSequenceNumber;
     uint16_t                incomingUnreliableSequenceNumber;
     GekkotaList             incomingReliableMessages;
     GekkotaList             incomingUnreliableMessages;
+
+    /*
+     * Sent reliable messages waiting for acknowledgement, indexed by
+     * sequence number modulo GEKKOTA_XUDP_CLIENT_SENT_WINDOW_SIZE; messages
+     * whose slot is already taken are only reachable through the client's
+     * [sentReliableMessages] list and are counted in [sentReliableOverflow].
+     */
+    struct _GekkotaOutgoingMessage *sentReliableMessages[GEKKOTA_XUDP_CLIENT_SENT_WINDOW_SIZE];
+    uint32_t                sentReliableOverflow;
+
+    /*
+     * Received reliable messages not yet delivered, indexed by sequence
+     * number modulo GEKKOTA_XUDP_CLIENT_REORDER_WINDOW_SIZE; a fragmented
+     * packet occupies the slot of its start sequence number only.
+     */
+    struct _GekkotaIncomingMessage *incomingReliableWindow[GEKKOTA_XUDP_CLIENT_REORDER_WINDOW_SIZE];
 } GekkotaChannel;
 
 typedef struct _GekkotaAcknowledgement
@@ -56,6 +112,7 @@ typedef struct _GekkotaOutgoingMessage
     uint16_t                reliableSequenceNumber;
     uint16_t                unreliableSequenceNumber;
     uint32_t                sentTime;
+    uint64_t                sentTimeUs;
     uint32_t                roundTripTimeout;
     uint32_t                roundTripTimeoutLimit;
     uint32_t                fragmentOffset;
@@ -73,17 +130,24 @@ typedef struct _GekkotaIncomingMessage
     uint32_t                fragmentsRemaining;
     uint32_t                *fragments;
     GekkotaPacket           *packet;
+    uint32_t                memoryCharge;           /* bytes charged */
+                                                    /* against the memory */
+                                                    /* limits */
     GekkotaXudpMessage      message;
-    GekkotaIPEndPoint       *remoteEndPoint;
+    GekkotaSocketAddress    remoteSocketAddress;
 } GekkotaIncomingMessage;
 
 struct _GekkotaXudpClient
 {
     struct _GekkotaXudp     *xudp;
     uint32_t                sessionId;
+    uint8_t                 protocolVersion;        /* wire format used */
+                                                    /* with the remote client */
     uint16_t                localClientId;
     uint16_t                remoteClientId;
     GekkotaIPEndPoint       *remoteEndPoint;
+    GekkotaSocketAddress    remoteSocketAddress;    /* [remoteEndPoint] as */
+                                                    /* socket address */
     bool_t                  isMulticastGroupMember;
     uint32_t                multicastInterfaceIndex;
     GekkotaClientState      state;
@@ -97,6 +161,10 @@ struct _GekkotaXudpClient
     uint32_t                outgoingBandwidthThrottleEpoch;
     uint32_t                incomingDataTotal;
     uint32_t                outgoingDataTotal;
+    uint32_t                incomingMemory;         /* bytes of received */
+                                                    /* data not delivered */
+    uint32_t                outgoingMemory;         /* bytes of queued data */
+                                                    /* not acknowledged */
     uint32_t                lastReceiveTime;
     uint32_t                nextTimeout;
     uint32_t                earliestTimeout;
@@ -109,29 +177,52 @@ struct _GekkotaXudpClient
     uint32_t                packetThrottleInterval;
     uint32_t                roundTripTime;
     uint32_t                roundTripTimeVariance;
+    uint32_t                roundTripTimeUs;
+    uint32_t                roundTripTimeVarianceUs;
     uint32_t                lastRoundTripTime;
     uint32_t                lastRoundTripTimeVariance;
     uint32_t                lowestRoundTripTime;
     uint32_t                highestRoundTripTimeVariance;
     uint16_t                mtu;
     uint32_t                windowSize;
+    bool_t                  acknowledgeRanges;      /* TRUE if the remote */
+                                                    /* client accepts */
+                                                    /* range acknowledgements */
+    bool_t                  compactHeaders;         /* TRUE if the remote */
+                                                    /* client accepts compact */
+                                                    /* data messages */
     uint32_t                reliableDataInTransit;
     uint16_t                outgoingReliableSequenceNumber;
     uint16_t                incomingUnsequencedGroup;
     uint16_t                outgoingUnsequencedGroup;
     uint32_t                unsequencedWindow[GEKKOTA_XUDP_CLIENT_UNSEQUENCED_WINDOW_SIZE / 32];
+    GekkotaOutgoingMessage  *sentControlMessages[GEKKOTA_XUDP_CLIENT_CONTROL_WINDOW_SIZE];
+    uint32_t                sentControlOverflow;
     GekkotaList             acknowledgements;
     GekkotaList             sentReliableMessages;
     GekkotaList             sentUnreliableMessages;
     GekkotaList             outgoingReliableMessages;
     GekkotaList             outgoingUnreliableMessages;
+    GekkotaListNode         connectedNode;          /* node in */
+                                                    /* [xudp->connectedClients] */
+    GekkotaListNode         outgoingNode;           /* node in */
+                                                    /* [xudp->outgoingClients] */
+    GekkotaListNode         dispatchNode;           /* node in */
+                                                    /* [xudp->dispatchClients] */
+    GekkotaListNode         timerNode;              /* node in the timer */
+                                                    /* wheel of [xudp] */
+    uint32_t                timerDeadline;
 };
 
 extern void_t
-_gekkota_xudpclient_clear_incoming_message_queue(GekkotaList *queue);
+_gekkota_xudpclient_clear_incoming_message_queue(
+        GekkotaXudpClient *restrict client,
+        GekkotaList *queue);
 
 extern void_t
-_gekkota_xudpclient_clear_outgoing_message_queue(GekkotaList *queue);
+_gekkota_xudpclient_clear_outgoing_message_queue(
+        GekkotaXudpClient *restrict client,
+        GekkotaList *queue);
 
 extern int32_t
 _gekkota_xudpclient_close_gracefully(GekkotaXudpClient *client);
@@ -145,6 +236,22 @@ _gekkota_xudpclient_close_now(GekkotaXudpClient *client);
 extern void_t
 _gekkota_xudpclient_clear_message_queues(GekkotaXudpClient *client);
 
+extern void_t
+_gekkota_xudpclient_add_sent_reliable_message(
+        GekkotaXudpClient *restrict client,
+        GekkotaOutgoingMessage *outgoingMessage);
+
+extern GekkotaOutgoingMessage *
+_gekkota_xudpclient_find_sent_reliable_message(
+        GekkotaXudpClient *restrict client,
+        uint16_t sequenceNumber,
+        uint8_t channelId);
+
+extern void_t
+_gekkota_xudpclient_remove_sent_reliable_message(
+        GekkotaXudpClient *restrict client,
+        GekkotaOutgoingMessage *outgoingMessage);
+
 extern int32_t
 _gekkota_xudpclient_queue_acknowledgement(
         GekkotaXudpClient *restrict client,
@@ -158,7 +265,7 @@ _gekkota_xudpclient_queue_incoming_message(
         const GekkotaXudpMessage *message,
         GekkotaPacket *packet,
         uint32_t fragmentCount,
-        GekkotaIPEndPoint *remoteEndPoint,
+        const GekkotaSocketAddress *remoteSocketAddress,
         GekkotaIncomingMessage **incomingMessage);
 
 extern int32_t
@@ -170,9 +277,30 @@ _gekkota_xudpclient_queue_outgoing_message(
         uint16_t length,
         GekkotaOutgoingMessage **outgoingMessage);
 
+extern int32_t
+_gekkota_xudpclient_receive(
+        GekkotaXudpClient *client,
+        uint8_t channelId,
+        GekkotaPacket **packet,
+        GekkotaSocketAddress *remoteSocketAddress);
+
 extern void_t
 _gekkota_xudpclient_reset(GekkotaXudpClient *restrict client);
 
+extern void_t
+_gekkota_xudpclient_schedule_dispatch(GekkotaXudpClient *restrict client);
+
+extern void_t
+_gekkota_xudpclient_schedule_output(GekkotaXudpClient *restrict client);
+
+extern void_t
+_gekkota_xudpclient_schedule_receive(GekkotaChannel *restrict channel);
+
+extern void_t
+_gekkota_xudpclient_set_state(
+        GekkotaXudpClient *restrict client,
+        GekkotaClientState state);
+
 extern int32_t
 _gekkota_xudpclient_throttle(
         GekkotaXudpClient *restrict client,
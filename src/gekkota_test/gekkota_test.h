@@ -0,0 +1,65 @@
+/******************************************************************************
+ * @file    gekkota_test.h
+ * @date    17-Oct-2026
+ * @author  <a href="mailto:giuseppe.greco@agamura.com">Giuseppe Greco</a>
+ *
+ * Copyright (C) 2026 Agamura, Inc. - http://www.agamura.com
+ * All right reserved.
+ ******************************************************************************/
+
+#ifndef __GEKKOTA_TEST_H__
+#define __GEKKOTA_TEST_H__
+
+#include <stdio.h>
+#include "gekkota/gekkota_types.h"
+
+/*
+ * Unit tests are run by `make check`; each test program exits with 0 if
+ * all of its test cases pass.
+ */
+typedef struct _GekkotaTestCase
+{
+    const char_t        *name;
+    int32_t             (*run)(void_t);
+} GekkotaTestCase;
+
+/*
+ * Makes the enclosing test case fail if [condition] does not hold.
+ */
+#define gekkota_test_assert(condition) \
+{ \
+    if (!(condition)) \
+    { \
+        fprintf(stderr, "%s:%d: assertion failed: %s\n", \
+                __FILE__, __LINE__, #condition); \
+        return -1; \
+    } \
+}
+
+/*
+ * Runs [testCases] and returns the number of test cases that failed.
+ */
+#define gekkota_test_run(testCases) \
+    _gekkota_test_run(testCases, sizeof(testCases) / sizeof(GekkotaTestCase))
+
+static int32_t
+_gekkota_test_run(const GekkotaTestCase *testCases, size_t testCaseCount)
+{
+    int32_t failed = 0;
+    size_t i;
+
+    for (i = 0; i < testCaseCount; i++)
+    {
+        if (testCases[i].run() != 0)
+        {
+            fprintf(stdout, "FAIL: %s\n", testCases[i].name);
+            failed++;
+        }
+        else
+            fprintf(stdout, "PASS: %s\n", testCases[i].name);
+    }
+
+    return failed;
+}
+
+#endif /* !__GEKKOTA_TEST_H__ */
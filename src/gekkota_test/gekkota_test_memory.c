@@ -0,0 +1,365 @@
+/******************************************************************************
+ * @file    gekkota_test_memory.c
+ * @date    17-Oct-2026
+ * @author  <a href="mailto:giuseppe.greco@agamura.com">Giuseppe Greco</a>
+ *
+ * Copyright (C) 2026 Agamura, Inc. - http://www.agamura.com
+ * All right reserved.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "gekkota/gekkota.h"
+#include "gekkota_test.h"
+
+#define GEKKOTA_TEST_GROWTH_FACTOR 256
+#define GEKKOTA_TEST_ARENA_BLOCK_SIZE 256
+#define GEKKOTA_TEST_ARENA_BLOCK_COUNT 4
+#define GEKKOTA_TEST_ARENA_CHUNK_BLOCKS 8
+
+static int32_t
+gekkota_test_memory_size_classes(void_t);
+
+static int32_t
+gekkota_test_memory_reuse(void_t);
+
+static int32_t
+gekkota_test_memory_growth(void_t);
+
+static int32_t
+gekkota_test_memory_realloc(void_t);
+
+static int32_t
+gekkota_test_memory_arena_foreign_free(void_t);
+
+static int32_t
+gekkota_test_memory_arena_foreign_realloc(void_t);
+
+static bool_t
+gekkota_test_memory_check(const void_t *memory, size_t size, byte_t value);
+
+static const GekkotaTestCase testCases[] =
+{
+    { "memory: size classes", gekkota_test_memory_size_classes },
+    { "memory: reuse", gekkota_test_memory_reuse },
+    { "memory: growth", gekkota_test_memory_growth },
+    { "memory: realloc", gekkota_test_memory_realloc },
+    { "memory: arena foreign free", gekkota_test_memory_arena_foreign_free },
+    { "memory: arena foreign realloc", gekkota_test_memory_arena_foreign_realloc }
+};
+
+int32_t main(void_t)
+{
+    int32_t failed;
+
+    if (gekkota_initialize() != 0 || gekkota_memory_initialize(
+            GEKKOTA_MEMORY_DEFAULT_BLOCK_SIZE,
+            GEKKOTA_MEMORY_DEFAULT_BLOCK_COUNT) != 0)
+    {
+        fprintf(stderr, "Error while initializing Gekkota - RC 0x%08X.\n",
+                gekkota_get_last_error());
+        return EXIT_FAILURE;
+    }
+
+    failed = gekkota_test_run(testCases);
+
+    gekkota_memory_uninitialize();
+    gekkota_uninitialize();
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int32_t
+gekkota_test_memory_size_classes(void_t)
+{
+    /*
+     * Sizes on both sides of every size class, plus some larger than the
+     * block size, which are served by malloc.
+     */
+    static const size_t sizes[] =
+    {
+        1, 31, 32, 33, 64, 100, 128, 255, 256, 257, 512, 1400, 1536,
+        1537, 4095, 4096, 4097, 65536
+    };
+
+    void_t *memory[sizeof(sizes) / sizeof(size_t)];
+    size_t i;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(size_t); i++)
+    {
+        memory[i] = gekkota_memory_alloc(sizes[i], TRUE);
+        gekkota_test_assert(memory[i] != NULL);
+        gekkota_test_assert(gekkota_test_memory_check(memory[i], sizes[i], 0x00));
+
+        memset(memory[i], (byte_t) i, sizes[i]);
+    }
+
+    /*
+     * Blocks must not overlap, whatever their size class.
+     */
+    for (i = 0; i < sizeof(sizes) / sizeof(size_t); i++)
+    {
+        gekkota_test_assert(gekkota_test_memory_check(memory[i], sizes[i], (byte_t) i));
+        gekkota_memory_free(memory[i]);
+    }
+
+    return 0;
+}
+
+static int32_t
+gekkota_test_memory_reuse(void_t)
+{
+    void_t *memory, *newMemory;
+
+    /*
+     * A freed block is the first one handed out again in its size class.
+     */
+    memory = gekkota_memory_alloc(100, FALSE);
+    gekkota_test_assert(memory != NULL);
+    gekkota_memory_free(memory);
+
+    newMemory = gekkota_memory_alloc(128, FALSE);
+    gekkota_test_assert(newMemory == memory);
+    gekkota_memory_free(newMemory);
+
+    /*
+     * Blocks of a different size class come from elsewhere.
+     */
+    newMemory = gekkota_memory_alloc(512, FALSE);
+    gekkota_test_assert(newMemory != NULL && newMemory != memory);
+    gekkota_memory_free(newMemory);
+
+    /*
+     * Freeing NULL is harmless.
+     */
+    gekkota_memory_free(NULL);
+
+    return 0;
+}
+
+static int32_t
+gekkota_test_memory_growth(void_t)
+{
+    /*
+     * Allocate many more blocks than a chunk holds, so that the size class
+     * has to grow several times.
+     */
+    size_t blockCount = GEKKOTA_MEMORY_DEFAULT_BLOCK_COUNT * GEKKOTA_TEST_GROWTH_FACTOR;
+    uint32_t **blocks;
+    size_t i;
+
+    blocks = malloc(sizeof(uint32_t *) * blockCount);
+    gekkota_test_assert(blocks != NULL);
+
+    for (i = 0; i < blockCount; i++)
+    {
+        if ((blocks[i] = gekkota_memory_alloc(64, FALSE)) == NULL)
+            break;
+
+        memset(blocks[i], 0xAA, 64);
+        *blocks[i] = (uint32_t) i;
+    }
+
+    gekkota_test_assert(i == blockCount);
+
+    for (i = 0; i < blockCount; i++)
+    {
+        gekkota_test_assert(*blocks[i] == (uint32_t) i);
+        gekkota_test_assert(gekkota_test_memory_check(
+                blocks[i] + 1, 64 - sizeof(uint32_t), 0xAA));
+    }
+
+    for (i = 0; i < blockCount; i++)
+        gekkota_memory_free(blocks[i]);
+
+    free(blocks);
+    return 0;
+}
+
+static int32_t
+gekkota_test_memory_realloc(void_t)
+{
+    static const size_t sizes[] = { 16, 300, 1500, 5000, 100000, 100, 8 };
+
+    byte_t *memory;
+    size_t i, j, size;
+
+    memory = gekkota_memory_alloc(sizes[0], FALSE);
+    gekkota_test_assert(memory != NULL);
+
+    for (j = 0; j < sizes[0]; j++)
+        memory[j] = (byte_t) j;
+
+    /*
+     * Contents are preserved while moving across size classes and from
+     * and to malloc'd memory.
+     */
+    for (i = 1, size = sizes[0]; i < sizeof(sizes) / sizeof(size_t); i++)
+    {
+        memory = gekkota_memory_realloc(memory, sizes[i], FALSE);
+        gekkota_test_assert(memory != NULL);
+
+        for (j = 0; j < size && j < sizes[i]; j++)
+            gekkota_test_assert(memory[j] == (byte_t) j);
+
+        for (size = sizes[i]; j < size; j++)
+            memory[j] = (byte_t) j;
+    }
+
+    gekkota_memory_free(memory);
+
+    /*
+     * Reallocating with [initialize] clears the whole memory.
+     */
+    memory = gekkota_memory_alloc(32, FALSE);
+    gekkota_test_assert(memory != NULL);
+    memset(memory, 0xFF, 32);
+
+    memory = gekkota_memory_realloc(memory, 1000, TRUE);
+    gekkota_test_assert(memory != NULL);
+    gekkota_test_assert(gekkota_test_memory_check(memory, 1000, 0x00));
+
+    gekkota_memory_free(memory);
+    return 0;
+}
+
+static int32_t
+gekkota_test_memory_arena_foreign_free(void_t)
+{
+    GekkotaMemoryArena *arena, *otherArena;
+    void_t *blocks[GEKKOTA_TEST_ARENA_CHUNK_BLOCKS];
+    void_t *newBlocks[GEKKOTA_TEST_ARENA_CHUNK_BLOCKS];
+    void_t *memory;
+    size_t i, j;
+
+    arena = gekkota_memory_arena_new(
+            GEKKOTA_TEST_ARENA_BLOCK_SIZE, GEKKOTA_TEST_ARENA_BLOCK_COUNT);
+    otherArena = gekkota_memory_arena_new(
+            GEKKOTA_TEST_ARENA_BLOCK_SIZE, GEKKOTA_TEST_ARENA_BLOCK_COUNT);
+    gekkota_test_assert(arena != NULL && otherArena != NULL);
+
+    /*
+     * Use up exactly one chunk of the 128-byte size class.
+     */
+    gekkota_memory_set_arena(arena);
+
+    for (i = 0; i < GEKKOTA_TEST_ARENA_CHUNK_BLOCKS; i++)
+    {
+        blocks[i] = gekkota_memory_alloc(128, FALSE);
+        gekkota_test_assert(blocks[i] != NULL);
+    }
+
+    /*
+     * Blocks freed while another arena is attached go back to their owner,
+     * which must then serve them again instead of growing.
+     */
+    gekkota_memory_set_arena(otherArena);
+
+    for (i = 0; i < GEKKOTA_TEST_ARENA_CHUNK_BLOCKS; i++)
+        gekkota_memory_free(blocks[i]);
+
+    gekkota_memory_set_arena(arena);
+
+    for (i = 0; i < GEKKOTA_TEST_ARENA_CHUNK_BLOCKS; i++)
+    {
+        newBlocks[i] = gekkota_memory_alloc(128, FALSE);
+        gekkota_test_assert(newBlocks[i] != NULL);
+
+        for (j = 0; j < GEKKOTA_TEST_ARENA_CHUNK_BLOCKS; j++)
+            if (newBlocks[i] == blocks[j])
+                break;
+
+        gekkota_test_assert(j < GEKKOTA_TEST_ARENA_CHUNK_BLOCKS);
+    }
+
+    /*
+     * The same holds when no arena is attached, or when the owner is
+     * named explicitly.
+     */
+    gekkota_memory_set_arena(NULL);
+
+    for (i = 0; i < GEKKOTA_TEST_ARENA_CHUNK_BLOCKS / 2; i++)
+        gekkota_memory_free(newBlocks[i]);
+
+    for (; i < GEKKOTA_TEST_ARENA_CHUNK_BLOCKS; i++)
+        gekkota_memory_arena_free(arena, newBlocks[i]);
+
+    gekkota_memory_set_arena(arena);
+
+    for (i = 0; i < GEKKOTA_TEST_ARENA_CHUNK_BLOCKS; i++)
+    {
+        blocks[i] = gekkota_memory_alloc(128, FALSE);
+
+        for (j = 0; j < GEKKOTA_TEST_ARENA_CHUNK_BLOCKS; j++)
+            if (blocks[i] == newBlocks[j])
+                break;
+
+        gekkota_test_assert(j < GEKKOTA_TEST_ARENA_CHUNK_BLOCKS);
+    }
+
+    for (i = 0; i < GEKKOTA_TEST_ARENA_CHUNK_BLOCKS; i++)
+        gekkota_memory_free(blocks[i]);
+
+    /*
+     * Memory larger than the block size stays with malloc wherever it is
+     * freed.
+     */
+    memory = gekkota_memory_alloc(GEKKOTA_TEST_ARENA_BLOCK_SIZE * 2, FALSE);
+    gekkota_test_assert(memory != NULL);
+
+    gekkota_memory_set_arena(otherArena);
+    gekkota_memory_free(memory);
+
+    gekkota_memory_arena_destroy(otherArena);
+    gekkota_memory_arena_destroy(arena);
+    gekkota_test_assert(gekkota_memory_get_arena() == NULL);
+
+    return 0;
+}
+
+static int32_t
+gekkota_test_memory_arena_foreign_realloc(void_t)
+{
+    GekkotaMemoryArena *arena;
+    byte_t *memory;
+    size_t i;
+
+    arena = gekkota_memory_arena_new(
+            GEKKOTA_TEST_ARENA_BLOCK_SIZE, GEKKOTA_TEST_ARENA_BLOCK_COUNT);
+    gekkota_test_assert(arena != NULL);
+
+    gekkota_memory_set_arena(arena);
+    memory = gekkota_memory_alloc(100, FALSE);
+    gekkota_test_assert(memory != NULL);
+
+    for (i = 0; i < 100; i++)
+        memory[i] = (byte_t) i;
+
+    /*
+     * Reallocating a block of another arena moves it into the heap in use
+     * and hands the old block back to its owner.
+     */
+    gekkota_memory_set_arena(NULL);
+    memory = gekkota_memory_realloc(memory, 200, FALSE);
+    gekkota_test_assert(memory != NULL);
+
+    for (i = 0; i < 100; i++)
+        gekkota_test_assert(memory[i] == (byte_t) i);
+
+    gekkota_memory_free(memory);
+    gekkota_memory_arena_destroy(arena);
+
+    return 0;
+}
+
+static bool_t
+gekkota_test_memory_check(const void_t *memory, size_t size, byte_t value)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        if (((const byte_t *) memory)[i] != value)
+            return FALSE;
+
+    return TRUE;
+}
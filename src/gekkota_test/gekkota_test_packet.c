@@ -0,0 +1,472 @@
+/******************************************************************************
+ * @file    gekkota_test_packet.c
+ * @date    17-Oct-2026
+ * @author  <a href="mailto:giuseppe.greco@agamura.com">Giuseppe Greco</a>
+ *
+ * Copyright (C) 2026 Agamura, Inc. - http://www.agamura.com
+ * All right reserved.
+ ******************************************************************************/
+
+/*
+ * Packet pools and slices are internal, so link against them the way the
+ * library itself does.
+ */
+#define GEKKOTA_BUILDING_STATIC_LIB
+
+#include <stdlib.h>
+#include <string.h>
+#include "gekkota/gekkota.h"
+#include "gekkota/gekkota_memory.h"
+#include "gekkota/gekkota_packet.h"
+#include "gekkota_test.h"
+
+#define GEKKOTA_TEST_PACKET_SIZE 512
+#define GEKKOTA_TEST_SEGMENT_COUNT 3
+
+/*
+ * Counts the calls to gekkota_test_packet_release().
+ */
+typedef struct _GekkotaTestRelease
+{
+    uint32_t            callCount;
+    uint16_t            segmentCount;
+} GekkotaTestRelease;
+
+static int32_t
+gekkota_test_packet_references(void_t);
+
+static int32_t
+gekkota_test_packet_pool_reuse(void_t);
+
+static int32_t
+gekkota_test_packet_pool_foreign_return(void_t);
+
+static int32_t
+gekkota_test_packet_pool_destroy(void_t);
+
+static int32_t
+gekkota_test_packet_slice(void_t);
+
+static int32_t
+gekkota_test_packet_segments(void_t);
+
+static int32_t
+gekkota_test_packet_flatten(void_t);
+
+static int32_t
+gekkota_test_packet_foreign_data(void_t);
+
+static void_t
+gekkota_test_packet_release(
+        const GekkotaBuffer *segments,
+        uint16_t segmentCount,
+        void_t *userData);
+
+static const GekkotaTestCase testCases[] =
+{
+    { "packet: references", gekkota_test_packet_references },
+    { "packet: pool reuse", gekkota_test_packet_pool_reuse },
+    { "packet: pool foreign return", gekkota_test_packet_pool_foreign_return },
+    { "packet: pool destroy", gekkota_test_packet_pool_destroy },
+    { "packet: slice", gekkota_test_packet_slice },
+    { "packet: segments", gekkota_test_packet_segments },
+    { "packet: flatten", gekkota_test_packet_flatten },
+    { "packet: foreign data", gekkota_test_packet_foreign_data }
+};
+
+int32_t main(void_t)
+{
+    int32_t failed;
+
+    if (gekkota_initialize() != 0 || gekkota_memory_initialize(
+            GEKKOTA_MEMORY_DEFAULT_BLOCK_SIZE,
+            GEKKOTA_MEMORY_DEFAULT_BLOCK_COUNT) != 0)
+    {
+        fprintf(stderr, "Error while initializing Gekkota - RC 0x%08X.\n",
+                gekkota_get_last_error());
+        return EXIT_FAILURE;
+    }
+
+    failed = gekkota_test_run(testCases);
+
+    gekkota_memory_uninitialize();
+    gekkota_uninitialize();
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int32_t
+gekkota_test_packet_references(void_t)
+{
+    GekkotaPacket *packet;
+
+    packet = gekkota_packet_new_1(GEKKOTA_TEST_PACKET_SIZE, GEKKOTA_PACKET_FLAG_RELIABLE);
+    gekkota_test_assert(packet != NULL);
+
+    /*
+     * A shallow copy is a new reference to the same packet, and
+     * gekkota_packet_destroy() returns the references left.
+     */
+    gekkota_test_assert(gekkota_packet_new_0(packet, FALSE) == packet);
+    gekkota_test_assert(gekkota_packet_new_0(packet, FALSE) == packet);
+
+    gekkota_test_assert(gekkota_packet_destroy(packet) == 2);
+    gekkota_test_assert(gekkota_packet_destroy(packet) == 1);
+    gekkota_test_assert(gekkota_packet_get_size(packet) == GEKKOTA_TEST_PACKET_SIZE);
+    gekkota_test_assert(gekkota_packet_destroy(packet) == 0);
+
+    return 0;
+}
+
+static int32_t
+gekkota_test_packet_pool_reuse(void_t)
+{
+    GekkotaPacketPool *pool;
+    GekkotaPacket *packet, *newPacket;
+
+    pool = _gekkota_packet_pool_new(GEKKOTA_TEST_PACKET_SIZE);
+    gekkota_test_assert(pool != NULL);
+
+    packet = _gekkota_packet_pool_get(pool);
+    gekkota_test_assert(packet != NULL);
+    gekkota_test_assert(gekkota_packet_get_size(packet) == GEKKOTA_TEST_PACKET_SIZE);
+
+    /*
+     * A destroyed packet goes back to its pool and comes out again reset,
+     * whatever was done with it in the meantime.
+     */
+    gekkota_packet_set_flags(packet, GEKKOTA_PACKET_FLAG_UNSEQUENCED);
+    gekkota_packet_get_data(packet)->length = 10;
+    gekkota_test_assert(gekkota_packet_destroy(packet) == 0);
+
+    newPacket = _gekkota_packet_pool_get(pool);
+    gekkota_test_assert(newPacket == packet);
+    gekkota_test_assert(gekkota_packet_get_size(newPacket) == GEKKOTA_TEST_PACKET_SIZE);
+    gekkota_test_assert(gekkota_packet_get_flags(newPacket) == GEKKOTA_PACKET_FLAG_NONE);
+
+    /*
+     * A packet still referenced is not handed out again.
+     */
+    gekkota_packet_new_0(newPacket, FALSE);
+    gekkota_test_assert(gekkota_packet_destroy(newPacket) == 1);
+
+    packet = _gekkota_packet_pool_get(pool);
+    gekkota_test_assert(packet != NULL && packet != newPacket);
+
+    gekkota_packet_destroy(packet);
+    gekkota_packet_destroy(newPacket);
+    _gekkota_packet_pool_destroy(pool);
+
+    return 0;
+}
+
+static int32_t
+gekkota_test_packet_pool_foreign_return(void_t)
+{
+    GekkotaMemoryArena *arena;
+    GekkotaPacketPool *pool;
+    GekkotaPacket *packet;
+
+    arena = gekkota_memory_arena_new(
+            GEKKOTA_MEMORY_DEFAULT_BLOCK_SIZE,
+            GEKKOTA_MEMORY_DEFAULT_BLOCK_COUNT);
+    gekkota_test_assert(arena != NULL);
+
+    pool = _gekkota_packet_pool_new(GEKKOTA_TEST_PACKET_SIZE);
+    gekkota_test_assert(pool != NULL);
+
+    packet = _gekkota_packet_pool_get(pool);
+    gekkota_test_assert(packet != NULL);
+
+    /*
+     * Packets destroyed where another arena is attached, as on another
+     * thread, still go back to their pool.
+     */
+    gekkota_memory_set_arena(arena);
+    gekkota_test_assert(gekkota_packet_destroy(packet) == 0);
+    gekkota_memory_set_arena(NULL);
+
+    gekkota_test_assert(_gekkota_packet_pool_get(pool) == packet);
+
+    /*
+     * Once the pool is gone, the last packet out frees it.
+     */
+    _gekkota_packet_pool_destroy(pool);
+
+    gekkota_memory_set_arena(arena);
+    gekkota_test_assert(gekkota_packet_destroy(packet) == 0);
+    gekkota_memory_set_arena(NULL);
+
+    gekkota_memory_arena_destroy(arena);
+    return 0;
+}
+
+static int32_t
+gekkota_test_packet_pool_destroy(void_t)
+{
+    GekkotaPacketPool *pool;
+    GekkotaPacket *packets[3];
+    size_t i;
+
+    pool = _gekkota_packet_pool_new(GEKKOTA_TEST_PACKET_SIZE);
+    gekkota_test_assert(pool != NULL);
+
+    for (i = 0; i < sizeof(packets) / sizeof(GekkotaPacket *); i++)
+    {
+        packets[i] = _gekkota_packet_pool_get(pool);
+        gekkota_test_assert(packets[i] != NULL);
+    }
+
+    /*
+     * Free packets go with the pool; outstanding ones remain usable until
+     * destroyed.
+     */
+    gekkota_packet_destroy(packets[0]);
+    _gekkota_packet_pool_destroy(pool);
+
+    for (i = 1; i < sizeof(packets) / sizeof(GekkotaPacket *); i++)
+    {
+        memset(gekkota_packet_get_data(packets[i])->data, 0xAA, GEKKOTA_TEST_PACKET_SIZE);
+        gekkota_test_assert(gekkota_packet_destroy(packets[i]) == 0);
+    }
+
+    return 0;
+}
+
+static int32_t
+gekkota_test_packet_slice(void_t)
+{
+    GekkotaPacket *packet, *slice;
+    GekkotaBuffer *data;
+    size_t i;
+
+    packet = gekkota_packet_new(GEKKOTA_TEST_PACKET_SIZE);
+    gekkota_test_assert(packet != NULL);
+
+    data = gekkota_packet_get_data(packet);
+
+    for (i = 0; i < GEKKOTA_TEST_PACKET_SIZE; i++)
+        ((byte_t *) data->data)[i] = (byte_t) i;
+
+    slice = _gekkota_packet_new_slice(packet, 100, 200, GEKKOTA_PACKET_FLAG_RELIABLE);
+    gekkota_test_assert(slice != NULL);
+    gekkota_test_assert(gekkota_packet_get_size(slice) == 200);
+    gekkota_test_assert(gekkota_packet_get_flags(slice) == GEKKOTA_PACKET_FLAG_RELIABLE);
+    gekkota_test_assert(gekkota_packet_get_data(slice)->data == (byte_t *) data->data + 100);
+
+    /*
+     * A slice is charged for the whole packet it keeps alive, which
+     * outlives its last reference from elsewhere.
+     */
+    gekkota_test_assert(_gekkota_packet_get_pinned_size(slice) == GEKKOTA_TEST_PACKET_SIZE);
+    gekkota_test_assert(gekkota_packet_destroy(packet) == 1);
+
+    for (i = 0; i < 200; i++)
+        gekkota_test_assert(((byte_t *) gekkota_packet_get_data(slice)->data)[i]
+                == (byte_t) (i + 100));
+
+    gekkota_test_assert(gekkota_packet_destroy(slice) == 0);
+
+    /*
+     * Headroom is part of what a packet pins.
+     */
+    packet = gekkota_packet_new_with_headroom(100, GEKKOTA_PACKET_FLAG_NONE);
+    gekkota_test_assert(packet != NULL);
+    gekkota_test_assert(_gekkota_packet_get_pinned_size(packet)
+            == 100 + GEKKOTA_PACKET_HEADROOM);
+    gekkota_packet_destroy(packet);
+
+    return 0;
+}
+
+static int32_t
+gekkota_test_packet_segments(void_t)
+{
+    static const char_t *strings[GEKKOTA_TEST_SEGMENT_COUNT] =
+    {
+        "Hello, ", "segmented ", "world!"
+    };
+
+    GekkotaTestRelease release = { 0, 0 };
+    GekkotaBuffer segments[GEKKOTA_TEST_SEGMENT_COUNT];
+    GekkotaBuffer buffers[GEKKOTA_TEST_SEGMENT_COUNT];
+    GekkotaPacket *packet;
+    uint16_t i;
+
+    for (i = 0; i < GEKKOTA_TEST_SEGMENT_COUNT; i++)
+    {
+        segments[i].data = (void_t *) strings[i];
+        segments[i].length = strlen(strings[i]);
+    }
+
+    packet = gekkota_packet_new_3(segments, GEKKOTA_TEST_SEGMENT_COUNT,
+            GEKKOTA_PACKET_FLAG_RELIABLE, gekkota_test_packet_release, &release);
+    gekkota_test_assert(packet != NULL);
+    gekkota_test_assert(gekkota_packet_get_size(packet) == 23);
+
+    /*
+     * Ranges are mapped onto the segments they span.
+     */
+    gekkota_test_assert(_gekkota_packet_count_segments(packet, 0, 23) == 3);
+    gekkota_test_assert(_gekkota_packet_count_segments(packet, 0, 7) == 1);
+    gekkota_test_assert(_gekkota_packet_count_segments(packet, 7, 10) == 1);
+    gekkota_test_assert(_gekkota_packet_count_segments(packet, 5, 4) == 2);
+    gekkota_test_assert(_gekkota_packet_count_segments(packet, 16, 7) == 2);
+
+    gekkota_test_assert(_gekkota_packet_get_segments(packet, 5, 14, buffers) == 3);
+    gekkota_test_assert(buffers[0].data == strings[0] + 5 && buffers[0].length == 2);
+    gekkota_test_assert(buffers[1].data == strings[1] && buffers[1].length == 10);
+    gekkota_test_assert(buffers[2].data == strings[2] && buffers[2].length == 2);
+
+    /*
+     * The segments are released as soon as the library no longer needs
+     * them, and only once.
+     */
+    gekkota_test_assert(gekkota_packet_new_0(packet, FALSE) == packet);
+    gekkota_test_assert(gekkota_packet_destroy(packet) == 1);
+    gekkota_test_assert(release.callCount == 0);
+
+    gekkota_test_assert(gekkota_packet_destroy(packet) == 0);
+    gekkota_test_assert(release.callCount == 1);
+    gekkota_test_assert(release.segmentCount == GEKKOTA_TEST_SEGMENT_COUNT);
+
+    /*
+     * Invalid segment lists are rejected.
+     */
+    gekkota_test_assert(gekkota_packet_new_3(segments, 0,
+            GEKKOTA_PACKET_FLAG_NONE, NULL, NULL) == NULL);
+    gekkota_test_assert(gekkota_packet_new_3(segments,
+            GEKKOTA_PACKET_MAX_SEGMENTS + 1, GEKKOTA_PACKET_FLAG_NONE, NULL, NULL) == NULL);
+
+    segments[1].data = NULL;
+    gekkota_test_assert(gekkota_packet_new_3(segments, GEKKOTA_TEST_SEGMENT_COUNT,
+            GEKKOTA_PACKET_FLAG_NONE, NULL, NULL) == NULL);
+
+    return 0;
+}
+
+static int32_t
+gekkota_test_packet_flatten(void_t)
+{
+    static const char_t *strings[GEKKOTA_TEST_SEGMENT_COUNT] =
+    {
+        "Hello, ", "flat ", "world!"
+    };
+
+    GekkotaTestRelease release = { 0, 0 };
+    GekkotaBuffer segments[GEKKOTA_TEST_SEGMENT_COUNT];
+    GekkotaMemoryArena *arena;
+    GekkotaPacket *packet, *newPacket;
+    uint16_t i;
+
+    for (i = 0; i < GEKKOTA_TEST_SEGMENT_COUNT; i++)
+    {
+        segments[i].data = (void_t *) strings[i];
+        segments[i].length = strlen(strings[i]);
+    }
+
+    packet = gekkota_packet_new_3(segments, GEKKOTA_TEST_SEGMENT_COUNT,
+            GEKKOTA_PACKET_FLAG_NONE, gekkota_test_packet_release, &release);
+    gekkota_test_assert(packet != NULL);
+
+    arena = gekkota_memory_arena_new(
+            GEKKOTA_MEMORY_DEFAULT_BLOCK_SIZE,
+            GEKKOTA_MEMORY_DEFAULT_BLOCK_COUNT);
+    gekkota_test_assert(arena != NULL);
+
+    /*
+     * A deep copy gathers the segments into a buffer of its own, whatever
+     * arena is attached, and leaves the packet as it is.
+     */
+    gekkota_memory_set_arena(arena);
+    newPacket = gekkota_packet_new_0(packet, TRUE);
+    gekkota_memory_set_arena(NULL);
+    gekkota_test_assert(newPacket != NULL && newPacket != packet);
+    gekkota_test_assert(packet->segmentCount == GEKKOTA_TEST_SEGMENT_COUNT);
+    gekkota_test_assert(release.callCount == 0);
+    gekkota_test_assert(gekkota_packet_get_size(newPacket) == 18);
+    gekkota_test_assert(memcmp(gekkota_packet_get_data(newPacket)->data,
+            "Hello, flat world!", 18) == 0);
+
+    /*
+     * Nor do comparisons and copies touch the segments.
+     */
+    gekkota_test_assert(gekkota_packet_equals(packet, newPacket));
+    gekkota_test_assert(gekkota_packet_equals(newPacket, packet));
+    memset(gekkota_packet_get_data(newPacket)->data, 0x00, 18);
+    gekkota_test_assert(!gekkota_packet_equals(packet, newPacket));
+    gekkota_test_assert(gekkota_packet_copy(newPacket, packet) == 0);
+    gekkota_test_assert(gekkota_packet_equals(packet, newPacket));
+    gekkota_test_assert(packet->segmentCount == GEKKOTA_TEST_SEGMENT_COUNT);
+    gekkota_test_assert(release.callCount == 0);
+
+    gekkota_test_assert(gekkota_packet_destroy(newPacket) == 0);
+    gekkota_memory_arena_destroy(arena);
+
+    /*
+     * The data is only available as a whole once the packet is flattened,
+     * which releases the segments.
+     */
+    gekkota_test_assert(gekkota_packet_get_data(packet) == NULL);
+    gekkota_test_assert(gekkota_packet_flatten(packet) == 0);
+    gekkota_test_assert(release.callCount == 1);
+    gekkota_test_assert(gekkota_packet_get_size(packet) == 18);
+    gekkota_test_assert(memcmp(gekkota_packet_get_data(packet)->data,
+            "Hello, flat world!", 18) == 0);
+
+    gekkota_test_assert(gekkota_packet_destroy(packet) == 0);
+    gekkota_test_assert(release.callCount == 1);
+
+    return 0;
+}
+
+static int32_t
+gekkota_test_packet_foreign_data(void_t)
+{
+    GekkotaTestRelease release = { 0, 0 };
+    GekkotaBuffer data;
+    GekkotaPacket *packet, *newPacket;
+    byte_t bytes[GEKKOTA_TEST_PACKET_SIZE];
+
+    memset(bytes, 0x55, sizeof(bytes));
+    data.data = bytes;
+    data.length = sizeof(bytes);
+
+    packet = gekkota_packet_new_4(&data, GEKKOTA_PACKET_FLAG_NONE,
+            gekkota_test_packet_release, &release);
+    gekkota_test_assert(packet != NULL);
+    gekkota_test_assert(gekkota_packet_get_data(packet)->data == bytes);
+
+    /*
+     * Application data is used in place and handed back once the last
+     * reference goes away; deep copies do not depend on it.
+     */
+    newPacket = gekkota_packet_new_0(packet, TRUE);
+    gekkota_test_assert(newPacket != NULL);
+    gekkota_test_assert(gekkota_packet_get_data(newPacket)->data != bytes);
+    gekkota_test_assert(gekkota_packet_equals(newPacket, packet));
+
+    gekkota_packet_new_0(packet, FALSE);
+    gekkota_test_assert(gekkota_packet_destroy(packet) == 1);
+    gekkota_test_assert(release.callCount == 0);
+    gekkota_test_assert(gekkota_packet_destroy(packet) == 0);
+    gekkota_test_assert(release.callCount == 1);
+    gekkota_test_assert(release.segmentCount == 1);
+
+    gekkota_packet_destroy(newPacket);
+    return 0;
+}
+
+static void_t
+gekkota_test_packet_release(
+        const GekkotaBuffer *segments,
+        uint16_t segmentCount,
+        void_t *userData)
+{
+    GekkotaTestRelease *release = (GekkotaTestRelease *) userData;
+
+    (void) segments;
+
+    release->callCount++;
+    release->segmentCount = segmentCount;
+}
@@ -0,0 +1,372 @@
+/******************************************************************************
+ * @file    gekkota_test_socket.c
+ * @date    17-Oct-2026
+ * @author  <a href="mailto:giuseppe.greco@agamura.com">Giuseppe Greco</a>
+ *
+ * Copyright (C) 2026 Agamura, Inc. - http://www.agamura.com
+ * All right reserved.
+ ******************************************************************************/
+
+/*
+ * Socket rings are internal, so link against them the way the library
+ * itself does.
+ */
+#define GEKKOTA_BUILDING_STATIC_LIB
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gekkota/gekkota.h"
+#include "gekkota/gekkota_errors.h"
+#include "gekkota/gekkota_memory.h"
+#include "gekkota/gekkota_socket.h"
+#include "gekkota/gekkota_time.h"
+#include "gekkota/gekkota_utils.h"
+#include "gekkota_test.h"
+
+#define GEKKOTA_TEST_SOCKET_ADDRESS "::1"
+#define GEKKOTA_TEST_SOCKET_RECEIVER_PORT 9053
+#define GEKKOTA_TEST_SOCKET_SENDER_PORT 9054
+#define GEKKOTA_TEST_SOCKET_TIMEOUT 5000
+#define GEKKOTA_TEST_SOCKET_BUFFER_SIZE 2048
+#define GEKKOTA_TEST_SOCKET_MAX_DATAGRAMS (2 * GEKKOTA_SOCKET_MAX_BATCH_SIZE + 1)
+#define GEKKOTA_TEST_SOCKET_OVERSIZED 70000
+
+/*
+ * Exit status `make check` reports as a skipped test.
+ */
+#define GEKKOTA_TEST_SKIP 77
+
+/*
+ * A sender and a receiver socket on the loopback interface, both driven
+ * through rings.
+ */
+typedef struct _GekkotaTestSocket
+{
+    GekkotaSocket       *sender;
+    GekkotaSocket       *receiver;
+    GekkotaSocketAddress receiverAddress;
+    byte_t              data[GEKKOTA_TEST_SOCKET_MAX_DATAGRAMS][GEKKOTA_TEST_SOCKET_BUFFER_SIZE];
+    GekkotaBuffer       buffers[GEKKOTA_TEST_SOCKET_MAX_DATAGRAMS];
+    GekkotaDatagram     datagrams[GEKKOTA_TEST_SOCKET_MAX_DATAGRAMS];
+    byte_t              receivedData[GEKKOTA_SOCKET_MAX_BATCH_SIZE][GEKKOTA_TEST_SOCKET_BUFFER_SIZE];
+} GekkotaTestSocket;
+
+static GekkotaTestSocket test;
+
+static int32_t
+gekkota_test_socket_ring_round_trip(void_t);
+
+static int32_t
+gekkota_test_socket_ring_large_batch(void_t);
+
+static int32_t
+gekkota_test_socket_ring_send_failure(void_t);
+
+static int32_t
+gekkota_test_socket_open(void_t);
+
+static GekkotaSocket *
+gekkota_test_socket_new(uint16_t port);
+
+static void_t
+gekkota_test_socket_close(void_t);
+
+static void_t
+gekkota_test_socket_prepare(size_t first, size_t count);
+
+static int32_t
+gekkota_test_socket_send(size_t first, size_t count);
+
+static int32_t
+gekkota_test_socket_receive(size_t first, size_t count);
+
+static size_t
+gekkota_test_socket_get_size(size_t index);
+
+static const GekkotaTestCase testCases[] =
+{
+    { "socket: ring round trip", gekkota_test_socket_ring_round_trip },
+    { "socket: ring large batch", gekkota_test_socket_ring_large_batch },
+    { "socket: ring send failure", gekkota_test_socket_ring_send_failure }
+};
+
+int32_t main(void_t)
+{
+    int32_t failed;
+
+    if (gekkota_initialize() != 0 || gekkota_memory_initialize(
+            GEKKOTA_MEMORY_DEFAULT_BLOCK_SIZE,
+            GEKKOTA_MEMORY_DEFAULT_BLOCK_COUNT) != 0)
+    {
+        fprintf(stderr, "Error while initializing Gekkota - RC 0x%08X.\n",
+                gekkota_get_last_error());
+        return EXIT_FAILURE;
+    }
+
+    /*
+     * Rings need io_uring, which the kernel may lack or refuse.
+     */
+    if (gekkota_test_socket_open() != 0)
+    {
+        failed = gekkota_get_last_error() == GEKKOTA_ERROR_OPERATION_NOT_SUPPORTED
+            ? GEKKOTA_TEST_SKIP : EXIT_FAILURE;
+
+        if (failed == GEKKOTA_TEST_SKIP)
+            fprintf(stdout, "SKIP: socket rings not supported\n");
+        else
+            fprintf(stderr, "Error while opening sockets - RC 0x%08X.\n",
+                    gekkota_get_last_error());
+
+        gekkota_memory_uninitialize();
+        gekkota_uninitialize();
+        return failed;
+    }
+
+    gekkota_test_socket_close();
+    failed = gekkota_test_run(testCases);
+
+    gekkota_memory_uninitialize();
+    gekkota_uninitialize();
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int32_t
+gekkota_test_socket_ring_round_trip(void_t)
+{
+    gekkota_test_assert(gekkota_test_socket_open() == 0);
+
+    /*
+     * A batch of datagrams of different sizes comes out in order and byte
+     * for byte, tagged with the address of the sender.
+     */
+    gekkota_test_assert(gekkota_test_socket_send(0, 16) == 16);
+    gekkota_test_assert(gekkota_test_socket_receive(0, 16) == 0);
+
+    gekkota_test_socket_close();
+    return 0;
+}
+
+static int32_t
+gekkota_test_socket_ring_large_batch(void_t)
+{
+    gekkota_test_assert(gekkota_test_socket_open() == 0);
+
+    /*
+     * Batches larger than a single submission are split, and every part
+     * is waited for.
+     */
+    gekkota_test_assert(gekkota_test_socket_send(0,
+            GEKKOTA_TEST_SOCKET_MAX_DATAGRAMS) == GEKKOTA_TEST_SOCKET_MAX_DATAGRAMS);
+    gekkota_test_assert(gekkota_test_socket_receive(0,
+            GEKKOTA_TEST_SOCKET_MAX_DATAGRAMS) == 0);
+
+    gekkota_test_socket_close();
+    return 0;
+}
+
+static int32_t
+gekkota_test_socket_ring_send_failure(void_t)
+{
+    GekkotaBuffer buffer;
+
+    gekkota_test_assert(gekkota_test_socket_open() == 0);
+    gekkota_test_assert(gekkota_buffer_malloc(&buffer,
+            GEKKOTA_TEST_SOCKET_OVERSIZED, TRUE) == 0);
+
+    /*
+     * A datagram too large to be sent stops the batch there: the sends
+     * linked after it are cancelled, and nothing of them is left in the
+     * ring for the next batch to pick up.
+     */
+    gekkota_test_socket_prepare(0, 4);
+    test.datagrams[2].buffers = &buffer;
+
+    gekkota_test_assert(_gekkota_socket_ring_send_batch(
+            test.sender->ring, test.datagrams, 4, 0) == 2);
+
+    gekkota_buffer_free(&buffer);
+
+    gekkota_test_assert(gekkota_test_socket_send(4, 8) == 8);
+    gekkota_test_assert(gekkota_test_socket_receive(0, 2) == 0);
+    gekkota_test_assert(gekkota_test_socket_receive(4, 8) == 0);
+
+    /*
+     * Nothing else is on the way.
+     */
+    gekkota_test_assert(_gekkota_socket_ring_poll(test.receiver->ring, 100) == 0);
+
+    gekkota_test_socket_close();
+    return 0;
+}
+
+static int32_t
+gekkota_test_socket_open(void_t)
+{
+    GekkotaIPEndPoint *endPoint;
+
+    memset(&test, 0, sizeof(GekkotaTestSocket));
+
+    if ((test.receiver = gekkota_test_socket_new(
+            GEKKOTA_TEST_SOCKET_RECEIVER_PORT)) == NULL ||
+            (test.sender = gekkota_test_socket_new(
+            GEKKOTA_TEST_SOCKET_SENDER_PORT)) == NULL)
+        goto gekkota_test_socket_open_error;
+
+    if ((endPoint = gekkota_socket_get_local_endpoint(test.receiver)) == NULL ||
+            gekkota_ipendpoint_to_socketaddress(endPoint, &test.receiverAddress) != 0)
+        goto gekkota_test_socket_open_error;
+
+    return 0;
+
+gekkota_test_socket_open_error:
+    gekkota_test_socket_close();
+    return -1;
+}
+
+static GekkotaSocket *
+gekkota_test_socket_new(uint16_t port)
+{
+    GekkotaIPAddress *address;
+    GekkotaIPEndPoint *endPoint;
+    GekkotaSocket *socket = NULL;
+
+    if ((address = gekkota_ipaddress_new(GEKKOTA_TEST_SOCKET_ADDRESS)) == NULL)
+        return NULL;
+
+    if ((endPoint = gekkota_ipendpoint_new(address, port)) != NULL)
+    {
+        socket = gekkota_socket_new_3(GEKKOTA_SOCKET_TYPE_DATAGRAM, endPoint);
+        gekkota_ipendpoint_destroy(endPoint);
+    }
+
+    gekkota_ipaddress_destroy(address);
+
+    if (socket != NULL && _gekkota_socket_attach_ring(
+            socket, GEKKOTA_TEST_SOCKET_BUFFER_SIZE) != 0)
+    {
+        int32_t error = gekkota_get_last_error();
+
+        gekkota_socket_destroy(socket);
+        errno = error;
+        return NULL;
+    }
+
+    return socket;
+}
+
+static void_t
+gekkota_test_socket_close(void_t)
+{
+    if (test.sender != NULL)
+        gekkota_socket_destroy(test.sender);
+
+    if (test.receiver != NULL)
+        gekkota_socket_destroy(test.receiver);
+
+    memset(&test, 0, sizeof(GekkotaTestSocket));
+}
+
+static void_t
+gekkota_test_socket_prepare(size_t first, size_t count)
+{
+    size_t i, j, size;
+
+    /*
+     * Each datagram is filled with its own index, so that whatever comes
+     * out of order or twice is caught.
+     */
+    for (i = first; i < first + count; i++)
+    {
+        size = gekkota_test_socket_get_size(i);
+
+        for (j = 0; j < size; j++)
+            test.data[i][j] = (byte_t) (i + j);
+
+        test.buffers[i].data = test.data[i];
+        test.buffers[i].length = size;
+        test.datagrams[i].remoteSocketAddress = &test.receiverAddress;
+        test.datagrams[i].buffers = &test.buffers[i];
+        test.datagrams[i].bufferCount = 1;
+        test.datagrams[i].length = 0;
+    }
+}
+
+static int32_t
+gekkota_test_socket_send(size_t first, size_t count)
+{
+    gekkota_test_socket_prepare(first, count);
+
+    return _gekkota_socket_ring_send_batch(
+            test.sender->ring, &test.datagrams[first], count, 0);
+}
+
+static int32_t
+gekkota_test_socket_receive(size_t first, size_t count)
+{
+    GekkotaSocketAddress addresses[GEKKOTA_SOCKET_MAX_BATCH_SIZE];
+    GekkotaBuffer buffers[GEKKOTA_SOCKET_MAX_BATCH_SIZE];
+    GekkotaDatagram datagrams[GEKKOTA_SOCKET_MAX_BATCH_SIZE];
+    GekkotaIPEndPoint *endPoint;
+    uint32_t deadline = gekkota_time_now() + GEKKOTA_TEST_SOCKET_TIMEOUT;
+    size_t i, index, received = 0;
+    int32_t port, rc;
+
+    for (i = 0; i < GEKKOTA_SOCKET_MAX_BATCH_SIZE; i++)
+    {
+        buffers[i].data = test.receivedData[i];
+        buffers[i].length = GEKKOTA_TEST_SOCKET_BUFFER_SIZE;
+        datagrams[i].remoteSocketAddress = &addresses[i];
+        datagrams[i].buffers = &buffers[i];
+        datagrams[i].bufferCount = 1;
+    }
+
+    while (received < count)
+    {
+        if ((int32_t) (gekkota_time_now() - deadline) >= 0)
+            return -1;
+
+        if ((rc = _gekkota_socket_ring_poll(test.receiver->ring, 100)) <= 0)
+        {
+            if (rc == -1)
+                return -1;
+
+            continue;
+        }
+
+        if ((rc = _gekkota_socket_ring_receive_batch(test.receiver->ring, datagrams,
+                gekkota_utils_min(count - received, GEKKOTA_SOCKET_MAX_BATCH_SIZE))) == -1)
+            return -1;
+
+        /*
+         * Datagrams come out of the loopback interface in the order they
+         * were sent.
+         */
+        for (i = 0; i < (size_t) rc; i++, received++)
+        {
+            index = first + received;
+
+            if (datagrams[i].length != gekkota_test_socket_get_size(index) ||
+                    memcmp(test.receivedData[i], test.data[index], datagrams[i].length) != 0)
+                return -1;
+
+            if ((endPoint = gekkota_ipendpoint_new_2(&addresses[i])) == NULL)
+                return -1;
+
+            port = gekkota_ipendpoint_get_port(endPoint);
+            gekkota_ipendpoint_destroy(endPoint);
+
+            if (port != GEKKOTA_TEST_SOCKET_SENDER_PORT)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+static size_t
+gekkota_test_socket_get_size(size_t index)
+{
+    return 1 + ((index * 97) % GEKKOTA_TEST_SOCKET_BUFFER_SIZE);
+}
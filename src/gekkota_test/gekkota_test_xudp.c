@@ -0,0 +1,518 @@
+/******************************************************************************
+ * @file    gekkota_test_xudp.c
+ * @date    17-Oct-2026
+ * @author  <a href="mailto:giuseppe.greco@agamura.com">Giuseppe Greco</a>
+ *
+ * Copyright (C) 2026 Agamura, Inc. - http://www.agamura.com
+ * All right reserved.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "gekkota/gekkota.h"
+#include "gekkota_test.h"
+
+#define GEKKOTA_TEST_XUDP_ADDRESS "::1"
+#define GEKKOTA_TEST_XUDP_SERVER_PORT 9051
+#define GEKKOTA_TEST_XUDP_RELAY_PORT 9052
+#define GEKKOTA_TEST_XUDP_TIMEOUT 10000
+#define GEKKOTA_TEST_XUDP_CHANNEL_COUNT 2
+#define GEKKOTA_TEST_XUDP_MAX_PACKETS 256
+#define GEKKOTA_TEST_XUDP_MAX_DATAGRAM_SIZE 65536
+#define GEKKOTA_TEST_XUDP_RELAY_BATCH_SIZE 8
+#define GEKKOTA_TEST_XUDP_RELAY_DROP_INTERVAL 5
+#define GEKKOTA_TEST_XUDP_FRAGMENTED_SIZE 100000
+
+/*
+ * A server and a client host talking over the loopback interface, either
+ * directly or through a relay that reorders and drops datagrams.
+ */
+typedef struct _GekkotaTestXudp
+{
+    GekkotaXudp         *server;
+    GekkotaXudp         *host;
+    GekkotaXudpClient   *client;            /* [host]'s link to [server] */
+    GekkotaXudpClient   *serverClient;      /* [server]'s link to [host] */
+    GekkotaSocket       *relay;
+    GekkotaIPEndPoint   *serverEndPoint;
+    GekkotaIPEndPoint   *hostEndPoint;      /* learned by [relay] */
+    GekkotaBuffer       datagrams[GEKKOTA_TEST_XUDP_RELAY_BATCH_SIZE];
+    size_t              datagramCount;      /* held by [relay] */
+    uint32_t            forwardedCount;
+    GekkotaPacket       *packets[GEKKOTA_TEST_XUDP_MAX_PACKETS];
+    uint8_t             channelIds[GEKKOTA_TEST_XUDP_MAX_PACKETS];
+    size_t              packetCount;        /* received by [server] */
+} GekkotaTestXudp;
+
+static GekkotaTestXudp test;
+
+static int32_t
+gekkota_test_xudp_round_trip(void_t);
+
+static int32_t
+gekkota_test_xudp_reorder_window(void_t);
+
+static int32_t
+gekkota_test_xudp_fragment_memory_limit(void_t);
+
+static int32_t
+gekkota_test_xudp_open(bool_t relay);
+
+static GekkotaIPEndPoint *
+gekkota_test_xudp_new_endpoint(uint16_t port);
+
+static void_t
+gekkota_test_xudp_close(void_t);
+
+static int32_t
+gekkota_test_xudp_service(size_t packetCount, int32_t timeout);
+
+static int32_t
+gekkota_test_xudp_service_host(GekkotaXudp *xudp);
+
+static int32_t
+gekkota_test_xudp_service_relay(void_t);
+
+static int32_t
+gekkota_test_xudp_send(uint8_t channelId, size_t size, GekkotaPacketFlag flags);
+
+static bool_t
+gekkota_test_xudp_check(const GekkotaPacket *packet, size_t size);
+
+static const GekkotaTestCase testCases[] =
+{
+    { "xudp: round trip", gekkota_test_xudp_round_trip },
+    { "xudp: reorder window", gekkota_test_xudp_reorder_window },
+    { "xudp: fragment memory limit", gekkota_test_xudp_fragment_memory_limit }
+};
+
+int32_t main(void_t)
+{
+    int32_t failed;
+
+    if (gekkota_initialize() != 0 || gekkota_memory_initialize(
+            GEKKOTA_MEMORY_DEFAULT_BLOCK_SIZE,
+            GEKKOTA_MEMORY_DEFAULT_BLOCK_COUNT) != 0)
+    {
+        fprintf(stderr, "Error while initializing Gekkota - RC 0x%08X.\n",
+                gekkota_get_last_error());
+        return EXIT_FAILURE;
+    }
+
+    failed = gekkota_test_run(testCases);
+
+    gekkota_memory_uninitialize();
+    gekkota_uninitialize();
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int32_t
+gekkota_test_xudp_round_trip(void_t)
+{
+    /*
+     * Sizes around the varint boundaries of the message headers, a full
+     * datagram, and packets that have to be fragmented.
+     */
+    static const size_t sizes[] =
+    {
+        1, 127, 128, 255, 256, 1000, 1400, 16383, 16384,
+        GEKKOTA_TEST_XUDP_FRAGMENTED_SIZE
+    };
+
+    size_t count = sizeof(sizes) / sizeof(size_t);
+    size_t i, j;
+
+    gekkota_test_assert(gekkota_test_xudp_open(FALSE) == 0);
+
+    /*
+     * Every packet must come out byte for byte, whatever the way it is
+     * sent: reliable packets in order, the others in any order.
+     */
+    for (i = 0; i < count; i++)
+        gekkota_test_assert(gekkota_test_xudp_send(0, sizes[i],
+                GEKKOTA_PACKET_FLAG_RELIABLE) == 0);
+
+    gekkota_test_assert(gekkota_test_xudp_send(0, 300,
+            GEKKOTA_PACKET_FLAG_RELIABLE | GEKKOTA_PACKET_FLAG_COMPRESSED) == 0);
+    gekkota_test_assert(gekkota_test_xudp_send(1, 200,
+            GEKKOTA_PACKET_FLAG_NONE) == 0);
+    gekkota_test_assert(gekkota_test_xudp_send(1, 100,
+            GEKKOTA_PACKET_FLAG_UNSEQUENCED) == 0);
+
+    gekkota_test_assert(gekkota_test_xudp_service(count + 3, GEKKOTA_TEST_XUDP_TIMEOUT) == 0);
+
+    for (i = 0, j = 0; i < test.packetCount; i++)
+    {
+        if (test.channelIds[i] == 0 && j < count)
+        {
+            gekkota_test_assert(gekkota_test_xudp_check(test.packets[i], sizes[j]));
+            j++;
+        }
+        else
+        {
+            gekkota_test_assert(
+                    gekkota_test_xudp_check(test.packets[i], 300) ||
+                    gekkota_test_xudp_check(test.packets[i], 200) ||
+                    gekkota_test_xudp_check(test.packets[i], 100));
+        }
+    }
+
+    gekkota_test_assert(j == count);
+
+    gekkota_test_xudp_close();
+    return 0;
+}
+
+static int32_t
+gekkota_test_xudp_reorder_window(void_t)
+{
+    size_t count = GEKKOTA_TEST_XUDP_MAX_PACKETS / 2;
+    size_t i;
+
+    gekkota_test_assert(gekkota_test_xudp_open(TRUE) == 0);
+
+    /*
+     * The relay delivers datagrams in reverse order and drops some of
+     * them, yet reliable packets must all come out, and in order.
+     */
+    for (i = 0; i < count; i++)
+    {
+        gekkota_test_assert(gekkota_test_xudp_send(1, 64 + i,
+                GEKKOTA_PACKET_FLAG_RELIABLE) == 0);
+
+        /*
+         * Spread the packets over several datagrams.
+         */
+        if (i % 4 == 3)
+            gekkota_test_assert(gekkota_xudp_flush(test.host) == 0);
+    }
+
+    gekkota_test_assert(gekkota_test_xudp_service(count, GEKKOTA_TEST_XUDP_TIMEOUT) == 0);
+
+    for (i = 0; i < count; i++)
+    {
+        gekkota_test_assert(test.channelIds[i] == 1);
+        gekkota_test_assert(gekkota_test_xudp_check(test.packets[i], 64 + i));
+    }
+
+    gekkota_test_xudp_close();
+    return 0;
+}
+
+static int32_t
+gekkota_test_xudp_fragment_memory_limit(void_t)
+{
+    gekkota_test_assert(gekkota_test_xudp_open(FALSE) == 0);
+
+    /*
+     * A fragmented packet larger than the memory the server may pin for
+     * the client is not reassembled...
+     */
+    gekkota_xudp_set_client_memory_limit(test.server,
+            GEKKOTA_TEST_XUDP_FRAGMENTED_SIZE / 2);
+
+    gekkota_test_assert(gekkota_test_xudp_send(0, GEKKOTA_TEST_XUDP_FRAGMENTED_SIZE,
+            GEKKOTA_PACKET_FLAG_RELIABLE) == 0);
+    gekkota_test_assert(gekkota_test_xudp_service(1, 500) == -1);
+    gekkota_test_assert(test.packetCount == 0);
+    gekkota_test_assert(gekkota_xudpclient_get_memory_usage(test.serverClient)
+            < GEKKOTA_TEST_XUDP_FRAGMENTED_SIZE / 2);
+
+    /*
+     * ...until the limit is raised, since its fragments are retransmitted
+     * until acknowledged.
+     */
+    gekkota_xudp_set_client_memory_limit(test.server,
+            GEKKOTA_TEST_XUDP_FRAGMENTED_SIZE * 2);
+
+    gekkota_test_assert(gekkota_test_xudp_service(1, GEKKOTA_TEST_XUDP_TIMEOUT) == 0);
+    gekkota_test_assert(gekkota_test_xudp_check(test.packets[0],
+            GEKKOTA_TEST_XUDP_FRAGMENTED_SIZE));
+
+    gekkota_test_xudp_close();
+    return 0;
+}
+
+static int32_t
+gekkota_test_xudp_open(bool_t relay)
+{
+    GekkotaIPEndPoint *localEndPoint, *remoteEndPoint;
+
+    memset(&test, 0, sizeof(GekkotaTestXudp));
+
+    /*
+     * The host connects to the relay, if any, which forwards everything
+     * to the server.
+     */
+    if ((test.serverEndPoint = gekkota_test_xudp_new_endpoint(
+            GEKKOTA_TEST_XUDP_SERVER_PORT)) == NULL)
+        return -1;
+
+    test.server = gekkota_xudp_new_7(test.serverEndPoint, 1, GEKKOTA_XUDP_OPTION_IO_URING);
+
+    if ((localEndPoint = gekkota_test_xudp_new_endpoint(0)) != NULL)
+    {
+        test.host = gekkota_xudp_new_7(localEndPoint, 1, GEKKOTA_XUDP_OPTION_IO_URING);
+        gekkota_ipendpoint_destroy(localEndPoint);
+    }
+
+    if (test.server == NULL || test.host == NULL)
+        goto gekkota_test_xudp_open_error;
+
+    if (relay)
+    {
+        if ((remoteEndPoint = gekkota_test_xudp_new_endpoint(
+                GEKKOTA_TEST_XUDP_RELAY_PORT)) == NULL)
+            goto gekkota_test_xudp_open_error;
+
+        test.relay = gekkota_socket_new_3(GEKKOTA_SOCKET_TYPE_DATAGRAM, remoteEndPoint);
+    }
+    else
+        remoteEndPoint = gekkota_ipendpoint_new_0(test.serverEndPoint, FALSE);
+
+    if (!relay || test.relay != NULL)
+        test.client = gekkota_xudp_connect_3(test.host, remoteEndPoint,
+                GEKKOTA_TEST_XUDP_CHANNEL_COUNT, GEKKOTA_COMPRESSION_LEVEL_FAST);
+
+    gekkota_ipendpoint_destroy(remoteEndPoint);
+
+    if (test.client == NULL)
+        goto gekkota_test_xudp_open_error;
+
+    if (gekkota_test_xudp_service(0, GEKKOTA_TEST_XUDP_TIMEOUT) != 0)
+        goto gekkota_test_xudp_open_error;
+
+    return 0;
+
+gekkota_test_xudp_open_error:
+    gekkota_test_xudp_close();
+    return -1;
+}
+
+static GekkotaIPEndPoint *
+gekkota_test_xudp_new_endpoint(uint16_t port)
+{
+    GekkotaIPAddress *address;
+    GekkotaIPEndPoint *endPoint;
+
+    if ((address = gekkota_ipaddress_new(GEKKOTA_TEST_XUDP_ADDRESS)) == NULL)
+        return NULL;
+
+    endPoint = gekkota_ipendpoint_new(address, port);
+    gekkota_ipaddress_destroy(address);
+
+    return endPoint;
+}
+
+static void_t
+gekkota_test_xudp_close(void_t)
+{
+    size_t i;
+
+    for (i = 0; i < test.packetCount; i++)
+        gekkota_packet_destroy(test.packets[i]);
+
+    for (i = 0; i < test.datagramCount; i++)
+        gekkota_buffer_free(&test.datagrams[i]);
+
+    /*
+     * Destroying the hosts disconnects and releases their clients.
+     */
+    if (test.host != NULL)
+        gekkota_xudp_destroy(test.host);
+
+    if (test.server != NULL)
+        gekkota_xudp_destroy(test.server);
+
+    if (test.relay != NULL)
+        gekkota_socket_destroy(test.relay);
+
+    if (test.serverEndPoint != NULL)
+        gekkota_ipendpoint_destroy(test.serverEndPoint);
+
+    if (test.hostEndPoint != NULL)
+        gekkota_ipendpoint_destroy(test.hostEndPoint);
+
+    memset(&test, 0, sizeof(GekkotaTestXudp));
+}
+
+static int32_t
+gekkota_test_xudp_service(size_t packetCount, int32_t timeout)
+{
+    uint32_t deadline = gekkota_time_now() + (uint32_t) timeout;
+
+    /*
+     * Run both hosts, and the relay if any, until both ends are connected
+     * and the server has received [packetCount] packets.
+     */
+    while (test.serverClient == NULL ||
+            gekkota_xudpclient_get_state(test.client) != GEKKOTA_CLIENT_STATE_CONNECTED ||
+            test.packetCount < packetCount)
+    {
+        if ((int32_t) (gekkota_time_now() - deadline) >= 0)
+            return -1;
+
+        if (gekkota_test_xudp_service_host(test.host) != 0 ||
+                gekkota_test_xudp_service_host(test.server) != 0)
+            return -1;
+
+        if (test.relay != NULL && gekkota_test_xudp_service_relay() != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int32_t
+gekkota_test_xudp_service_host(GekkotaXudp *xudp)
+{
+    GekkotaEvent *event;
+    int32_t rc;
+
+    while ((rc = gekkota_xudp_poll(xudp, &event, xudp == test.server ? 1 : 0)) > 0)
+    {
+        if (event == NULL)
+            continue;
+
+        switch (gekkota_event_get_type(event))
+        {
+            case GEKKOTA_EVENT_TYPE_CONNECT:
+                if (xudp == test.server)
+                    test.serverClient = gekkota_event_get_client(event);
+                break;
+
+            case GEKKOTA_EVENT_TYPE_RECEIVE:
+                if (xudp == test.server && test.packetCount < GEKKOTA_TEST_XUDP_MAX_PACKETS)
+                {
+                    test.channelIds[test.packetCount] = gekkota_event_get_channel_id(event);
+                    test.packets[test.packetCount++] =
+                        gekkota_packet_new_0(gekkota_event_get_packet(event), FALSE);
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        gekkota_event_destroy(event);
+    }
+
+    return rc;
+}
+
+static int32_t
+gekkota_test_xudp_service_relay(void_t)
+{
+    GekkotaBuffer buffer;
+    GekkotaIPEndPoint *remoteEndPoint;
+    int32_t length;
+    size_t i;
+
+    while (gekkota_socket_poll(test.relay, GEKKOTA_SELECT_MODE_READ, 0) > 0)
+    {
+        if (gekkota_buffer_malloc(&buffer, GEKKOTA_TEST_XUDP_MAX_DATAGRAM_SIZE, FALSE) != 0)
+            return -1;
+
+        remoteEndPoint = NULL;
+
+        if ((length = gekkota_socket_receive(test.relay, &buffer, 1, &remoteEndPoint)) <= 0 ||
+                remoteEndPoint == NULL)
+        {
+            gekkota_buffer_free(&buffer);
+            return length < 0 ? -1 : 0;
+        }
+
+        buffer.length = (size_t) length;
+
+        if (gekkota_ipendpoint_equals(remoteEndPoint, test.serverEndPoint))
+        {
+            /*
+             * Traffic to the host goes through untouched.
+             */
+            gekkota_ipendpoint_destroy(remoteEndPoint);
+
+            if (test.hostEndPoint != NULL)
+                gekkota_socket_send(test.relay, test.hostEndPoint, &buffer, 1);
+
+            gekkota_buffer_free(&buffer);
+            continue;
+        }
+
+        if (test.hostEndPoint == NULL)
+            test.hostEndPoint = remoteEndPoint;
+        else
+            gekkota_ipendpoint_destroy(remoteEndPoint);
+
+        /*
+         * Traffic to the server is dropped every now and then, and held
+         * back until a whole batch can be forwarded in reverse order.
+         */
+        if (++test.forwardedCount % GEKKOTA_TEST_XUDP_RELAY_DROP_INTERVAL == 0)
+        {
+            gekkota_buffer_free(&buffer);
+            continue;
+        }
+
+        test.datagrams[test.datagramCount++] = buffer;
+
+        if (test.datagramCount == GEKKOTA_TEST_XUDP_RELAY_BATCH_SIZE)
+            break;
+    }
+
+    /*
+     * Release whatever is held as soon as the host goes quiet, so that
+     * the connection never stalls on the relay.
+     */
+    for (i = test.datagramCount; i > 0; i--)
+    {
+        gekkota_socket_send(test.relay, test.serverEndPoint, &test.datagrams[i - 1], 1);
+        gekkota_buffer_free(&test.datagrams[i - 1]);
+    }
+
+    test.datagramCount = 0;
+    return 0;
+}
+
+static int32_t
+gekkota_test_xudp_send(uint8_t channelId, size_t size, GekkotaPacketFlag flags)
+{
+    GekkotaPacket *packet;
+    byte_t *data;
+    size_t i;
+    int32_t rc;
+
+    if ((packet = gekkota_packet_new_1(size, flags)) == NULL)
+        return -1;
+
+    /*
+     * The content depends on the size, which identifies the packet.
+     */
+    data = gekkota_packet_get_data(packet)->data;
+
+    for (i = 0; i < size; i++)
+        data[i] = (byte_t) (i * 7 + size);
+
+    rc = gekkota_xudpclient_send(test.client, channelId, packet);
+    gekkota_packet_destroy(packet);
+
+    return rc;
+}
+
+static bool_t
+gekkota_test_xudp_check(const GekkotaPacket *packet, size_t size)
+{
+    const byte_t *data;
+    size_t i;
+
+    if (gekkota_packet_get_size(packet) != size)
+        return FALSE;
+
+    data = gekkota_packet_get_data(packet)->data;
+
+    for (i = 0; i < size; i++)
+        if (data[i] != (byte_t) (i * 7 + size))
+            return FALSE;
+
+    return TRUE;
+}